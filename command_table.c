@@ -0,0 +1,256 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+
+#include "command_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+
+#define COMMAND_MAX_SEEDS 100000
+
+// ===== 分词 =====
+
+void command_reader_init(CommandReader* reader, FILE* input) {
+    memset(reader, 0, sizeof(*reader));
+    reader->input = input;
+    reader->at_line_start = 1;
+}
+
+// 当前行用完时读入下一行（超长的行分几次读入），输入结束时返回 0
+static int fill_line(CommandReader* reader) {
+    if (reader->pos < reader->len) return 1;
+    if (fgets(reader->line, sizeof(reader->line), reader->input) == NULL) return 0;
+    reader->pos = 0;
+    reader->len = (int)strlen(reader->line);
+    return reader->len > 0;
+}
+
+int command_next_word(CommandReader* reader) {
+    // 跳过空白和空行
+    for (;;) {
+        if (!fill_line(reader)) {
+            reader->word[0] = '\0';
+            reader->word_len = 0;
+            reader->at_line_start = 1;
+            return 0;
+        }
+        while (reader->pos < reader->len && isspace((unsigned char)reader->line[reader->pos])) {
+            reader->pos++;
+        }
+        if (reader->pos < reader->len) break;
+    }
+
+    // 词可能跨越两次读入，超长部分只计数不保存
+    int length = 0;
+    int terminator = EOF;
+    while (fill_line(reader)) {
+        char c = reader->line[reader->pos++];
+        if (isspace((unsigned char)c)) {
+            terminator = c;
+            break;
+        }
+        if (length < COMMAND_WORD_LEN - 1) {
+            reader->word[length] = c;
+        }
+        length++;
+    }
+    reader->word[length < COMMAND_WORD_LEN ? length : COMMAND_WORD_LEN - 1] = '\0';
+    reader->word_len = length;
+    reader->at_line_start = terminator == '\n' || terminator == EOF;
+    return 1;
+}
+
+void command_skip_line(CommandReader* reader) {
+    while (!reader->at_line_start && fill_line(reader)) {
+        char* start = reader->line + reader->pos;
+        char* newline = (char*)memchr(start, '\n', reader->len - reader->pos);
+        if (newline != NULL) {
+            reader->pos += (int)(newline - start) + 1;
+            reader->at_line_start = 1;
+        }
+        else {
+            reader->pos = reader->len;
+        }
+    }
+    reader->at_line_start = 1;
+}
+
+// ===== 参数 =====
+
+static int parse_int(const char* word, int* value) {
+    char* end;
+    errno = 0;
+    long number = strtol(word, &end, 10);
+    if (end == word || *end != '\0' || errno == ERANGE || number < INT_MIN || number > INT_MAX) {
+        return 0;
+    }
+    *value = (int)number;
+    return 1;
+}
+
+static int parse_date(const char* word, int* value) {
+    int year, month, day;
+    char extra;
+    if (sscanf(word, "%d-%d-%d%c", &year, &month, &day, &extra) != 3) return 0;
+    if (year < 1900 || year > 9999 || month < 1 || month > 12 || day < 1 || day > 31) return 0;
+    *value = year * 10000 + month * 100 + day;
+    return 1;
+}
+
+// 时间 H 或 H:MM，最晚 24:00
+static int parse_time(const char* word, int* value) {
+    int hour, minute = 0;
+    char extra;
+    int fields = sscanf(word, "%d:%d%c", &hour, &minute, &extra);
+    if (fields != 2 && !(fields == 1 && strchr(word, ':') == NULL)) return 0;
+    if (hour < 0 || hour > 24 || minute < 0 || minute > 59 || hour * 60 + minute > 24 * 60) return 0;
+    *value = hour * 60 + minute;
+    return 1;
+}
+
+int command_read_args(CommandReader* reader, const char* types, const char* prompt, CommandArgs* args) {
+    if (prompt != NULL) {
+        printf("%s", prompt);
+    }
+
+    for (const char* type = types; *type; type++) {
+        if (args->count >= COMMAND_MAX_ARGS || !command_next_word(reader)) {
+            return 0;
+        }
+        int slot = args->count++;
+        args->number[slot] = 0;
+        args->text[slot][0] = '\0';
+
+        switch (*type) {
+        case 'i':
+            if (!parse_int(reader->word, &args->number[slot])) return 0;
+            break;
+        case 'c':
+            if (reader->word_len != 1) return 0;
+            args->text[slot][0] = reader->word[0];
+            args->text[slot][1] = '\0';
+            break;
+        case 'w':
+            if (reader->word_len >= COMMAND_WORD_LEN) return 0;
+            memcpy(args->text[slot], reader->word, reader->word_len + 1);
+            break;
+        case 'd':
+            if (!parse_date(reader->word, &args->number[slot])) return 0;
+            break;
+        case 't':
+            if (!parse_time(reader->word, &args->number[slot])) return 0;
+            break;
+        default:
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// ===== 完美哈希 =====
+// 槽位数取不小于命令数 4 倍的 2 的幂，逐个尝试种子，直到所有命令词落在不同的槽位。
+// 命令表只有十几项，通常几十个种子以内就能找到。
+
+static uint32_t command_hash(const char* name, int length, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+int command_table_build(CommandTable* table, const Command* commands, int count) {
+    uint32_t size = 1;
+    while (size < (uint32_t)count * 4) {
+        size <<= 1;
+    }
+    if (count <= 0 || size > COMMAND_MAX_SLOTS) {
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(commands[i].name, commands[j].name) == 0) return 0;
+        }
+    }
+
+    table->commands = commands;
+    table->count = count;
+    table->mask = size - 1;
+
+    for (uint32_t seed = 1; seed < COMMAND_MAX_SEEDS; seed++) {
+        int placed = 0;
+        memset(table->slots, -1, sizeof(table->slots));
+        while (placed < count) {
+            const char* name = commands[placed].name;
+            uint32_t slot = command_hash(name, (int)strlen(name), seed) & table->mask;
+            if (table->slots[slot] >= 0) break;
+            table->slots[slot] = (signed char)placed++;
+        }
+        if (placed == count) {
+            table->seed = seed;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const Command* command_lookup(const CommandTable* table, const char* name, int length) {
+    int index = table->slots[command_hash(name, length, table->seed) & table->mask];
+    if (index < 0) {
+        return NULL;
+    }
+    const Command* command = &table->commands[index];
+    if (strncmp(command->name, name, length) != 0 || command->name[length] != '\0') {
+        return NULL;
+    }
+    return command;
+}
+
+// ===== 分发与菜单 =====
+
+CommandStatus command_dispatch(const CommandTable* table, CommandReader* reader, CommandLevel level) {
+    if (!command_next_word(reader)) {
+        return COMMAND_EOF;
+    }
+
+    const Command* command = NULL;
+    if (reader->word_len < COMMAND_WORD_LEN) {
+        command = command_lookup(table, reader->word, reader->word_len);
+    }
+    if (command == NULL) {
+        return COMMAND_UNKNOWN;
+    }
+    if (level < command->level) {
+        return command->level == COMMAND_ADMIN ? COMMAND_DENIED : COMMAND_NOT_LOGGED_IN;
+    }
+
+    CommandArgs args;
+    args.reader = reader;
+    args.count = 0;
+    if (!command_read_args(reader, command->args, command->prompt, &args)) {
+        return COMMAND_BAD_ARGS;
+    }
+    command->handler(&args);
+    return COMMAND_OK;
+}
+
+void command_print_menu(const CommandTable* table, CommandLevel level) {
+    for (int i = 0; i < table->count; i++) {
+        const Command* command = &table->commands[i];
+        if (command->label == NULL || (command->level == COMMAND_ADMIN && level < COMMAND_ADMIN)) {
+            continue;
+        }
+        if (isdigit((unsigned char)command->name[0])) {
+            printf("%s. %s\n", command->name, command->label);
+        }
+        else {
+            printf("%s - %s\n", command->name, command->label);
+        }
+    }
+}
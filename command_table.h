@@ -0,0 +1,112 @@
+﻿#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+// 控制台命令表
+//
+// 每个命令只在表里声明一次：命令词、菜单说明、权限、参数格式和处理函数。
+// command_table_build() 把表编译成完美哈希，查找一个词只计算一次哈希、
+// 比较一次字符串；菜单也由同一张表生成。
+// 输入由 CommandReader 按行缓冲后切分成词，不再每次调用 scanf。
+//
+// 参数格式每个字符对应一个参数：
+//   i 整数        c 单个字符        w 一个词        d 日期 YYYY-MM-DD
+//   t 时间 H 或 H:MM
+// 整数、日期和时间存入 number[]（日期为 年*10000+月*100+日，时间为从 0:00 起的分钟数），
+// 字符和词存入 text[]。
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COMMAND_MAX_ARGS 8
+#define COMMAND_WORD_LEN 32
+#define COMMAND_LINE_LEN 4096
+#define COMMAND_MAX_SLOTS 128
+
+// 权限：命令要求的级别，也是当前用户的级别
+typedef enum {
+    COMMAND_GUEST,    // 未登录也可以使用
+    COMMAND_USER,     // 需要登录
+    COMMAND_ADMIN     // 需要管理员，非管理员的菜单中不显示
+} CommandLevel;
+
+// 状态码
+typedef enum {
+    COMMAND_OK = 0,
+    COMMAND_EOF,                  // 输入已结束
+    COMMAND_UNKNOWN = -1,         // 表中没有这个命令
+    COMMAND_NOT_LOGGED_IN = -2,   // 需要先登录
+    COMMAND_DENIED = -3,          // 需要管理员权限
+    COMMAND_BAD_ARGS = -4         // 参数缺失或格式不对
+} CommandStatus;
+
+// 带缓冲的分词器
+typedef struct {
+    FILE* input;
+    char line[COMMAND_LINE_LEN];
+    int pos, len;
+    int at_line_start;            // 上一个词后面紧跟着换行（或还没有读过词）
+    char word[COMMAND_WORD_LEN];  // 最近读到的词
+    int word_len;                 // 词的实际长度，可能超过 COMMAND_WORD_LEN - 1
+} CommandReader;
+
+typedef struct {
+    CommandReader* reader;        // 处理函数需要继续读参数时使用
+    int count;
+    int number[COMMAND_MAX_ARGS];
+    char text[COMMAND_MAX_ARGS][COMMAND_WORD_LEN];
+} CommandArgs;
+
+typedef void (*CommandHandler)(CommandArgs* args);
+
+// 一条命令
+typedef struct {
+    const char* name;             // 命令词，如 "Login"、"2"
+    const char* label;            // 菜单中的说明，NULL 表示不在菜单中显示
+    CommandLevel level;
+    const char* args;             // 参数格式，"" 表示没有参数
+    const char* prompt;           // 读取参数前显示的提示，NULL 表示不提示
+    CommandHandler handler;
+} Command;
+
+// 编译后的命令表：slots 按哈希值存放命令下标，空位为 -1
+typedef struct {
+    const Command* commands;
+    int count;
+    uint32_t seed;
+    uint32_t mask;
+    signed char slots[COMMAND_MAX_SLOTS];
+} CommandTable;
+
+void command_reader_init(CommandReader* reader, FILE* input);
+
+// 读下一个词（跳过空白和换行），输入结束时返回 0
+int command_next_word(CommandReader* reader);
+
+// 丢弃当前行剩下的内容
+void command_skip_line(CommandReader* reader);
+
+// 显示提示后按格式读取参数，追加到 args 末尾；成功返回 1
+int command_read_args(CommandReader* reader, const char* types, const char* prompt, CommandArgs* args);
+
+// 编译命令表；命令词重复或命令太多时返回 0
+int command_table_build(CommandTable* table, const Command* commands, int count);
+
+const Command* command_lookup(const CommandTable* table, const char* name, int length);
+
+// 读一个命令词，检查权限、读取参数后调用处理函数。
+// 返回 COMMAND_UNKNOWN、COMMAND_NOT_LOGGED_IN、COMMAND_DENIED 时 reader->word 是读到的命令词，
+// 由调用者显示对应的提示；之后是否丢弃当前行也由调用者决定
+CommandStatus command_dispatch(const CommandTable* table, CommandReader* reader, CommandLevel level);
+
+// 按表的顺序显示菜单：数字命令显示为 "1. 说明"，其他显示为 "Login - 说明"
+void command_print_menu(const CommandTable* table, CommandLevel level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
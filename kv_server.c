@@ -0,0 +1,673 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#endif
+
+#include "kv_server.h"
+
+#define BATCH_SIZE 32        // 批量模式每组查询的键数
+#define BATCH_BUFFER (1024 * 1024) // 批量模式输入、输出缓冲区大小
+#define SERVER_LINE_LIMIT (1024 * 1024)   // 服务器模式一行请求的最大长度
+#define SERVER_OUTPUT_LIMIT (4 * 1024 * 1024) // 一个连接积压的输出超过此大小时暂停读取
+
+// ===== 批量查询 =====
+// 不显示提示符，每行一个键，每个键输出一行值或 Error，供其他程序通过管道调用；
+// SET/DELETE 行输出 OK 或 Error，结果交给调用方之前先提交日志。
+// 输入按块读取、就地切分，键按 BATCH_SIZE 个一组查询：
+// 第一遍计算哈希并预取各自的槽，第二遍探测并预取值，第三遍把结果写入输出缓冲区
+
+// 一组中的一个查询
+typedef struct {
+    uint64_t packed[2];
+    uint64_t hash;
+    int valid;                  // 键长度合法
+    const char* value;          // 查询结果，NULL 表示不存在
+    size_t value_len;
+} BatchQuery;
+
+// 输出缓冲区，满了或等待输入前整块写出
+typedef struct {
+    char* data;
+    size_t len;
+} OutputBuffer;
+
+void output_flush(OutputBuffer* out) {
+    wal_commit();
+    if (out->len > 0) {
+        fwrite(out->data, 1, out->len, stdout);
+        out->len = 0;
+    }
+    fflush(stdout);
+}
+
+void output_write(OutputBuffer* out, const char* data, size_t len) {
+    if (out->len + len > BATCH_BUFFER) {
+        wal_commit();
+        fwrite(out->data, 1, out->len, stdout);
+        out->len = 0;
+    }
+    if (len > BATCH_BUFFER) {
+        fwrite(data, 1, len, stdout);
+        return;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+// 读取已到达的输入（最多 size 字节），没有输入时阻塞；结束或出错返回0
+size_t read_input(char* buffer, size_t size) {
+#ifdef _WIN32
+    int got = _read(_fileno(stdin), buffer, size > INT_MAX ? INT_MAX : (unsigned)size);
+#else
+    ssize_t got = read(STDIN_FILENO, buffer, size);
+#endif
+    return got > 0 ? (size_t)got : 0;
+}
+
+void run_batch(BatchQuery* queries, int count, OutputBuffer* out) {
+    KvTable* table = acquire_table(count);
+
+    for (int i = 0; i < count; i++) {
+        if (queries[i].valid) {
+            IndexPartition* partition = &table->partitions[partition_of(table, queries[i].hash)];
+            PREFETCH(&partition->slots[(size_t)queries[i].hash & (partition->capacity - 1)]);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        queries[i].value = NULL;
+        if (queries[i].valid) {
+            queries[i].value = lookup_value(table, queries[i].packed, queries[i].hash, &queries[i].value_len);
+            if (queries[i].value != NULL) PREFETCH(queries[i].value);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (queries[i].value != NULL) {
+            output_write(out, queries[i].value, queries[i].value_len);
+            output_write(out, "\n", 1);
+        }
+        else {
+            output_write(out, "Error\n", 6);
+        }
+    }
+
+    release_table(table);
+}
+
+// 批量查询循环，遇到 Quit 行或输入结束时返回
+void start_batch_loop() {
+    char* input = (char*)malloc(BATCH_BUFFER);
+    OutputBuffer out = { (char*)malloc(BATCH_BUFFER), 0 };
+    if (input == NULL || out.data == NULL) {
+        fprintf(log_out, "错误：内存不足\n");
+        free(input);
+        free(out.data);
+        return;
+    }
+
+    BatchQuery queries[BATCH_SIZE];
+    int pending = 0;
+    size_t carry = 0;           // 上一块末尾不完整的行
+    int skipping = 0;           // 正在跳过超过缓冲区长度的行
+    int quit = 0;
+
+    while (!quit) {
+        // 已到达的输入都处理完了，等待之前先把结果交给调用方
+        output_flush(&out);
+        check_compaction(0);
+        size_t got = read_input(input + carry, BATCH_BUFFER - carry);
+        int eof = got == 0;
+        const char* p = input;
+        const char* end = input + carry + got;
+
+        while (p < end) {
+            const char* line = p;
+            const char* line_end = find_byte(p, end, '\n');
+            if (line_end == end && !eof) {
+                break;          // 行还不完整，等下一块
+            }
+            p = line_end < end ? line_end + 1 : end;
+            if (skipping) {
+                skipping = 0;
+                continue;
+            }
+
+            trim_view(&line, &line_end);
+            if (line == line_end) {
+                continue;
+            }
+            if (line_end - line == 4 && memcmp(line, "Quit", 4) == 0) {
+                quit = 1;
+                break;
+            }
+
+            // 键不含空白字符，含空白的行只可能是修改、前缀或范围查询，先查完之前的键
+            if (find_space(line, line_end) != line_end) {
+                if (pending > 0) {
+                    run_batch(queries, pending, &out);
+                    pending = 0;
+                }
+                KvTable* table = acquire_table(1);
+                const char* result = write_command(table, line, line_end);
+                if (result != NULL) {
+                    output_write(&out, result, strlen(result));
+                    output_write(&out, "\n", 1);
+                }
+                else {
+                    output_flush(&out);
+                    if (!ordered_query(table, line, line_end - line)) {
+                        printf("Error\n");
+                    }
+                }
+                release_table(table);
+                continue;
+            }
+
+            BatchQuery* query = &queries[pending++];
+            query->valid = pack_key(line, line_end - line, query->packed);
+            query->hash = query->valid ? hash_key(query->packed) : 0;
+            if (pending == BATCH_SIZE) {
+                run_batch(queries, pending, &out);
+                pending = 0;
+            }
+        }
+
+        if (pending > 0) {
+            run_batch(queries, pending, &out);
+            pending = 0;
+        }
+        if (eof) {
+            break;
+        }
+
+        // 不完整的行移到缓冲区开头；一行占满整个缓冲区时按无效键处理并跳过其余部分
+        carry = (size_t)(end - p);
+        memmove(input, p, carry);
+        if (carry == BATCH_BUFFER) {
+            if (!skipping) {
+                queries[0].valid = 0;
+                run_batch(queries, 1, &out);
+            }
+            carry = 0;
+            skipping = 1;
+        }
+    }
+
+    output_flush(&out);
+    free(input);
+    free(out.data);
+}
+
+// ===== 网络服务 =====
+// 服务器模式：用 memcached 文本协议的子集回答查询，一个事件循环处理所有连接。
+//   get <键> [<键> ...]\r\n  每个存在的键返回 VALUE <键> 0 <字节数>\r\n<值>\r\n，最后是 END\r\n
+//   set <键> <flags> <exptime> <字节数> [noreply]\r\n<值>\r\n  返回 STORED（flags 和 exptime 被忽略）
+//   delete <键> [noreply]\r\n  返回 DELETED 或 NOT_FOUND
+//   quit\r\n                 关闭连接
+// 每轮事件循环先处理所有可读的连接，提交一次日志后再发送结果，同一轮的修改共用一次 fsync
+// Linux 下用 epoll，Windows 下用 WSAPoll；地址为 端口、主机:端口 或 unix:路径（仅 Linux）
+
+// 一个连接的缓冲区
+typedef struct {
+    socket_t fd;
+    char* in;
+    size_t in_len, in_cap;
+    char* out;
+    size_t out_len, out_pos, out_cap;
+    int reading;            // 是否在等待可读（输出积压时暂停读取）
+    int writing;            // 是否在等待可写
+    int closing;            // 收到 quit，输出写完后关闭
+} Connection;
+
+int would_block() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+int set_nonblocking(socket_t fd) {
+#ifdef _WIN32
+    u_long enable = 1;
+    return ioctlsocket(fd, FIONBIO, &enable) == 0;
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+int poller_init(Poller* poller) {
+    memset(poller, 0, sizeof(*poller));
+#ifdef _WIN32
+    return 1;
+#else
+    poller->fd = epoll_create1(EPOLL_CLOEXEC);
+    return poller->fd >= 0;
+#endif
+}
+
+void poller_close(Poller* poller) {
+#ifdef _WIN32
+    free(poller->fds);
+    free(poller->owners);
+#else
+    close(poller->fd);
+#endif
+}
+
+#ifdef _WIN32
+int poller_find(Poller* poller, socket_t fd) {
+    for (int i = 0; i < poller->count; i++) {
+        if (poller->fds[i].fd == fd) return i;
+    }
+    return -1;
+}
+#endif
+
+// 设置关注的事件，第一次设置时加入
+int poller_set(Poller* poller, socket_t fd, void* owner, int want_read, int want_write, int add) {
+#ifdef _WIN32
+    int i = add ? poller->count : poller_find(poller, fd);
+    if (add && poller->count == poller->capacity) {
+        int capacity = poller->capacity ? poller->capacity * 2 : 64;
+        WSAPOLLFD* fds = (WSAPOLLFD*)realloc(poller->fds, sizeof(WSAPOLLFD) * capacity);
+        if (fds != NULL) poller->fds = fds;
+        void** owners = (void**)realloc(poller->owners, sizeof(void*) * capacity);
+        if (owners != NULL) poller->owners = owners;
+        if (fds == NULL || owners == NULL) return 0;
+        poller->capacity = capacity;
+    }
+    if (i < 0) return 0;
+    if (add) poller->count++;
+    poller->fds[i].fd = fd;
+    poller->fds[i].events = (SHORT)((want_read ? POLLRDNORM : 0) | (want_write ? POLLWRNORM : 0));
+    poller->owners[i] = owner;
+    return 1;
+#else
+    struct epoll_event event;
+    event.events = (want_read ? EPOLLIN : 0) | (want_write ? EPOLLOUT : 0);
+    event.data.ptr = owner;
+    return epoll_ctl(poller->fd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event) == 0;
+#endif
+}
+
+void poller_remove(Poller* poller, socket_t fd) {
+#ifdef _WIN32
+    int i = poller_find(poller, fd);
+    if (i >= 0) {
+        poller->count--;
+        poller->fds[i] = poller->fds[poller->count];
+        poller->owners[i] = poller->owners[poller->count];
+    }
+#else
+    epoll_ctl(poller->fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+}
+
+// 等待就绪事件，返回事件数
+int poller_wait(Poller* poller, PollEvent* events, int max, int timeout_ms) {
+#ifdef _WIN32
+    if (poller->count == 0 || WSAPoll(poller->fds, (ULONG)poller->count, timeout_ms) <= 0) {
+        return 0;
+    }
+    int n = 0;
+    for (int i = 0; i < poller->count && n < max; i++) {
+        SHORT revents = poller->fds[i].revents;
+        if (revents == 0) continue;
+        events[n].owner = poller->owners[i];
+        events[n].readable = (revents & (POLLRDNORM | POLLHUP | POLLERR)) != 0;
+        events[n].writable = (revents & (POLLWRNORM | POLLHUP | POLLERR)) != 0;
+        n++;
+    }
+    return n;
+#else
+    struct epoll_event ready[256];
+    int n = epoll_wait(poller->fd, ready, max < 256 ? max : 256, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        events[i].owner = ready[i].data.ptr;
+        events[i].readable = (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+        events[i].writable = (ready[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0;
+    }
+    return n > 0 ? n : 0;
+#endif
+}
+
+int connection_write(Connection* conn, const char* data, size_t len) {
+    if (!buffer_reserve(&conn->out, conn->out_len, &conn->out_cap, len, (size_t)-1)) {
+        return 0;
+    }
+    memcpy(conn->out + conn->out_len, data, len);
+    conn->out_len += len;
+    return 1;
+}
+
+// 解析地址：端口（监听 127.0.0.1）、主机:端口 或 unix:路径，成功返回地址长度
+int parse_address(const char* text, struct sockaddr_storage* address) {
+    memset(address, 0, sizeof(*address));
+#ifndef _WIN32
+    if (strncmp(text, "unix:", 5) == 0) {
+        struct sockaddr_un* unix_address = (struct sockaddr_un*)address;
+        if (strlen(text + 5) >= sizeof(unix_address->sun_path)) return 0;
+        unix_address->sun_family = AF_UNIX;
+        strcpy(unix_address->sun_path, text + 5);
+        return (int)sizeof(struct sockaddr_un);
+    }
+#endif
+    char host[64] = "127.0.0.1";
+    const char* port = text;
+    const char* colon = strrchr(text, ':');
+    if (colon != NULL) {
+        if ((size_t)(colon - text) >= sizeof(host)) return 0;
+        memcpy(host, text, colon - text);
+        host[colon - text] = '\0';
+        port = colon + 1;
+    }
+    struct sockaddr_in* inet_address = (struct sockaddr_in*)address;
+    int port_number = atoi(port);
+    if (port_number <= 0 || port_number > 65535 || inet_pton(AF_INET, host, &inet_address->sin_addr) != 1) {
+        return 0;
+    }
+    inet_address->sin_family = AF_INET;
+    inet_address->sin_port = htons((unsigned short)port_number);
+    return (int)sizeof(struct sockaddr_in);
+}
+
+int network_init() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    signal(SIGPIPE, SIG_IGN); // 对方关闭后写入时返回错误而不是结束进程
+    return 1;
+#endif
+}
+
+void close_connection(Poller* poller, Connection* conn) {
+    poller_remove(poller, conn->fd);
+    close_socket(conn->fd);
+    free(conn->in);
+    free(conn->out);
+    free(conn);
+}
+
+// 处理 set 和 delete，[data, data_end) 是这一行之后已收到的数据；
+// set 的数据块还没有收齐时返回-1，内存不足返回0，否则返回1并把数据块的长度写入 used
+int handle_write(const KvTable* table, Connection* conn, int is_set, const char* args, const char* end,
+    const char* data, const char* data_end, size_t* used) {
+    // 切出最多 6 个参数
+    const char* words[6];
+    size_t lens[6];
+    int count = 0;
+    const char* p = args;
+    while (1) {
+        while (p < end && isspace((unsigned char)*p)) p++;
+        if (p == end) break;
+        if (count == 6) return connection_write(conn, "ERROR\r\n", 7);
+        words[count] = p;
+        p = find_space(p, end);
+        lens[count] = (size_t)(p - words[count]);
+        count++;
+    }
+
+    int noreply = count > 0 && lens[count - 1] == 7 && memcmp(words[count - 1], "noreply", 7) == 0;
+    const char* reply;
+    if (is_set) {
+        if (count != 4 + noreply) {
+            return connection_write(conn, "ERROR\r\n", 7);
+        }
+        char* number_end;
+        unsigned long bytes = strtoul(words[3], &number_end, 10);
+        if (number_end != words[3] + lens[3] || bytes > SERVER_LINE_LIMIT / 2) {
+            conn->closing = 1; // 无法跳过数据块，回复后关闭连接
+            return connection_write(conn, "SERVER_ERROR object too large for cache\r\n", 41);
+        }
+        if ((size_t)(data_end - data) < bytes + 2) {
+            return -1;
+        }
+        *used = bytes + 2;
+        if (data[bytes] != '\r' || data[bytes + 1] != '\n') {
+            conn->closing = 1;
+            return connection_write(conn, "CLIENT_ERROR bad data chunk\r\n", 29);
+        }
+        reply = store_write(table, words[0], lens[0], data, bytes) ? "STORED\r\n" : "CLIENT_ERROR invalid key or value\r\n";
+    }
+    else {
+        if (count != 1 + noreply) {
+            return connection_write(conn, "ERROR\r\n", 7);
+        }
+        reply = store_write(table, words[0], lens[0], NULL, 0) ? "DELETED\r\n" : "NOT_FOUND\r\n";
+    }
+    return noreply || connection_write(conn, reply, strlen(reply));
+}
+
+// 处理一行请求，[data, data_end) 是这一行之后已收到的数据，set 的数据块从中取出，长度写入 used；
+// 数据块还没有收齐时返回-1，协议错误需要关闭连接时返回0
+int handle_request(const KvTable* table, Connection* conn, const char* line, const char* end,
+    const char* data, const char* data_end, size_t* used, int* served) {
+    const char* command = line;
+    const char* command_end = find_space(line, end);
+    size_t command_len = (size_t)(command_end - command);
+    *used = 0;
+    if (command_len == 0) {
+        return connection_write(conn, "ERROR\r\n", 7);
+    }
+    if (command_len == 4 && memcmp(command, "quit", 4) == 0) {
+        conn->closing = 1;
+        return 1;
+    }
+    if (command_len == 3 && memcmp(command, "set", 3) == 0) {
+        return handle_write(table, conn, 1, command_end, end, data, data_end, used);
+    }
+    if (command_len == 6 && memcmp(command, "delete", 6) == 0) {
+        return handle_write(table, conn, 0, command_end, end, data, data_end, used);
+    }
+    if (!((command_len == 3 && memcmp(command, "get", 3) == 0) || (command_len == 4 && memcmp(command, "gets", 4) == 0))) {
+        return connection_write(conn, "ERROR\r\n", 7);
+    }
+
+    const char* p = command_end;
+    while (1) {
+        while (p < end && isspace((unsigned char)*p)) p++;
+        if (p == end) break;
+        const char* key = p;
+        p = find_space(p, end);
+
+        uint64_t packed[2];
+        size_t value_len;
+        const char* value;
+        (*served)++;
+        if (!pack_key(key, p - key, packed) ||
+            (value = lookup_value(table, packed, hash_key(packed), &value_len)) == NULL) {
+            continue;
+        }
+        char header[64];
+        int header_len = snprintf(header, sizeof(header), "VALUE %.*s 0 %zu\r\n", (int)(p - key), key, value_len);
+        if (!connection_write(conn, header, header_len) ||
+            !connection_write(conn, value, value_len) ||
+            !connection_write(conn, "\r\n", 2)) {
+            return 0;
+        }
+    }
+    return connection_write(conn, "END\r\n", 5);
+}
+
+// 尽量写出输出缓冲区，出错返回0
+int flush_connection(Connection* conn) {
+    while (conn->out_pos < conn->out_len) {
+        size_t left = conn->out_len - conn->out_pos;
+        int sent = (int)send(conn->fd, conn->out + conn->out_pos, left > INT_MAX ? INT_MAX : (int)left, 0);
+        if (sent <= 0) {
+            return sent < 0 && would_block();
+        }
+        conn->out_pos += (size_t)sent;
+    }
+    conn->out_len = 0;
+    conn->out_pos = 0;
+    return 1;
+}
+
+// 读入数据并处理所有完整的行，连接需要关闭时返回0
+int serve_readable(Connection* conn) {
+    while (conn->out_len - conn->out_pos < SERVER_OUTPUT_LIMIT) {
+        if (!buffer_reserve(&conn->in, conn->in_len, &conn->in_cap, 4096, SERVER_LINE_LIMIT)) {
+            return 0; // 一行超过上限
+        }
+        size_t room = conn->in_cap - conn->in_len;
+        int got = (int)recv(conn->fd, conn->in + conn->in_len, room > INT_MAX ? INT_MAX : (int)room, 0);
+        if (got == 0 || (got < 0 && !would_block())) {
+            return 0;
+        }
+        if (got < 0) {
+            break;
+        }
+        conn->in_len += (size_t)got;
+
+        // 一次读入的所有请求共用一个表引用
+        KvTable* table = acquire_table(0);
+        int served = 0;
+        char* p = conn->in;
+        char* end = conn->in + conn->in_len;
+        int ok = 1;
+        while (ok && !conn->closing) {
+            char* line_end = (char*)memchr(p, '\n', end - p);
+            if (line_end == NULL) break;
+            const char* line = p;
+            const char* trimmed_end = line_end;
+            size_t used;
+            trim_view(&line, &trimmed_end);
+            ok = handle_request(table, conn, line, trimmed_end, line_end + 1, end, &used, &served);
+            if (ok < 0) {
+                ok = 1;
+                break;          // 数据块还不完整，这一行留到下次
+            }
+            p = line_end + 1 + used;
+        }
+        release_table(table);
+        count_queries(served);
+
+        conn->in_len = (size_t)(end - p);
+        memmove(conn->in, p, conn->in_len);
+        if (!ok) {
+            return 0;
+        }
+        if (conn->closing || (size_t)got < room) {
+            break;
+        }
+    }
+    return 1;
+}
+
+// 服务器主循环，出错时返回
+void start_server(const char* address_text) {
+    struct sockaddr_storage address;
+    int address_len = parse_address(address_text, &address);
+    if (address_len == 0 || !network_init()) {
+        fprintf(log_out, "错误：无效的地址 '%s'\n", address_text);
+        return;
+    }
+
+    socket_t listener = socket(address.ss_family, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET) {
+        fprintf(log_out, "错误：无法创建套接字\n");
+        return;
+    }
+    if (address.ss_family == AF_INET) {
+        int enable = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&enable, sizeof(enable));
+    }
+#ifndef _WIN32
+    else {
+        unlink(((struct sockaddr_un*)&address)->sun_path); // 删除上次留下的套接字文件
+    }
+#endif
+    Poller poller;
+    if (bind(listener, (struct sockaddr*)&address, address_len) != 0 || listen(listener, 512) != 0 ||
+        !set_nonblocking(listener) || !poller_init(&poller)) {
+        fprintf(log_out, "错误：无法监听 '%s'\n", address_text);
+        close_socket(listener);
+        return;
+    }
+    poller_set(&poller, listener, NULL, 1, 0, 1);
+    fprintf(log_out, "服务器已启动，监听 %s\n", address_text);
+    fflush(log_out);
+
+    PollEvent events[256];
+    int alive[256];
+    while (1) {
+        // 压缩进行中时定期醒来，以便及时换用新表
+        int n = poller_wait(&poller, events, 256, compaction_running() ? 100 : -1);
+        check_compaction(0);
+        for (int i = 0; i < n; i++) {
+            Connection* conn = (Connection*)events[i].owner;
+            alive[i] = 1;
+            if (conn == NULL) {
+                // 接受所有等待中的连接
+                socket_t fd;
+                while ((fd = accept(listener, NULL, NULL)) != INVALID_SOCKET) {
+                    conn = (Connection*)calloc(1, sizeof(Connection));
+                    if (conn == NULL || !set_nonblocking(fd)) {
+                        free(conn);
+                        close_socket(fd);
+                        continue;
+                    }
+                    if (address.ss_family == AF_INET) {
+                        int enable = 1;
+                        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&enable, sizeof(enable));
+                    }
+                    conn->fd = fd;
+                    conn->reading = 1;
+                    if (!poller_set(&poller, fd, conn, 1, 0, 1)) {
+                        close_socket(fd);
+                        free(conn);
+                    }
+                }
+            }
+            else if (events[i].readable && conn->reading) {
+                alive[i] = serve_readable(conn);
+            }
+        }
+
+        // 这一轮的修改写入磁盘后才发送 STORED/DELETED
+        wal_commit();
+
+        for (int i = 0; i < n; i++) {
+            Connection* conn = (Connection*)events[i].owner;
+            if (conn == NULL) {
+                continue;
+            }
+            int ok = alive[i];
+            if (ok && (events[i].writable || conn->out_len > 0)) {
+                ok = flush_connection(conn);
+            }
+            if (ok && conn->closing && conn->out_len == 0) {
+                ok = 0;
+            }
+            if (!ok) {
+                close_connection(&poller, conn);
+                continue;
+            }
+
+            // 有积压时等待可写，积压过多时暂停读取
+            size_t pending = conn->out_len - conn->out_pos;
+            int reading = !conn->closing && pending < SERVER_OUTPUT_LIMIT;
+            int writing = pending > 0;
+            if (reading != conn->reading || writing != conn->writing) {
+                conn->reading = reading;
+                conn->writing = writing;
+                poller_set(&poller, conn->fd, conn, reading, writing, 0);
+            }
+        }
+    }
+}
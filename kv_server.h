@@ -0,0 +1,75 @@
+﻿#ifndef KV_SERVER_H
+#define KV_SERVER_H
+
+// 查询前端：批量模式（管道输入）和网络服务（memcached 文本协议的子集）
+//
+// 事件等待和地址解析也供 text2_bench 的负载生成器使用。
+
+#include "kv_store.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/epoll.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 就绪事件
+typedef struct {
+    void* owner;
+    int readable;
+    int writable;
+} PollEvent;
+
+// 可读写事件的等待
+typedef struct {
+#ifdef _WIN32
+    WSAPOLLFD* fds;
+    void** owners;
+    int count;
+    int capacity;
+#else
+    int fd;
+#endif
+} Poller;
+
+int would_block();
+int set_nonblocking(socket_t fd);
+int poller_init(Poller* poller);
+void poller_close(Poller* poller);
+int poller_set(Poller* poller, socket_t fd, void* owner, int want_read, int want_write, int add);
+void poller_remove(Poller* poller, socket_t fd);
+int poller_wait(Poller* poller, PollEvent* events, int max, int timeout_ms);
+// 地址为 端口、主机:端口 或 unix:路径，返回地址长度，无效时返回0
+int parse_address(const char* text, struct sockaddr_storage* address);
+int network_init();
+
+// 不显示提示符，每行一个键，直到输入结束
+void start_batch_loop();
+// 回答网络查询，直到进程被结束
+void start_server(const char* address_text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
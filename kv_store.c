@@ -0,0 +1,784 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <time.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "kv_store.h"
+
+KvTable* current_table = NULL;
+mtx_t table_lock;           // 保护 current_table、各表的 refs 和 queries_served
+long long queries_served = 0;
+
+// ===== 热加载 =====
+
+// 取得当前表的引用并记录将要处理的查询数，用完后调用 release_table()
+KvTable* acquire_table(int queries) {
+    mtx_lock(&table_lock);
+    KvTable* table = current_table;
+    table->refs++;
+    queries_served += queries;
+    mtx_unlock(&table_lock);
+    return table;
+}
+
+void release_table(KvTable* table) {
+    mtx_lock(&table_lock);
+    int last = --table->refs == 0;
+    mtx_unlock(&table_lock);
+    if (last) {
+        destroy_table(table);
+    }
+}
+
+// 用新表替换当前表，旧表在正在进行的查询结束后释放
+void swap_table(KvTable* table) {
+    mtx_lock(&table_lock);
+    KvTable* old = current_table;
+    current_table = table;
+    mtx_unlock(&table_lock);
+    if (old != NULL) {
+        release_table(old);
+    }
+}
+
+// 记录不经过 acquire_table() 计数的查询
+void count_queries(int queries) {
+    mtx_lock(&table_lock);
+    queries_served += queries;
+    mtx_unlock(&table_lock);
+}
+
+long long served_count() {
+    mtx_lock(&table_lock);
+    long long count = queries_served;
+    mtx_unlock(&table_lock);
+    return count;
+}
+
+int watch_stopped(Watcher* watcher) {
+    mtx_lock(&table_lock);
+    int stop = watcher->stop;
+    mtx_unlock(&table_lock);
+    return stop;
+}
+
+void sleep_ms(int ms) {
+    struct timespec duration = { ms / 1000, (ms % 1000) * 1000000L };
+    thrd_sleep(&duration, NULL);
+}
+
+// 等待目录中的变化，最多等待 timeout_ms 毫秒；数据文件可能被修改时返回1
+int wait_for_change(Watcher* watcher, int timeout_ms) {
+#ifdef _WIN32
+    if (WaitForSingleObject(watcher->change, (DWORD)timeout_ms) != WAIT_OBJECT_0) {
+        return 0;
+    }
+    FindNextChangeNotification(watcher->change);
+    // Windows 的通知不带文件名，比较文件大小和修改时间（缓存文件的写入也会触发通知）
+    uint64_t size;
+    int64_t mtime;
+    return source_stat(watcher->filename, &size, &mtime) && (size != watcher->size || mtime != watcher->mtime);
+#else
+    struct pollfd poll_fd = { watcher->fd, POLLIN, 0 };
+    if (poll(&poll_fd, 1, timeout_ms) <= 0) {
+        return 0;
+    }
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t len;
+    while ((len = read(watcher->fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + len; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            if (event->len > 0 && strcmp(event->name, watcher->basename) == 0) {
+                changed = 1;
+            }
+        }
+    }
+    return changed;
+#endif
+}
+
+// 后台线程输出提示后补上交互模式的提示符
+void reprint_prompt() {
+    if (log_out == stdout) {
+        fputs("> ", stdout);
+    }
+    fflush(log_out);
+}
+
+// 在后台解析新文件，完成后整体替换当前表
+void reload_table(Watcher* watcher) {
+    // 编辑器可能分几次写入，等文件 200 毫秒内不再变化
+    uint64_t size = 0, next_size;
+    int64_t mtime = 0, next_mtime;
+    source_stat(watcher->filename, &size, &mtime);
+    while (!watch_stopped(watcher)) {
+        sleep_ms(200);
+        wait_for_change(watcher, 0);
+        if (!source_stat(watcher->filename, &next_size, &next_mtime)) {
+            return; // 文件被删除，等它重新出现
+        }
+        if (next_size == size && next_mtime == mtime) {
+            break;
+        }
+        size = next_size;
+        mtime = next_mtime;
+    }
+
+    fprintf(log_out, "\n[监视] '%s' 已修改，正在后台重新加载...\n", watcher->filename);
+    long long served_before = served_count();
+    double start_time = now_seconds();
+
+    KvTable* table = parse_data_file(watcher->filename, watcher->threads, 1);
+    if (table == NULL) {
+        fprintf(log_out, "[监视] 重新加载失败，继续使用原来的数据\n");
+        reprint_prompt();
+        return;
+    }
+    watcher->size = size;
+    watcher->mtime = mtime;
+
+    double seconds = now_seconds() - start_time;
+    swap_table(table);
+    fprintf(log_out, "[监视] 已切换到新数据：%d 个键值对，用时 %.3f 秒，重新加载期间处理了 %lld 次查询\n",
+        table->entry_count, seconds, served_count() - served_before);
+    reprint_prompt();
+
+    // 只有本线程会替换当前表，table 在下次重新加载前一直有效；
+    // 旧表已释放，Windows 下也就不会因为缓存仍被映射而无法替换
+    if (watcher->use_cache && !save_index_cache(watcher->filename, table)) {
+        fprintf(log_out, "[监视] 警告：无法写入索引缓存\n");
+        reprint_prompt();
+    }
+}
+
+// 把数据文件名拆成目录和文件名两部分
+void split_watch_path(Watcher* watcher) {
+    const char* slash = strrchr(watcher->filename, '/');
+#ifdef _WIN32
+    const char* backslash = strrchr(watcher->filename, '\\');
+    if (backslash != NULL && (slash == NULL || backslash > slash)) {
+        slash = backslash;
+    }
+#endif
+    if (slash == NULL) {
+        snprintf(watcher->directory, sizeof(watcher->directory), ".");
+        watcher->basename = watcher->filename;
+    }
+    else {
+        // "/data.txt" 的目录是根目录
+        int length = slash == watcher->filename ? 1 : (int)(slash - watcher->filename);
+        snprintf(watcher->directory, sizeof(watcher->directory), "%.*s", length, watcher->filename);
+        watcher->basename = slash + 1;
+    }
+}
+
+int watch_thread(void* arg) {
+    Watcher* watcher = (Watcher*)arg;
+    split_watch_path(watcher);
+#ifdef _WIN32
+    watcher->change = FindFirstChangeNotificationA(watcher->directory, FALSE,
+        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE);
+    if (watcher->change == INVALID_HANDLE_VALUE) {
+        fprintf(log_out, "[监视] 错误：无法监视目录 '%s'\n", watcher->directory);
+        return 0;
+    }
+#else
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0 || inotify_add_watch(watcher->fd, watcher->directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(log_out, "[监视] 错误：无法监视目录 '%s'\n", watcher->directory);
+        if (watcher->fd >= 0) close(watcher->fd);
+        return 0;
+    }
+#endif
+
+    // 每 500 毫秒检查一次是否需要退出
+    while (!watch_stopped(watcher)) {
+        if (wait_for_change(watcher, 500)) {
+            reload_table(watcher);
+        }
+    }
+
+#ifdef _WIN32
+    FindCloseChangeNotification(watcher->change);
+#else
+    close(watcher->fd);
+#endif
+    return 0;
+}
+
+// ===== 写入 =====
+// SET/DELETE 立即修改覆盖表，并在数据文件旁的 data.log 末尾追加一条记录。
+// 记录先放在内存中，由 wal_commit() 一次写入并 fsync：交互模式每条命令提交一次，
+// 批量模式和服务器模式在输出结果前提交一次，所以连续的一批修改只需要一次 fsync。
+// 日志超过 compact_size 后在后台压缩：当前日志改名为 data.log.old，之后的修改写入新的 data.log，
+// 后台线程把数据文件和覆盖表的快照归并成新的 data.txt，替换完成后删除 data.log.old。
+// 新的 data.txt 在原文件的基础上逐行改写：被修改的键改写第一次出现的那一行的值，被删除的键删去所有出现的行，
+// 原文件中没有的键按键名顺序追加在末尾；注释、无效行和其他行原样保留（GBK 文件转换为 UTF-8 写出）。
+// 启动时依次重放 data.log.old 和 data.log；重放是幂等的，压缩中途退出也不会丢失修改
+
+#define WAL_SET 1
+#define WAL_DELETE 2
+
+// 日志记录头，后接键和值
+typedef struct {
+    uint32_t checksum;      // 从 op 开始的其余部分（含键和值）的校验
+    uint8_t op;
+    uint8_t key_len;
+    uint16_t reserved;
+    uint32_t value_len;
+} WalRecord;
+
+// 后台压缩的状态
+typedef struct {
+    thrd_t thread;
+    int running;
+    int done;               // 由 table_lock 保护
+    int failed;             // 失败后本次运行不再压缩，修改留在日志中
+    KvTable* result;        // 重新加载的表，失败时为 NULL
+    uint64_t seq;           // 快照包含的最大修改序号
+    OverlayItem* items;     // 覆盖表的快照，值是复制出来的
+    size_t item_count;
+} Compaction;
+
+// 数据文件和日志
+typedef struct {
+    const char* filename;
+    int threads;            // 压缩后重新解析使用的参数
+    int copy;
+    int use_cache;
+    char log_name[512];
+    char old_name[520];
+    FILE* log;              // NULL 表示无法写入
+    char* pending;          // 尚未提交的记录
+    size_t pending_len, pending_cap;
+    long long log_size;     // 日志文件已提交的大小
+    long long compact_size;
+} Store;
+
+Store store;
+Compaction compaction;
+
+// 确保缓冲区还能放下 extra 字节，超过 limit 或内存不足返回0
+int buffer_reserve(char** data, size_t len, size_t* capacity, size_t extra, size_t limit) {
+    if (len + extra <= *capacity) {
+        return 1;
+    }
+    size_t grown = *capacity ? *capacity : 4096;
+    while (grown < len + extra) grown *= 2;
+    if (grown > limit) {
+        if (len + extra > limit) return 0;
+        grown = limit;
+    }
+    char* buffer = (char*)realloc(*data, grown);
+    if (buffer == NULL) {
+        return 0;
+    }
+    *data = buffer;
+    *capacity = grown;
+    return 1;
+}
+
+// 把文件内容写入磁盘
+int sync_file(FILE* file) {
+    if (fflush(file) != 0) {
+        return 0;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// 改名后同步当前目录，保证改名本身也已写入磁盘（Windows 下不需要）
+void sync_directory() {
+#ifndef _WIN32
+    int dir = open(".", O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+#endif
+}
+
+// 用 temp_name 替换 filename
+int replace_file(const char* temp_name, const char* filename) {
+#ifdef _WIN32
+    if (!MoveFileExA(temp_name, filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        return 0;
+    }
+#else
+    if (rename(temp_name, filename) != 0) {
+        return 0;
+    }
+    sync_directory();
+#endif
+    return 1;
+}
+
+uint32_t wal_checksum(const WalRecord* record, const char* key, const char* value) {
+    uint64_t h = hash_bytes(&record->op, sizeof(WalRecord) - offsetof(WalRecord, op), 0);
+    h = hash_bytes(key, record->key_len, h);
+    h = hash_bytes(record->value_len ? value : "", record->value_len, h);
+    return (uint32_t)h;
+}
+
+// 在待提交的记录后追加一条，value 为 NULL 表示删除
+int wal_append(const uint64_t packed[2], const char* value, size_t value_len) {
+    const char* key = (const char*)packed;
+    WalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.op = value != NULL ? WAL_SET : WAL_DELETE;
+    record.key_len = (uint8_t)strnlen(key, MAX_KEY_LEN - 1);
+    record.value_len = value != NULL ? (uint32_t)value_len : 0;
+    record.checksum = wal_checksum(&record, key, value);
+
+    size_t total = sizeof(record) + record.key_len + record.value_len;
+    if (!buffer_reserve(&store.pending, store.pending_len, &store.pending_cap, total, (size_t)-1)) {
+        return 0;
+    }
+    char* p = store.pending + store.pending_len;
+    memcpy(p, &record, sizeof(record));
+    memcpy(p + sizeof(record), key, record.key_len);
+    if (record.value_len > 0) memcpy(p + sizeof(record) + record.key_len, value, record.value_len);
+    store.pending_len += total;
+    return 1;
+}
+
+// 把一个日志文件重放到覆盖表，返回有效记录的总长度；遇到不完整或损坏的记录时停止
+long long wal_replay(const char* name, int* records) {
+    FileView view;
+    *records = 0;
+    if (!open_view(name, &view, 1)) {
+        return 0;
+    }
+    size_t pos = 0;
+    while (view.size - pos >= sizeof(WalRecord)) {
+        WalRecord record;
+        memcpy(&record, view.data + pos, sizeof(record));
+        if (view.size - pos - sizeof(record) < (size_t)record.key_len + record.value_len) {
+            break;
+        }
+        const char* key = view.data + pos + sizeof(record);
+        const char* value = key + record.key_len;
+        uint64_t packed[2];
+        if (record.checksum != wal_checksum(&record, key, value) || record.key_len == 0 ||
+            (record.op != WAL_SET && record.op != WAL_DELETE) || !pack_key(key, record.key_len, packed)) {
+            break;
+        }
+        char* copy = NULL;
+        if (record.op == WAL_SET) {
+            copy = (char*)malloc(record.value_len ? record.value_len : 1);
+            if (copy == NULL) break;
+            memcpy(copy, value, record.value_len);
+        }
+        if (!overlay_put(packed, copy, record.value_len)) {
+            free(copy);
+            break;
+        }
+        pos += sizeof(record) + record.key_len + record.value_len;
+        (*records)++;
+    }
+    close_view(&view);
+    return (long long)pos;
+}
+
+// 把整个覆盖表写成一个新的日志，替换 data.log
+int wal_rewrite() {
+    char temp_name[530];
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", store.log_name);
+    store.pending_len = 0;
+    for (size_t i = 0; i < overlay.capacity; i++) {
+        const OverlayEntry* entry = &overlay.slots[i];
+        if (entry->used && !wal_append(entry->key, entry->value, entry->value_len)) {
+            return 0;
+        }
+    }
+    FILE* file = fopen(temp_name, "wb");
+    int ok = file != NULL && fwrite(store.pending, 1, store.pending_len, file) == store.pending_len && sync_file(file);
+    if (file != NULL) ok = fclose(file) == 0 && ok;
+    ok = ok && replace_file(temp_name, store.log_name);
+    if (!ok) {
+        remove(temp_name);
+    }
+    store.log_size = (long long)store.pending_len;
+    store.pending_len = 0;
+    return ok;
+}
+
+// 重放日志并打开 data.log 准备追加；日志末尾有损坏的记录（上次写入中途停止）
+// 或者上次压缩没有完成时，把恢复出的修改整理成一个新的 data.log
+void wal_open(const char* filename, int threads, int copy, int use_cache, long long compact_size) {
+    store.filename = filename;
+    store.threads = threads;
+    store.copy = copy;
+    store.use_cache = use_cache;
+    store.compact_size = compact_size;
+    sibling_file_name(filename, ".log", store.log_name, sizeof(store.log_name));
+    snprintf(store.old_name, sizeof(store.old_name), "%s.old", store.log_name);
+
+    int old_records, records;
+    uint64_t old_size = 0, size = 0;
+    int64_t mtime;
+    int has_old = source_stat(store.old_name, &old_size, &mtime);
+    wal_replay(store.old_name, &old_records);
+    long long valid = wal_replay(store.log_name, &records);
+    source_stat(store.log_name, &size, &mtime);
+    store.log_size = valid;
+
+    if (old_records + records > 0) {
+        fprintf(log_out, "已从日志恢复 %d 条修改\n", old_records + records);
+    }
+    if ((long long)size > valid) {
+        fprintf(log_out, "警告：日志 '%s' 末尾有 %lld 字节不完整，已丢弃\n", store.log_name, (long long)size - valid);
+    }
+    if (has_old || (long long)size > valid) {
+        if (!wal_rewrite()) {
+            fprintf(log_out, "错误：无法整理日志 '%s'，本次运行不能修改数据\n\n", store.log_name);
+            return;
+        }
+        remove(store.old_name);
+    }
+
+    store.log = fopen(store.log_name, "ab");
+    sync_directory();
+    if (store.log == NULL) {
+        fprintf(log_out, "错误：无法打开日志 '%s'，本次运行不能修改数据\n", store.log_name);
+    }
+    if (old_records + records > 0 || store.log == NULL) {
+        fprintf(log_out, "\n");
+    }
+}
+
+// 在快照（按有序索引的键排序）中查找键，没有返回 NULL
+OverlayItem* find_compaction_item(const uint64_t packed[2]) {
+    uint64_t key[2];
+    order_key(packed, key);
+    size_t lo = 0, hi = compaction.item_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (order_less(compaction.items[mid].order, key)) lo = mid + 1;
+        else hi = mid;
+    }
+    OverlayItem* item = lo < compaction.item_count ? &compaction.items[lo] : NULL;
+    return item != NULL && item->order[0] == key[0] && item->order[1] == key[1] ? item : NULL;
+}
+
+// 把快照中的修改应用到原数据文件的文本上写入 out。行的识别与 parse_chunk() 相同：
+// 有效行中被修改的键只改写第一次出现的那一行的值（前后的空白和换行符不变，后面的重复行本来就不生效），
+// 被删除的键删去所有出现的行；其他行原样写出，原文件中没有的键最后按键名顺序追加
+int rewrite_data_file(const char* data, size_t size, FILE* out, size_t* changed, size_t* removed, size_t* added) {
+    char* seen = (char*)calloc(compaction.item_count ? compaction.item_count : 1, 1);
+    if (seen == NULL) {
+        return 0;
+    }
+    int ok = 1;
+    const char* p = data;
+    const char* end = data + size;
+    while (ok && p < end) {
+        const char* line = p;
+        const char* line_end = find_byte(p, end, '\n');
+        p = line_end < end ? line_end + 1 : end;
+
+        const char* start = line;
+        trim_view(&start, &line_end);
+        size_t colon_len;
+        const char* colon = find_colon(start, line_end, &colon_len);
+        const char* key = start;
+        const char* key_end = colon;
+        const char* value = colon + colon_len;
+        const char* value_end = line_end;
+        trim_view(&key, &key_end);
+        trim_view(&value, &value_end);
+
+        OverlayItem* item = NULL;
+        uint64_t packed[2];
+        if (colon != line_end && value != value_end && is_valid_key(key, key_end - key)) {
+            pack_key(key, key_end - key, packed);
+            item = find_compaction_item(packed);
+        }
+        if (item == NULL) {
+            ok = fwrite(line, 1, p - line, out) == (size_t)(p - line);
+        }
+        else if (item->value == NULL) {
+            (*removed)++;
+        }
+        else if (seen[item - compaction.items]) {
+            ok = fwrite(line, 1, p - line, out) == (size_t)(p - line);
+        }
+        else {
+            seen[item - compaction.items] = 1;
+            (*changed)++;
+            ok = fwrite(line, 1, value - line, out) == (size_t)(value - line) &&
+                fwrite(item->value, 1, item->value_len, out) == item->value_len &&
+                fwrite(value_end, 1, p - value_end, out) == (size_t)(p - value_end);
+        }
+    }
+
+    // 追加原文件中没有的键；最后一行没有换行符时先补上
+    if (ok && size > 0 && data[size - 1] != '\n') {
+        int has_new = 0;
+        for (size_t i = 0; i < compaction.item_count && !has_new; i++) {
+            has_new = compaction.items[i].value != NULL && !seen[i];
+        }
+        ok = !has_new || fputc('\n', out) != EOF;
+    }
+    for (size_t i = 0; ok && i < compaction.item_count; i++) {
+        const OverlayItem* item = &compaction.items[i];
+        if (item->value == NULL || seen[i]) continue;
+        char key[MAX_KEY_LEN + 6];
+        memcpy(key, item->key, sizeof(item->key));
+        key[sizeof(item->key)] = '\0';
+        ok = fprintf(out, "%s:", key) > 0 &&
+            fwrite(item->value, 1, item->value_len, out) == item->value_len &&
+            fputc('\n', out) != EOF;
+        (*added)++;
+    }
+    free(seen);
+    return ok;
+}
+
+// 后台压缩：把覆盖表的快照应用到数据文件上写成新的数据文件，替换后重新加载
+int compaction_thread(void* arg) {
+    (void)arg;
+    char temp_name[512];
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", store.filename);
+    double start_time = now_seconds();
+
+    // 重新读入原文件（而不是用当前表），注释、无效行和重复键都在原文件中
+    size_t changed = 0, removed = 0, added = 0;
+    KvTable source;
+    memset(&source, 0, sizeof(source));
+    int ok = open_view(store.filename, &source.view, store.copy);
+    int converted = 0;
+    if (ok) {
+        source.values = source.view.data;
+        source.values_size = source.view.size;
+        int bom = source.values_size >= 3 && memcmp(source.values, "\xEF\xBB\xBF", 3) == 0;
+        ok = detect_encoding(&source, parse_threads(source.values_size, store.threads));
+        converted = source.converted != NULL;
+        FILE* file = ok ? fopen(temp_name, "wb") : NULL;
+        ok = file != NULL && (!bom || fwrite("\xEF\xBB\xBF", 1, 3, file) == 3) &&
+            rewrite_data_file(source.values, source.values_size, file, &changed, &removed, &added);
+        if (file != NULL) {
+            ok = sync_file(file) && ok;
+            ok = fclose(file) == 0 && ok;
+        }
+        free(source.converted);
+        close_view(&source.view);
+    }
+
+    // 新数据文件已经包含 data.log.old 中的所有修改，替换后才能删除旧日志
+    KvTable* table = NULL;
+    if (ok && replace_file(temp_name, store.filename)) {
+        remove(store.old_name);
+        fprintf(log_out, "\n[压缩] 已写回数据文件：改写 %zu 行，删除 %zu 行，追加 %zu 行%s，用时 %.3f 秒，正在重新加载...\n",
+            changed, removed, added, converted ? "（GBK 已转换为 UTF-8）" : "", now_seconds() - start_time);
+        table = parse_data_file(store.filename, store.threads, store.copy);
+        if (table != NULL && store.use_cache && !save_index_cache(store.filename, table)) {
+            fprintf(log_out, "[压缩] 警告：无法写入索引缓存\n");
+        }
+    }
+    else {
+        remove(temp_name);
+    }
+    if (table == NULL) {
+        fprintf(log_out, "\n[压缩] 失败，修改保留在日志中\n");
+    }
+
+    mtx_lock(&table_lock);
+    compaction.result = table;
+    compaction.done = 1;
+    mtx_unlock(&table_lock);
+    reprint_prompt();
+    return 0;
+}
+
+void free_compaction_items() {
+    for (size_t i = 0; i < compaction.item_count; i++) {
+        free((char*)compaction.items[i].value);
+    }
+    free(compaction.items);
+    compaction.items = NULL;
+    compaction.item_count = 0;
+}
+
+// 取覆盖表的快照，切换日志后启动后台压缩
+void start_compaction() {
+    uint64_t from[2] = { 0, 0 }, to[2] = { UINT64_MAX, UINT64_MAX };
+    compaction.items = overlay_items(from, to, &compaction.item_count);
+    if (compaction.items == NULL) {
+        return;
+    }
+    // 快照中的值复制出来，压缩期间覆盖表可以继续修改
+    for (size_t i = 0; i < compaction.item_count; i++) {
+        OverlayItem* item = &compaction.items[i];
+        if (item->value == NULL) continue;
+        char* copy = (char*)malloc(item->value_len ? item->value_len : 1);
+        if (copy == NULL) {
+            for (size_t j = i; j < compaction.item_count; j++) compaction.items[j].value = NULL;
+            free_compaction_items();
+            return;
+        }
+        memcpy(copy, item->value, item->value_len);
+        item->value = copy;
+    }
+
+    fclose(store.log);
+    int renamed = rename(store.log_name, store.old_name) == 0;
+    store.log = fopen(store.log_name, "ab");
+    if (renamed) {
+        store.log_size = 0;
+        sync_directory(); // 新日志的目录项也要写入磁盘，之后提交的修改才不会丢失
+    }
+    compaction.seq = write_seq;
+    compaction.done = 0;
+    compaction.result = NULL;
+    compaction.running = renamed && store.log != NULL &&
+        thrd_create(&compaction.thread, compaction_thread, NULL) == thrd_success;
+    if (!compaction.running) {
+        fprintf(log_out, "[压缩] 错误：无法开始压缩，修改保留在日志中\n");
+        free_compaction_items();
+        compaction.failed = 1;
+        return;
+    }
+    fprintf(log_out, "[压缩] 日志已达到 %lld 字节，开始在后台压缩（%zu 项修改）\n", store.compact_size, compaction.item_count);
+}
+
+// 压缩完成后换用新表，并从覆盖表中删除已写入数据文件的项；wait 为1时等待压缩完成
+void check_compaction(int wait) {
+    if (!compaction.running) {
+        return;
+    }
+    mtx_lock(&table_lock);
+    int done = compaction.done;
+    mtx_unlock(&table_lock);
+    if (!done && !wait) {
+        return;
+    }
+
+    thrd_join(compaction.thread, NULL);
+    compaction.running = 0;
+    free_compaction_items();
+    if (compaction.result == NULL) {
+        compaction.failed = 1;
+        return;
+    }
+    swap_table(compaction.result);
+    overlay_rebuild(overlay.capacity, compaction.seq);
+    fprintf(log_out, "[压缩] 已切换到新数据，覆盖表中还有 %zu 项修改\n", overlay.count);
+    fflush(log_out);
+}
+
+// 后台压缩是否在进行，服务器据此缩短事件等待时间以便及时切换
+int compaction_running() {
+    return compaction.running;
+}
+
+// 一次写入并 fsync 所有待提交的记录，失败返回0
+int wal_commit() {
+    if (store.pending_len == 0) {
+        return 1;
+    }
+    int ok = store.log != NULL && fwrite(store.pending, 1, store.pending_len, store.log) == store.pending_len &&
+        sync_file(store.log);
+    if (!ok) {
+        fprintf(log_out, "错误：无法写入日志 '%s'\n", store.log_name);
+    }
+    store.log_size += (long long)store.pending_len;
+    store.pending_len = 0;
+    if (ok && store.log_size >= store.compact_size && !compaction.running && !compaction.failed) {
+        start_compaction();
+    }
+    return ok;
+}
+
+// 退出前等待压缩完成并提交所有修改
+void close_store() {
+    compaction.failed = 1; // 退出时不再开始新的压缩
+    wal_commit();
+    check_compaction(1);
+    if (store.log != NULL) fclose(store.log);
+    free(store.pending);
+    memset(&store, 0, sizeof(store));
+    overlay_free();
+}
+
+// 修改一个键，value 为 NULL 表示删除；键或值无效、删除不存在的键时返回0。
+// 修改在下次 wal_commit() 后才写入磁盘
+int store_write(const KvTable* table, const char* key, size_t key_len, const char* value, size_t value_len) {
+    uint64_t packed[2];
+    // 键不能含冒号（半角或全角），值不能为空或含换行，键和值都必须是有效的 UTF-8，
+    // 否则写回数据文件后无法按原样解析
+    size_t colon_len;
+    if (store.log == NULL || !is_valid_key(key, key_len) || find_colon(key, key + key_len, &colon_len) != key + key_len ||
+        !utf8_valid(key, key_len) || !pack_key(key, key_len, packed)) {
+        return 0;
+    }
+    char* copy = NULL;
+    if (value != NULL) {
+        const char* value_end = value + value_len;
+        trim_view(&value, &value_end);
+        value_len = (size_t)(value_end - value);
+        if (value_len == 0 || value_len > UINT32_MAX / 2 || !utf8_valid(value, value_len) ||
+            memchr(value, '\n', value_len) != NULL || memchr(value, '\r', value_len) != NULL) {
+            return 0;
+        }
+        copy = (char*)malloc(value_len);
+        if (copy == NULL) {
+            return 0;
+        }
+        memcpy(copy, value, value_len);
+    }
+    else {
+        size_t old_len;
+        if (lookup_value(table, packed, hash_key(packed), &old_len) == NULL) {
+            return 0;
+        }
+    }
+
+    if (!wal_append(packed, copy, value_len) || !overlay_put(packed, copy, (uint32_t)value_len)) {
+        free(copy);
+        return 0;
+    }
+    return 1;
+}
+
+// 处理 "SET <键> <值>" 和 "DELETE <键>"，返回要输出的结果；line 不是这两种命令时返回 NULL。
+// 后面没有参数的 SET、DELETE 是普通的键，交给调用者查询
+const char* write_command(const KvTable* table, const char* line, const char* end) {
+    const char* command_end = find_space(line, end);
+    size_t command_len = (size_t)(command_end - line);
+    int is_set = command_len == 3 && memcmp(line, "SET", 3) == 0;
+    int is_delete = command_len == 6 && memcmp(line, "DELETE", 6) == 0;
+    if (!is_set && !is_delete) {
+        return NULL;
+    }
+
+    const char* key = command_end;
+    while (key < end && isspace((unsigned char)*key)) key++;
+    if (key == end) {
+        return NULL;
+    }
+    const char* key_end = find_space(key, end);
+    const char* value = key_end;
+    while (value < end && isspace((unsigned char)*value)) value++;
+    if (is_set ? value == end : value != end) {
+        return "Error";
+    }
+    return store_write(table, key, key_end - key, is_set ? value : NULL, end - value) ? "OK" : "Error";
+}
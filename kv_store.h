@@ -0,0 +1,64 @@
+﻿#ifndef KV_STORE_H
+#define KV_STORE_H
+
+// 键值存储：当前表的热替换、数据文件监视和写入
+//
+// 查询通过 acquire_table()/release_table() 持有当前表的引用，监视线程或后台压缩建立新表后
+// 用 swap_table() 整体替换。SET/DELETE 先写覆盖表，再追加到数据文件旁的 data.log，
+// 由 wal_commit() 一次写入并 fsync；日志过大时在后台把修改归并回数据文件。
+
+#include "kv_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COMPACT_LOG_SIZE (16 * 1024 * 1024) // 日志默认超过此大小时在后台压缩
+
+// 监视线程的状态；监视数据文件所在的整个目录，以便发现改名替换的写法
+typedef struct {
+    const char* filename;
+    char directory[1024];   // 数据文件所在目录，没有目录部分时为 "."
+    const char* basename;   // filename 中的文件名部分，目录事件只带这一部分
+    int threads;
+    int use_cache;
+    int stop;               // 由 table_lock 保护
+    uint64_t size;          // 最近一次加载时数据文件的大小和修改时间
+    int64_t mtime;
+#ifdef _WIN32
+    HANDLE change;
+#else
+    int fd;
+#endif
+} Watcher;
+
+extern mtx_t table_lock;    // 保护当前表、各表的引用计数、查询计数和 Watcher.stop，由 main() 初始化
+
+// 当前表
+KvTable* acquire_table(int queries);
+void release_table(KvTable* table);
+void swap_table(KvTable* table);
+void count_queries(int queries);
+long long served_count();
+
+// 监视线程，arg 为 Watcher*，stop 置 1 后退出
+int watch_thread(void* arg);
+
+// 确保缓冲区还能放下 extra 字节，超过 limit 或内存不足返回0
+int buffer_reserve(char** data, size_t len, size_t* capacity, size_t extra, size_t limit);
+
+// 写入：先 wal_open() 重放日志，修改后 wal_commit() 提交，退出前 close_store()
+void wal_open(const char* filename, int threads, int copy, int use_cache, long long compact_size);
+int wal_commit();
+void check_compaction(int wait);
+int compaction_running();
+void close_store();
+int store_write(const KvTable* table, const char* key, size_t key_len, const char* value, size_t value_len);
+// SET/DELETE 行的结果（"OK" 或 "Error"），不是带参数的写命令时返回 NULL
+const char* write_command(const KvTable* table, const char* line, const char* end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1889 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <limits.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <iconv.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "kv_table.h"
+
+#define MAX_THREADS 64       // 并行解析的最大线程数
+#define PARALLEL_MIN_SIZE (64 * 1024 * 1024) // 默认超过此大小的文件才并行解析
+#define RADIX_MIN_COUNT 65536 // 有序索引每段超过此数量时用基数排序
+
+FILE* log_out;              // 解析、缓存和监视的提示信息；批量模式下为 stderr，不混入查询结果
+
+
+// 解析警告，解析结束后按行号排序输出
+typedef enum {
+    WARN_NO_COLON,
+    WARN_BAD_KEY,
+    WARN_EMPTY_VALUE,
+    WARN_DUPLICATE
+} WarningType;
+
+typedef struct {
+    int line;
+    WarningType type;
+    size_t offset;          // 要显示的文本（行或键）在映射中的位置
+    uint32_t len;
+    char key[MAX_KEY_LEN];  // WARN_DUPLICATE 显示的键
+} Warning;
+
+// 按需扩容的数组
+typedef struct {
+    void* data;
+    size_t count;
+    size_t capacity;
+} Array;
+
+// 一个解析块：[start, end) 从行首开始、在换行符后结束
+typedef struct {
+    const char* start;
+    const char* end;
+    int lines;              // 块内行数
+    int line_base;          // 块之前的总行数
+    Array* candidates;      // 每个分区一个数组，元素为 IndexSlot，按行号顺序
+    Array warnings;         // 格式错误，元素为 Warning
+    int failed;             // 内存不足
+    KvTable* table;
+} ParseChunk;
+
+// 第二阶段每个分区的结果
+typedef struct {
+    int index;
+    KvTable* table;
+    ParseChunk* chunks;
+    int chunk_count;
+    Array duplicates;       // 重复键警告
+    int failed;
+} PartitionJob;
+
+// p 处空白字符的字节数，不是空白字符时返回0。除 ASCII 空白外还识别 UTF-8 编码的 Unicode 空白：
+// U+0085、U+00A0、U+1680、U+2000–U+200A、U+2028、U+2029、U+202F、U+205F 和全角空格 U+3000
+size_t space_at(const char* p, const char* end) {
+    const unsigned char* u = (const unsigned char*)p;
+    if (u[0] < 0x80) {
+        return isspace(u[0]) ? 1 : 0;
+    }
+    size_t left = (size_t)(end - p);
+    if (u[0] == 0xC2) {
+        return left >= 2 && (u[1] == 0x85 || u[1] == 0xA0) ? 2 : 0;
+    }
+    if (left < 3 || (u[2] & 0xC0) != 0x80) {
+        return 0;
+    }
+    switch (u[0]) {
+    case 0xE1:
+        return u[1] == 0x9A && u[2] == 0x80 ? 3 : 0;
+    case 0xE2:
+        return (u[1] == 0x80 && (u[2] <= 0x8A || u[2] == 0xA8 || u[2] == 0xA9 || u[2] == 0xAF)) ||
+            (u[1] == 0x81 && u[2] == 0x9F) ? 3 : 0;
+    case 0xE3:
+        return u[1] == 0x80 && u[2] == 0x80 ? 3 : 0;
+    default:
+        return 0;
+    }
+}
+
+// 紧接在 p 之前（不早于 start）的空白字符的字节数
+size_t space_before(const char* start, const char* p) {
+    unsigned char c = (unsigned char)p[-1];
+    if (c < 0x80) {
+        return isspace(c) ? 1 : 0;
+    }
+    if (p - start >= 2 && space_at(p - 2, p) == 2) return 2;
+    if (p - start >= 3 && space_at(p - 3, p) == 3) return 3;
+    return 0;
+}
+
+// 去除 [*start, *end) 首尾的空白字符，只移动边界不修改内容
+void trim_view(const char** start, const char** end) {
+    size_t n;
+    while (*start < *end && (n = space_at(*start, *end)) > 0) *start += n;
+    while (*end > *start && (n = space_before(*start, *end)) > 0) *end -= n;
+}
+
+// 去除字符串首尾的空白字符
+void trim_whitespace(char* str) {
+    if (str == NULL || *str == '\0') return;
+
+    const char* start = str;
+    const char* end = str + strlen(str);
+    trim_view(&start, &end);
+
+    memmove(str, start, end - start);
+    str[end - start] = '\0';
+}
+
+// [p, end) 中第一个空白字符，没有时返回 end
+const char* find_space(const char* p, const char* end) {
+    while (p < end && !isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+// 检查键是否有效（不超过10字节，不含空格）
+int is_valid_key(const char* key, size_t len) {
+    if (len == 0) {
+        return 0; // 空键无效
+    }
+
+    if (len > 10) {
+        return 0; // 超过10字符
+    }
+
+    // 检查是否包含空格（包括全角空格等 Unicode 空白）
+    for (size_t i = 0; i < len; i++) {
+        if (space_at(key + i, key + len) > 0) {
+            return 0; // 包含空格
+        }
+    }
+
+    return 1; // 键有效
+}
+
+// 非零的 mask 中最低的 1 位的位置（块比较的 movemask 结果转换为块内偏移）
+unsigned ctz32(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+    return (unsigned)bit;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// 在 [p, end) 中查找字节 c，找不到时返回 end
+// 每次比较 32 字节（AVX2）或 16 字节（SSE2），剩余部分逐字节比较
+const char* find_byte(const char* p, const char* end, char c) {
+#if defined(__AVX2__)
+    __m256i needle = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+        if (mask != 0) {
+            return p + ctz32(mask);
+        }
+        p += 32;
+    }
+#elif defined(SCAN_SSE2)
+    __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask != 0) {
+            return p + ctz32(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != c) p++;
+    return p;
+}
+
+// 在 [p, end) 中查找第一个分隔符：半角冒号或全角冒号 U+FF1A（UTF-8 为 EF BC 9A），
+// 找不到时返回 end；分隔符的字节数写入 len。与 find_byte() 一样按块比较，每块同时比较两种首字节
+const char* find_colon(const char* p, const char* end, size_t* len) {
+    while (1) {
+#if defined(__AVX2__)
+        __m256i colon = _mm256_set1_epi8(':');
+        __m256i wide = _mm256_set1_epi8((char)0xEF);
+        while (end - p >= 32) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+            unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(chunk, colon), _mm256_cmpeq_epi8(chunk, wide)));
+            if (mask != 0) {
+                p += ctz32(mask);
+                break;
+            }
+            p += 32;
+        }
+#elif defined(SCAN_SSE2)
+        __m128i colon = _mm_set1_epi8(':');
+        __m128i wide = _mm_set1_epi8((char)0xEF);
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, wide)));
+            if (mask != 0) {
+                p += ctz32(mask);
+                break;
+            }
+            p += 16;
+        }
+#endif
+        while (p < end && *p != ':' && (unsigned char)*p != 0xEF) p++;
+        if (p == end) {
+            *len = 0;
+            return end;
+        }
+        if (*p == ':') {
+            *len = 1;
+            return p;
+        }
+        if (end - p >= 3 && (unsigned char)p[1] == 0xBC && (unsigned char)p[2] == 0x9A) {
+            *len = 3;
+            return p;
+        }
+        p++; // 其他以 EF 开头的字符，例如全角逗号
+    }
+}
+
+// 映射整个文件，文件无法打开时返回0；映射失败时 view->mapped 为0
+int map_file(const char* filename, FileView* view) {
+#ifdef _WIN32
+    view->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (view->file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(view->file, &size);
+    view->size = (size_t)size.QuadPart;
+    if (view->size == 0) {
+        return 1;
+    }
+    view->mapping = CreateFileMappingA(view->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (view->mapping != NULL) {
+        view->data = (const char*)MapViewOfFile(view->mapping, FILE_MAP_READ, 0, 0, 0);
+        view->mapped = view->data != NULL;
+    }
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        return 0;
+    }
+    view->size = (size_t)file_stat.st_size;
+    if (view->size == 0) {
+        close(fd);
+        return 1;
+    }
+    void* data = mmap(NULL, view->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data != MAP_FAILED) {
+        view->data = (const char*)data;
+        view->mapped = 1;
+        madvise(data, view->size, MADV_SEQUENTIAL);
+    }
+#endif
+    return 1;
+}
+
+// 打开整个文件，成功返回1；copy 为1时读入内存而不映射，
+// 这样文件被其他程序就地改写或截断时不影响已读入的内容，Windows 下也不会阻止其他程序保存
+int open_view(const char* filename, FileView* view, int copy) {
+    memset(view, 0, sizeof(*view));
+    if (copy) {
+        struct stat file_stat;
+        if (stat(filename, &file_stat) != 0) {
+            return 0;
+        }
+        view->size = (size_t)file_stat.st_size;
+    }
+    else if (!map_file(filename, view)) {
+        return 0;
+    }
+    if (view->mapped || view->size == 0) {
+        return 1;
+    }
+
+    // 无法映射时整体读入内存
+    FILE* file = fopen(filename, "rb");
+    char* buffer = (char*)malloc(view->size);
+    if (file == NULL || buffer == NULL || fread(buffer, 1, view->size, file) != view->size) {
+        if (file != NULL) fclose(file);
+        free(buffer);
+        return 0;
+    }
+    fclose(file);
+    view->data = buffer;
+    return 1;
+}
+
+void close_view(FileView* view) {
+#ifdef _WIN32
+    if (view->mapped) UnmapViewOfFile(view->data);
+    else free((void*)view->data);
+    if (view->mapping != NULL) CloseHandle(view->mapping);
+    if (view->file != NULL && view->file != INVALID_HANDLE_VALUE) CloseHandle(view->file);
+#else
+    if (view->mapped) munmap((void*)view->data, view->size);
+    else free((void*)view->data);
+#endif
+    memset(view, 0, sizeof(*view));
+}
+
+// 为数组再留出一个元素的空间，返回该元素，内存不足返回 NULL
+void* array_push(Array* array, size_t item_size) {
+    if (array->count == array->capacity) {
+        size_t capacity = array->capacity ? array->capacity * 2 : 64;
+        void* grown = realloc(array->data, capacity * item_size);
+        if (grown == NULL) {
+            return NULL;
+        }
+        array->data = grown;
+        array->capacity = capacity;
+    }
+    return (char*)array->data + item_size * array->count++;
+}
+
+// 把键装入 16 字节，键过长（不可能存在）时返回0
+int pack_key(const char* key, size_t len, uint64_t packed[2]) {
+    if (len >= MAX_KEY_LEN) {
+        return 0;
+    }
+    packed[0] = 0;
+    packed[1] = 0;
+    memcpy(packed, key, len);
+    return 1;
+}
+
+// 键的哈希值：两个字分别乘以奇数常量后混合
+uint64_t hash_key(const uint64_t packed[2]) {
+    uint64_t h = packed[0] * 0x9E3779B97F4A7C15ull ^ packed[1] * 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+    return h;
+}
+
+// 键所属的分区（用哈希值高位，槽位置用低位）
+int partition_of(const KvTable* table, uint64_t hash) {
+    return (int)((hash >> 40) % (uint64_t)table->partition_count);
+}
+
+// 在一个分区中查找键所在的槽：键存在时返回它的槽，否则返回插入该键应使用的空槽
+IndexSlot* partition_lookup(IndexPartition* partition, const uint64_t packed[2], uint64_t hash) {
+    size_t mask = partition->capacity - 1;
+    size_t i = (size_t)hash & mask;
+    while (partition->slots[i].value_len != 0 &&
+        (partition->slots[i].key[0] != packed[0] || partition->slots[i].key[1] != packed[1])) {
+        i = (i + 1) & mask;
+    }
+    return &partition->slots[i];
+}
+
+IndexSlot* index_lookup(const KvTable* table, const uint64_t packed[2]) {
+    uint64_t hash = hash_key(packed);
+    return partition_lookup(&table->partitions[partition_of(table, hash)], packed, hash);
+}
+
+// 检查键是否已存在
+int key_exists(const KvTable* table, const char* key) {
+    uint64_t packed[2];
+    if (!pack_key(key, strlen(key), packed) || table->partitions == NULL) {
+        return 0;
+    }
+    return index_lookup(table, packed)->value_len != 0;
+}
+
+// 记录一条警告，文本为 [text, text + len)
+int add_warning(Array* warnings, const KvTable* table, int line, WarningType type, const char* text, size_t len) {
+    Warning* warning = (Warning*)array_push(warnings, sizeof(Warning));
+    if (warning == NULL) {
+        return 0;
+    }
+    memset(warning, 0, sizeof(*warning));
+    warning->line = line;
+    warning->type = type;
+    warning->offset = (size_t)(text - table->values);
+    warning->len = (uint32_t)len;
+    return 1;
+}
+
+// 第一阶段：解析一个块，格式正确的键值对按分区放入候选数组
+int parse_chunk(void* arg) {
+    ParseChunk* chunk = (ParseChunk*)arg;
+    const char* p = chunk->start;
+    const char* end = chunk->end;
+    int line_number = 0;
+
+    while (p < end) {
+        const char* line = p;
+        const char* line_end = find_byte(p, end, '\n');
+        p = line_end < end ? line_end + 1 : end;
+        line_number++;
+
+        // 去除行首尾的空白字符和换行符
+        trim_view(&line, &line_end);
+
+        // 跳过空行
+        if (line == line_end) {
+            continue;
+        }
+
+        // 查找冒号分隔符（半角或全角）
+        size_t colon_len;
+        const char* colon = find_colon(line, line_end, &colon_len);
+        if (colon == line_end) {
+            if (!add_warning(&chunk->warnings, chunk->table, line_number, WARN_NO_COLON, line, line_end - line)) break;
+            continue;
+        }
+
+        // 通过冒号分割前后部分
+        const char* key = line;
+        const char* key_end = colon;
+        const char* value = colon + colon_len;
+        const char* value_end = line_end;
+
+        trim_view(&key, &key_end);
+        trim_view(&value, &value_end);
+
+        // 检查键的有效性和值是否为空，重复键在第二阶段检查
+        if (!is_valid_key(key, key_end - key)) {
+            if (!add_warning(&chunk->warnings, chunk->table, line_number, WARN_BAD_KEY, key, key_end - key)) break;
+            continue;
+        }
+
+        if (value == value_end) {
+            if (!add_warning(&chunk->warnings, chunk->table, line_number, WARN_EMPTY_VALUE, value, 0)) break;
+            continue;
+        }
+
+        // 键已通过 is_valid_key() 检查，一定能装入 16 字节
+        IndexSlot candidate;
+        pack_key(key, key_end - key, candidate.key);
+        candidate.value_offset = (uint64_t)(value - chunk->table->values);
+        candidate.value_len = (uint32_t)(value_end - value);
+        candidate.line = (uint32_t)line_number;
+
+        Array* target = &chunk->candidates[partition_of(chunk->table, hash_key(candidate.key))];
+        IndexSlot* slot = (IndexSlot*)array_push(target, sizeof(IndexSlot));
+        if (slot == NULL) break;
+        *slot = candidate;
+    }
+
+    chunk->lines = line_number;
+    chunk->failed = p < end;
+    return 0;
+}
+
+// 第二阶段：按块顺序（即行号顺序）把一个分区的候选插入索引，先出现的键生效
+int build_partition(void* arg) {
+    PartitionJob* job = (PartitionJob*)arg;
+    IndexPartition* partition = &job->table->partitions[job->index];
+    ParseChunk* chunks = job->chunks;
+
+    size_t total = 0;
+    for (int c = 0; c < job->chunk_count; c++) {
+        total += chunks[c].candidates[job->index].count;
+    }
+    partition->capacity = 16;
+    while (partition->capacity < total * 2) {
+        partition->capacity *= 2;
+    }
+    partition->slots = (IndexSlot*)calloc(partition->capacity, sizeof(IndexSlot));
+    if (partition->slots == NULL) {
+        partition->capacity = 0;
+        job->failed = 1;
+        return 0;
+    }
+
+    for (int c = 0; c < job->chunk_count; c++) {
+        Array* candidates = &chunks[c].candidates[job->index];
+        IndexSlot* items = (IndexSlot*)candidates->data;
+        for (size_t i = 0; i < candidates->count; i++) {
+            uint64_t hash = hash_key(items[i].key);
+            IndexSlot* slot = partition_lookup(partition, items[i].key, hash);
+            if (slot->value_len != 0) {
+                Warning* warning = (Warning*)array_push(&job->duplicates, sizeof(Warning));
+                if (warning == NULL) {
+                    job->failed = 1;
+                    return 0;
+                }
+                memset(warning, 0, sizeof(*warning));
+                warning->line = chunks[c].line_base + (int)items[i].line;
+                warning->type = WARN_DUPLICATE;
+                memcpy(warning->key, items[i].key, MAX_KEY_LEN - 1);
+                continue;
+            }
+            *slot = items[i];
+            partition->count++;
+        }
+        free(candidates->data);
+        candidates->data = NULL;
+    }
+    return 0;
+}
+
+int compare_warning(const void* a, const void* b) {
+    int x = ((const Warning*)a)->line, y = ((const Warning*)b)->line;
+    return (x > y) - (x < y);
+}
+
+void print_warning(const KvTable* table, const Warning* warning) {
+    const char* text = table->values + warning->offset;
+    switch (warning->type) {
+    case WARN_NO_COLON:
+        fprintf(log_out, "警告：第 %d 行格式错误（缺少冒号）：%.*s\n", warning->line, (int)warning->len, text);
+        break;
+    case WARN_BAD_KEY:
+        fprintf(log_out, "警告：第 %d 行键无效：%.*s\n", warning->line, (int)warning->len, text);
+        break;
+    case WARN_EMPTY_VALUE:
+        fprintf(log_out, "警告：第 %d 行值为空\n", warning->line);
+        break;
+    case WARN_DUPLICATE:
+        fprintf(log_out, "警告：第 %d 行键重复：%s\n", warning->line, warning->key);
+        break;
+    }
+}
+
+// 处理器核心数
+int cpu_count() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// 在 threads 个线程上运行 func(args[i])，第 0 份在当前线程运行
+void run_parallel(int threads, thrd_start_t func, void* args, size_t arg_size) {
+    thrd_t handles[MAX_THREADS];
+    int started[MAX_THREADS] = { 0 };
+    for (int i = 1; i < threads; i++) {
+        started[i] = thrd_create(&handles[i], func, (char*)args + arg_size * i) == thrd_success;
+        if (!started[i]) {
+            func((char*)args + arg_size * i); // 无法创建线程时在当前线程执行
+        }
+    }
+    func(args);
+    for (int i = 1; i < threads; i++) {
+        if (started[i]) thrd_join(handles[i], NULL);
+    }
+}
+
+// 当前时间（秒）
+double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 把 [data, data + size) 切成 count 块时第 index 块的结尾：按大小等分后移到下一个换行符之后
+const char* split_point(const char* data, size_t size, int count, int index) {
+    const char* end = data + size;
+    if (index >= count - 1) {
+        return end;
+    }
+    const char* p = find_byte(data + size / count * (index + 1), end, '\n');
+    return p < end ? p + 1 : end;
+}
+
+// ===== 编码 =====
+// 数据文件可以是 UTF-8（可带 BOM）或 GBK（Windows 下中文编辑器的“ANSI”编码）。
+// 解析前先并行验证整个文件是否为有效的 UTF-8：AVX2 下用查表法每次验证 32 字节，
+// SSE2 下每次比较 16 字节的位掩码。不是有效的 UTF-8 时把整个文件按 GBK 转换为 UTF-8 再解析；
+// 转换用一张双字节码到 UTF-8 字节的表，第一次需要时由系统的编码转换生成
+
+#define GBK_TRAIL_COUNT 191     // GBK 尾字节 0x40–0xFE
+
+// 一个 GBK 双字节字符对应的 UTF-8 字节，无效的码为 U+FFFD
+typedef struct {
+    unsigned char bytes[3];
+    unsigned char len;
+} GbkChar;
+
+GbkChar* gbk_table = NULL;      // (首字节 - 0x81) * GBK_TRAIL_COUNT + (尾字节 - 0x40)
+once_flag gbk_once = ONCE_FLAG_INIT;
+
+// 一个编码任务：验证或转换 [start, end)
+typedef struct {
+    const char* start;
+    const char* end;
+    int valid;              // 是有效的 UTF-8
+    char* out;              // 转换结果的位置，NULL 时只计算长度
+    size_t out_size;
+} EncodingJob;
+
+#if defined(__AVX2__)
+// 查表法（Keiser & Lemire）：每个字节与前一个字节的高、低 4 位和自身的高 4 位分别查表，
+// 三个结果按位与不为0即为错误；三、四字节序列的后续字节另外检查
+#define UTF8_TOO_SHORT 0x01     // 首字节后面不是后续字节
+#define UTF8_TOO_LONG 0x02      // ASCII 后面是后续字节
+#define UTF8_OVERLONG_3 0x04
+#define UTF8_TOO_LARGE 0x08     // 超过 U+10FFFF
+#define UTF8_SURROGATE 0x10
+#define UTF8_OVERLONG_2 0x20
+#define UTF8_TOO_LARGE_1000 0x40
+#define UTF8_OVERLONG_4 0x40
+#define UTF8_TWO_CONTS 0x80     // 后续字节后面是后续字节（合法时由长度检查抵消）
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+const unsigned char utf8_byte_1_high[16] = {
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+const unsigned char utf8_byte_1_low[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+const unsigned char utf8_byte_2_high[16] = {
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+// 最后三个字节大于这些值时，序列在本块内没有结束
+const unsigned char utf8_max_value[32] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xEF, 0xDF, 0xBF
+};
+
+// 一块 32 字节中的错误，prev 是上一块
+__m256i utf8_block_errors(__m256i input, __m256i prev) {
+    __m256i shifted = _mm256_permute2x128_si256(prev, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+    __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    __m256i byte_1_high = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_byte_1_high)),
+        _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_byte_1_low)),
+        _mm256_and_si256(prev1, low_nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_byte_2_high)),
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    // 前两个字节是三字节首字节或前三个字节是四字节首字节时，本字节必须是后续字节
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must_continue, special);
+}
+#endif
+
+// 检查 [data, data + len) 是否为有效的 UTF-8（拒绝超长编码、代理区和超过 U+10FFFF 的码位）
+int utf8_valid(const char* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + len;
+#if defined(__AVX2__)
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    __m256i max_value = _mm256_loadu_si256((const __m256i*)utf8_max_value);
+    unsigned char tail[32];
+    while (1) {
+        // 最后不足 32 字节的部分补零，补上的 ASCII 也能发现末尾不完整的序列
+        int last = end - p < 32;
+        __m256i input;
+        if (last) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, p, end - p);
+            input = _mm256_loadu_si256((const __m256i*)tail);
+        }
+        else {
+            input = _mm256_loadu_si256((const __m256i*)p);
+            p += 32;
+        }
+        if (_mm256_movemask_epi8(input) == 0) {
+            error = _mm256_or_si256(error, incomplete);
+            incomplete = _mm256_setzero_si256();
+        }
+        else {
+            error = _mm256_or_si256(error, utf8_block_errors(input, prev));
+            incomplete = _mm256_subs_epu8(input, max_value);
+        }
+        prev = input;
+        if (last) {
+            return _mm256_testz_si256(error, error);
+        }
+    }
+#elif defined(SCAN_SSE2)
+    // SSE2 没有查表指令：比较得到各类字节的位掩码，由首字节的位置推出应是后续字节的位置，
+    // 与实际的后续字节比较；E0、ED、F0、F4 之后的字节另外检查范围（超长编码、代理区、超过 U+10FFFF）
+    uint32_t carry = 0;         // 上一块的首字节要求本块开头几个字节是后续字节
+    unsigned char tail[16];
+    while (1) {
+        int last = end - p <= 16;
+        __m128i chunk;
+        unsigned char next = 0; // 下一块的第一个字节
+        if (last) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, p, end - p);
+            chunk = _mm_loadu_si128((const __m128i*)tail);
+        }
+        else {
+            chunk = _mm_loadu_si128((const __m128i*)p);
+            next = p[16];
+        }
+        uint32_t high = (uint32_t)_mm_movemask_epi8(chunk);
+        if (high == 0) {
+            if (carry != 0) return 0;
+        }
+        else {
+            // 按有符号数比较：80–BF 为后续字节，C2–DF、E0–EF、F0–F4 为二、三、四字节首字节
+            uint32_t cont = (uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(chunk, _mm_set1_epi8(-64)));
+            uint32_t lead2 = (uint32_t)_mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpgt_epi8(chunk, _mm_set1_epi8(-63)), _mm_cmplt_epi8(chunk, _mm_set1_epi8(-32))));
+            uint32_t lead3 = (uint32_t)_mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpgt_epi8(chunk, _mm_set1_epi8(-33)), _mm_cmplt_epi8(chunk, _mm_set1_epi8(-16))));
+            uint32_t lead4 = (uint32_t)_mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpgt_epi8(chunk, _mm_set1_epi8(-17)), _mm_cmplt_epi8(chunk, _mm_set1_epi8(-11))));
+            uint32_t required = carry | (lead2 | lead3 | lead4) << 1 | (lead3 | lead4) << 2 | lead4 << 3;
+
+            __m128i following = _mm_or_si128(_mm_srli_si128(chunk, 1), _mm_slli_si128(_mm_cvtsi32_si128(next), 15));
+            __m128i special = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_and_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8((char)0xE0)), _mm_cmplt_epi8(following, _mm_set1_epi8((char)0xA0))),
+                    _mm_and_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8((char)0xED)), _mm_cmpgt_epi8(following, _mm_set1_epi8((char)0x9F)))),
+                _mm_or_si128(
+                    _mm_and_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8((char)0xF0)), _mm_cmplt_epi8(following, _mm_set1_epi8((char)0x90))),
+                    _mm_and_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8((char)0xF4)), _mm_cmpgt_epi8(following, _mm_set1_epi8((char)0x8F)))));
+            if ((high & ~(cont | lead2 | lead3 | lead4)) != 0 || (required & 0xFFFF) != cont ||
+                _mm_movemask_epi8(special) != 0) {
+                return 0;
+            }
+            carry = required >> 16;
+        }
+        if (last) {
+            return carry == 0;
+        }
+        p += 16;
+    }
+#else
+    while (p < end) {
+        unsigned c = *p;
+        if (c < 0x80) {
+            p++;
+            continue;
+        }
+        size_t n = c >= 0xC2 && c <= 0xDF ? 2 : c >= 0xE0 && c <= 0xEF ? 3 : c >= 0xF0 && c <= 0xF4 ? 4 : 0;
+        if (n == 0 || (size_t)(end - p) < n) {
+            return 0;
+        }
+        for (size_t i = 1; i < n; i++) {
+            if ((p[i] & 0xC0) != 0x80) return 0;
+        }
+        if ((c == 0xE0 && p[1] < 0xA0) || (c == 0xED && p[1] > 0x9F) ||
+            (c == 0xF0 && p[1] < 0x90) || (c == 0xF4 && p[1] > 0x8F)) {
+            return 0;
+        }
+        p += n;
+    }
+    return 1;
+#endif
+}
+
+// 用系统的编码转换生成 GBK 表，系统不支持 GBK 时 gbk_table 保持 NULL
+// 把 code 的 UTF-8 编码写入 ch（GBK 中的字符都不小于 U+0080、不超过 U+FFFF）
+void set_gbk_char(GbkChar* ch, unsigned code) {
+    if (code < 0x800) {
+        ch->bytes[0] = (unsigned char)(0xC0 | code >> 6);
+        ch->bytes[1] = (unsigned char)(0x80 | (code & 0x3F));
+        ch->len = 2;
+    }
+    else {
+        ch->bytes[0] = (unsigned char)(0xE0 | code >> 12);
+        ch->bytes[1] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+        ch->bytes[2] = (unsigned char)(0x80 | (code & 0x3F));
+        ch->len = 3;
+    }
+}
+
+void build_gbk_table() {
+    size_t count = (0xFE - 0x81 + 1) * GBK_TRAIL_COUNT;
+    GbkChar* table = (GbkChar*)calloc(count, sizeof(GbkChar));
+    if (table == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        set_gbk_char(&table[i], 0xFFFD);
+    }
+#ifdef _WIN32
+    for (int lead = 0x81; lead <= 0xFE; lead++) {
+        for (int trail = 0x40; trail <= 0xFE; trail++) {
+            char in[2] = { (char)lead, (char)trail };
+            wchar_t code;
+            if (MultiByteToWideChar(936, MB_ERR_INVALID_CHARS, in, 2, &code, 1) == 1) {
+                set_gbk_char(&table[(lead - 0x81) * GBK_TRAIL_COUNT + (trail - 0x40)], code);
+            }
+        }
+    }
+#else
+    iconv_t converter = iconv_open("UTF-16LE", "GBK");
+    if (converter == (iconv_t)-1) {
+        free(table);
+        return;
+    }
+    for (int lead = 0x81; lead <= 0xFE; lead++) {
+        for (int trail = 0x40; trail <= 0xFE; trail++) {
+            char in[2] = { (char)lead, (char)trail };
+            unsigned char out[4];
+            char* in_p = in;
+            char* out_p = (char*)out;
+            size_t in_left = 2, out_left = sizeof(out);
+            if (iconv(converter, &in_p, &in_left, &out_p, &out_left) != (size_t)-1 && in_left == 0 && out_left == 2) {
+                set_gbk_char(&table[(lead - 0x81) * GBK_TRAIL_COUNT + (trail - 0x40)], out[0] | out[1] << 8);
+            }
+            iconv(converter, NULL, NULL, NULL, NULL);
+        }
+    }
+    iconv_close(converter);
+#endif
+    gbk_table = table;
+}
+
+// 把 GBK 文本 [p, end) 转换为 UTF-8 写入 out，返回转换后的长度；out 为 NULL 时只计算长度。
+// 无效的字节转换为 U+FFFD。每个输入字节至少产生一个输出字节，所以只要输入还剩 k 字节，
+// 向 out + n 整块写入不超过 k 字节不会越过这段输出的结尾
+size_t gbk_to_utf8(const unsigned char* p, const unsigned char* end, char* out) {
+    static const GbkChar invalid = { { 0xEF, 0xBF, 0xBD }, 3 };
+    size_t n = 0;
+    while (p < end) {
+        unsigned c = *p;
+        if (c < 0x80) {
+#if defined(__AVX2__) || defined(SCAN_SSE2)
+            // ASCII 整块复制，只前进到第一个非 ASCII 字节
+            if (end - p >= 16) {
+                __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+                unsigned mask = (unsigned)_mm_movemask_epi8(chunk);
+                unsigned run = mask != 0 ? ctz32(mask) : 16;
+                if (out != NULL) _mm_storeu_si128((__m128i*)(out + n), chunk);
+                p += run;
+                n += run;
+                continue;
+            }
+#endif
+            if (out != NULL) out[n] = (char)c;
+            n++;
+            p++;
+            continue;
+        }
+        const GbkChar* ch = &invalid;
+        if (c >= 0x81 && c <= 0xFE && end - p >= 2 && p[1] >= 0x40 && p[1] <= 0xFE) {
+            ch = &gbk_table[(c - 0x81) * GBK_TRAIL_COUNT + (p[1] - 0x40)];
+            p += 2;
+        }
+        else {
+            p++;
+        }
+        if (out != NULL) {
+            if (end - p >= 2) {
+                memcpy(out + n, ch->bytes, 3);
+            }
+            else {
+                memcpy(out + n, ch->bytes, ch->len);
+            }
+        }
+        n += ch->len;
+    }
+    return n;
+}
+
+int validate_job(void* arg) {
+    EncodingJob* job = (EncodingJob*)arg;
+    job->valid = utf8_valid(job->start, job->end - job->start);
+    return 0;
+}
+
+int convert_job(void* arg) {
+    EncodingJob* job = (EncodingJob*)arg;
+    job->out_size = gbk_to_utf8((const unsigned char*)job->start, (const unsigned char*)job->end, job->out);
+    return 0;
+}
+
+// 检查表中数据文件的编码：跳过 UTF-8 BOM；不是有效的 UTF-8 时按 GBK 转换，
+// 表的值改为指向转换结果。按 threads 块并行处理，内存不足返回0
+int detect_encoding(KvTable* table, int threads) {
+    if (table->values_size >= 3 && memcmp(table->values, "\xEF\xBB\xBF", 3) == 0) {
+        table->values += 3;
+        table->values_size -= 3;
+    }
+
+    EncodingJob jobs[MAX_THREADS];
+    memset(jobs, 0, sizeof(jobs));
+    const char* start = table->values;
+    for (int c = 0; c < threads; c++) {
+        jobs[c].start = start;
+        jobs[c].end = split_point(table->values, table->values_size, threads, c);
+        start = jobs[c].end;
+    }
+    run_parallel(threads, validate_job, jobs, sizeof(EncodingJob));
+    int valid = 1;
+    for (int c = 0; c < threads; c++) {
+        valid &= jobs[c].valid;
+    }
+    if (valid) {
+        return 1;
+    }
+
+    call_once(&gbk_once, build_gbk_table);
+    if (gbk_table == NULL) {
+        fprintf(log_out, "警告：文件不是有效的 UTF-8，系统也不支持 GBK 转换，按原样解析\n");
+        return 1;
+    }
+
+    // 先计算每块转换后的长度，再把各块并行转换到同一个缓冲区的对应位置
+    double start_time = now_seconds();
+    run_parallel(threads, convert_job, jobs, sizeof(EncodingJob));
+    size_t total = 0;
+    for (int c = 0; c < threads; c++) {
+        total += jobs[c].out_size;
+    }
+    char* converted = (char*)malloc(total ? total : 1);
+    if (converted == NULL) {
+        return 0;
+    }
+    size_t offset = 0;
+    for (int c = 0; c < threads; c++) {
+        jobs[c].out = converted + offset;
+        offset += jobs[c].out_size;
+    }
+    run_parallel(threads, convert_job, jobs, sizeof(EncodingJob));
+
+    table->converted = converted;
+    table->values = converted;
+    table->values_size = total;
+    fprintf(log_out, "文件不是有效的 UTF-8，已按 GBK 转换（%.3f 秒）\n", now_seconds() - start_time);
+    return 1;
+}
+
+
+// ===== 覆盖表 =====
+// SET/DELETE 的结果先放在覆盖表中，查询时覆盖表中的键优先于数据文件（删除的键记为墓碑）。
+// 覆盖表只由查询线程（交互、批量或服务器循环）访问，不需要加锁；
+// 后台压缩把修改写回数据文件后，已写回的项从覆盖表中删除
+
+Overlay overlay;
+uint64_t write_seq = 0;
+
+// 覆盖表中键所在的项，不存在时返回应插入的空项；覆盖表为空时不能调用
+OverlayEntry* overlay_find(const uint64_t packed[2], uint64_t hash) {
+    size_t mask = overlay.capacity - 1;
+    size_t i = (size_t)hash & mask;
+    while (overlay.slots[i].used &&
+        (overlay.slots[i].key[0] != packed[0] || overlay.slots[i].key[1] != packed[1])) {
+        i = (i + 1) & mask;
+    }
+    return &overlay.slots[i];
+}
+
+// 把所有项移到容量为 capacity 的新表，序号不超过 drop_until 的项丢弃
+int overlay_rebuild(size_t capacity, uint64_t drop_until) {
+    OverlayEntry* old = overlay.slots;
+    size_t old_capacity = overlay.capacity;
+    OverlayEntry* slots = (OverlayEntry*)calloc(capacity, sizeof(OverlayEntry));
+    if (slots == NULL) {
+        return 0;
+    }
+    overlay.slots = slots;
+    overlay.capacity = capacity;
+    overlay.count = 0;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (!old[i].used) continue;
+        if (old[i].seq <= drop_until) {
+            free(old[i].value);
+            continue;
+        }
+        *overlay_find(old[i].key, hash_key(old[i].key)) = old[i];
+        overlay.count++;
+    }
+    free(old);
+    return 1;
+}
+
+// 修改覆盖表中的键，value 为 NULL 表示删除；成功时 value 归覆盖表所有
+int overlay_put(const uint64_t packed[2], char* value, uint32_t value_len) {
+    if ((overlay.count + 1) * 2 > overlay.capacity &&
+        !overlay_rebuild(overlay.capacity ? overlay.capacity * 2 : 1024, 0)) {
+        return 0;
+    }
+    OverlayEntry* entry = overlay_find(packed, hash_key(packed));
+    if (entry->used) {
+        free(entry->value);
+    }
+    else {
+        entry->used = 1;
+        entry->key[0] = packed[0];
+        entry->key[1] = packed[1];
+        overlay.count++;
+    }
+    entry->value = value;
+    entry->value_len = value_len;
+    entry->seq = ++write_seq;
+    return 1;
+}
+
+void overlay_free() {
+    for (size_t i = 0; i < overlay.capacity; i++) {
+        free(overlay.slots[i].value);
+    }
+    free(overlay.slots);
+    memset(&overlay, 0, sizeof(overlay));
+}
+
+// 查找键的当前值：先查覆盖表，再查数据文件；不存在或已删除时返回 NULL
+const char* lookup_value(const KvTable* table, const uint64_t packed[2], uint64_t hash, size_t* value_len) {
+    if (overlay.count > 0) {
+        const OverlayEntry* entry = overlay_find(packed, hash);
+        if (entry->used) {
+            *value_len = entry->value_len;
+            return entry->value;
+        }
+    }
+    if (table->partitions == NULL) {
+        return NULL;
+    }
+    const IndexSlot* slot = partition_lookup(&table->partitions[partition_of(table, hash)], packed, hash);
+    if (slot->value_len == 0 || slot->value_offset > table->values_size ||
+        slot->value_len > table->values_size - slot->value_offset) {
+        return NULL;
+    }
+    *value_len = slot->value_len;
+    return table->values + slot->value_offset;
+}
+
+// ===== 有序索引 =====
+// 所有键按字典序排成一个数组，用于前缀查询和范围查询：二分查找起点后顺序输出，
+// 代价为 O(log n + 匹配数)。值通过哈希索引中的槽取得
+
+// 排序和归并任务：merge 为0时排序 src[begin, end)（dst 的同一段作为临时空间），
+// 否则把 src 中相邻的两段归并到 dst
+typedef struct {
+    OrderEntry* src;
+    OrderEntry* dst;
+    size_t begin, mid, end;
+    int merge;
+} OrderJob;
+
+uint64_t load_be64(const unsigned char* bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+// 补零的键（pack_key 的结果）转换为有序索引中的键
+void order_key(const uint64_t packed[2], uint64_t key[2]) {
+    const unsigned char* bytes = (const unsigned char*)packed;
+    key[0] = load_be64(bytes);
+    key[1] = load_be64(bytes + 8);
+}
+
+int order_less(const uint64_t a[2], const uint64_t b[2]) {
+    return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+}
+
+// 快速排序，小区间用插入排序，只对较小的一半递归
+void sort_entries(OrderEntry* items, size_t count) {
+    while (count > 16) {
+        OrderEntry* mid = &items[count / 2];
+        OrderEntry* last = &items[count - 1];
+        OrderEntry temp;
+        // 三数取中，基准放到 items[0]
+        if (order_less(mid->key, items[0].key)) { temp = *mid; *mid = items[0]; items[0] = temp; }
+        if (order_less(last->key, items[0].key)) { temp = *last; *last = items[0]; items[0] = temp; }
+        if (order_less(last->key, mid->key)) { temp = *last; *last = *mid; *mid = temp; }
+        temp = *mid; *mid = items[0]; items[0] = temp;
+
+        uint64_t pivot[2] = { items[0].key[0], items[0].key[1] };
+        size_t i = 0, j = count;
+        while (1) {
+            do i++; while (i < count && order_less(items[i].key, pivot));
+            do j--; while (order_less(pivot, items[j].key));
+            if (i >= j) break;
+            temp = items[i]; items[i] = items[j]; items[j] = temp;
+        }
+        temp = items[0]; items[0] = items[j]; items[j] = temp;
+
+        if (j < count - j - 1) {
+            sort_entries(items, j);
+            items += j + 1;
+            count -= j + 1;
+        }
+        else {
+            sort_entries(items + j + 1, count - j - 1);
+            count = j;
+        }
+    }
+    for (size_t i = 1; i < count; i++) {
+        OrderEntry item = items[i];
+        size_t j = i;
+        while (j > 0 && order_less(item.key, items[j - 1].key)) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = item;
+    }
+}
+
+// 键在第 pass 轮的 16 位：键最长 10 字节，从低到高依次是第 9-10 字节、第 7-8 字节……第 1-2 字节
+unsigned radix_digit(const OrderEntry* entry, int pass) {
+    return pass == 0 ? (unsigned)(entry->key[1] >> 48) : (unsigned)(entry->key[0] >> (16 * (pass - 1))) & 0xFFFF;
+}
+
+// 每轮 16 位、共 5 轮的低位优先基数排序，所有键在某一轮上都相同时跳过该轮；
+// scratch 与 items 等长，结果在 items 中。数量少时用快速排序
+void radix_sort_entries(OrderEntry* items, OrderEntry* scratch, size_t count) {
+    size_t* counts = count >= RADIX_MIN_COUNT ? (size_t*)calloc(5 * 65536, sizeof(size_t)) : NULL;
+    if (counts == NULL) {
+        sort_entries(items, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        for (int pass = 0; pass < 5; pass++) {
+            counts[pass * 65536 + radix_digit(&items[i], pass)]++;
+        }
+    }
+
+    OrderEntry* src = items;
+    OrderEntry* dst = scratch;
+    for (int pass = 0; pass < 5; pass++) {
+        size_t* bucket = counts + pass * 65536;
+        if (bucket[radix_digit(&src[0], pass)] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int d = 0; d < 65536; d++) {
+            size_t n = bucket[d];
+            bucket[d] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            dst[bucket[radix_digit(&src[i], pass)]++] = src[i];
+        }
+        OrderEntry* temp = src;
+        src = dst;
+        dst = temp;
+    }
+    if (src != items) {
+        memcpy(items, src, sizeof(OrderEntry) * count);
+    }
+    free(counts);
+}
+
+int order_job(void* arg) {
+    OrderJob* job = (OrderJob*)arg;
+    if (!job->merge) {
+        radix_sort_entries(job->src + job->begin, job->dst + job->begin, job->end - job->begin);
+        return 0;
+    }
+    size_t i = job->begin, j = job->mid, k = job->begin;
+    while (i < job->mid && j < job->end) {
+        job->dst[k++] = order_less(job->src[j].key, job->src[i].key) ? job->src[j++] : job->src[i++];
+    }
+    while (i < job->mid) job->dst[k++] = job->src[i++];
+    while (j < job->end) job->dst[k++] = job->src[j++];
+    return 0;
+}
+
+// 建立有序索引：分成 partition_count 段并行排序，再逐轮两两归并，内存不足返回0
+int build_order(KvTable* table) {
+    size_t count = (size_t)table->entry_count;
+    OrderEntry* items = (OrderEntry*)malloc(sizeof(OrderEntry) * (count ? count : 1));
+    OrderEntry* spare = (OrderEntry*)malloc(sizeof(OrderEntry) * (count ? count : 1));
+    if (items == NULL || spare == NULL) {
+        free(items);
+        free(spare);
+        return 0;
+    }
+
+    size_t n = 0;
+    for (int p = 0; p < table->partition_count; p++) {
+        const IndexPartition* partition = &table->partitions[p];
+        for (size_t i = 0; i < partition->capacity; i++) {
+            if (partition->slots[i].value_len != 0) {
+                order_key(partition->slots[i].key, items[n].key);
+                items[n].partition = (uint32_t)p;
+                items[n].slot = (uint32_t)i;
+                n++;
+            }
+        }
+    }
+
+    OrderJob jobs[MAX_THREADS];
+    size_t bounds[MAX_THREADS + 1];
+    int runs = table->partition_count;
+    for (int r = 0; r <= runs; r++) {
+        bounds[r] = count / runs * r;
+    }
+    bounds[runs] = count;
+    for (int r = 0; r < runs; r++) {
+        jobs[r].src = items;
+        jobs[r].dst = spare;
+        jobs[r].begin = bounds[r];
+        jobs[r].end = bounds[r + 1];
+        jobs[r].merge = 0;
+    }
+    run_parallel(runs, order_job, jobs, sizeof(OrderJob));
+
+    while (runs > 1) {
+        int merges = 0;
+        for (int r = 0; r < runs; r += 2) {
+            OrderJob* job = &jobs[merges];
+            job->src = items;
+            job->dst = spare;
+            job->begin = bounds[r];
+            job->mid = bounds[r + 1];
+            job->end = r + 1 < runs ? bounds[r + 2] : bounds[r + 1]; // 落单的一段直接复制
+            job->merge = 1;
+            bounds[merges++] = bounds[r];
+        }
+        bounds[merges] = count;
+        run_parallel(merges, order_job, jobs, sizeof(OrderJob));
+        OrderEntry* temp = items;
+        items = spare;
+        spare = temp;
+        runs = merges;
+    }
+    free(spare);
+
+    table->order = items;
+    table->order_count = count;
+    return 1;
+}
+
+// 第一个不小于 key 的位置
+size_t order_lower_bound(const KvTable* table, const uint64_t key[2]) {
+    size_t low = 0, high = table->order_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (order_less(table->order[mid].key, key)) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int compare_overlay_item(const void* a, const void* b) {
+    const OverlayItem* x = (const OverlayItem*)a;
+    const OverlayItem* y = (const OverlayItem*)b;
+    return order_less(x->order, y->order) ? -1 : order_less(y->order, x->order);
+}
+
+// 取出覆盖表中位于 [from, to] 的项并排序，数量写入 count；内存不足返回 NULL
+OverlayItem* overlay_items(const uint64_t from[2], const uint64_t to[2], size_t* count) {
+    OverlayItem* items = (OverlayItem*)malloc(sizeof(OverlayItem) * (overlay.count ? overlay.count : 1));
+    size_t n = 0;
+    for (size_t i = 0; items != NULL && i < overlay.capacity; i++) {
+        const OverlayEntry* entry = &overlay.slots[i];
+        if (!entry->used) continue;
+        OverlayItem* item = &items[n];
+        order_key(entry->key, item->order);
+        if (order_less(item->order, from) || order_less(to, item->order)) continue;
+        item->key[0] = entry->key[0];
+        item->key[1] = entry->key[1];
+        item->value = entry->value;
+        item->value_len = entry->value_len;
+        n++;
+    }
+    if (items != NULL) {
+        qsort(items, n, sizeof(OverlayItem), compare_overlay_item);
+    }
+    *count = n;
+    return items;
+}
+
+// 按数据文件的格式输出一个键值对
+int write_pair(FILE* out, const uint64_t packed[2], const char* value, size_t value_len) {
+    const char* key = (const char*)packed;
+    size_t key_len = strnlen(key, MAX_KEY_LEN - 1);
+    return fwrite(key, 1, key_len, out) == key_len && fputc(':', out) != EOF &&
+        fwrite(value, 1, value_len, out) == value_len && fputc('\n', out) != EOF;
+}
+
+// 按键的顺序输出 [from, to] 中的所有键值对：有序索引与覆盖表的项归并，
+// 同一个键以覆盖表为准，已删除的键不输出。输出数量写入 count，写入失败返回0
+int walk_range(const KvTable* table, const uint64_t from[2], const uint64_t to[2],
+    const OverlayItem* items, size_t item_count, FILE* out, size_t* count) {
+    size_t i = order_lower_bound(table, from), j = 0;
+    *count = 0;
+    while (1) {
+        const OrderEntry* entry = i < table->order_count && !order_less(to, table->order[i].key) ? &table->order[i] : NULL;
+        const OverlayItem* item = j < item_count ? &items[j] : NULL;
+        if (entry == NULL && item == NULL) {
+            return 1;
+        }
+        if (item != NULL && (entry == NULL || !order_less(entry->key, item->order))) {
+            if (entry != NULL && !order_less(item->order, entry->key)) i++;
+            j++;
+            if (item->value == NULL) continue;
+            if (!write_pair(out, item->key, item->value, item->value_len)) return 0;
+            (*count)++;
+            continue;
+        }
+        i++;
+        if (entry->partition >= (uint32_t)table->partition_count ||
+            entry->slot >= table->partitions[entry->partition].capacity) {
+            continue;
+        }
+        const IndexSlot* slot = &table->partitions[entry->partition].slots[entry->slot];
+        if (slot->value_len == 0 || slot->value_offset > table->values_size ||
+            slot->value_len > table->values_size - slot->value_offset) {
+            continue;
+        }
+        if (!write_pair(out, slot->key, table->values + slot->value_offset, slot->value_len)) return 0;
+        (*count)++;
+    }
+}
+
+// 处理前缀查询 "Prefix <前缀>" 和范围查询 "Range <起点> <终点>"（包含两端）；
+// 键不含空白字符，所以这两种输入不会与键冲突。line 不是这两种查询时返回0，
+// 后面没有参数的 Prefix、Range 是普通的键，同样返回0
+int ordered_query(const KvTable* table, const char* line, size_t len) {
+    const char* end = line + len;
+    const char* args;
+    int prefix;
+    if (len > 7 && memcmp(line, "Prefix", 6) == 0 && isspace((unsigned char)line[6])) {
+        prefix = 1;
+        args = line + 7;
+    }
+    else if (len > 6 && memcmp(line, "Range", 5) == 0 && isspace((unsigned char)line[5])) {
+        prefix = 0;
+        args = line + 6;
+    }
+    else {
+        return 0;
+    }
+
+    // 切出参数
+    const char* first = args;
+    while (first < end && isspace((unsigned char)*first)) first++;
+    if (first == end) {
+        return 0;
+    }
+    const char* first_end = first;
+    while (first_end < end && !isspace((unsigned char)*first_end)) first_end++;
+    const char* second = first_end;
+    while (second < end && isspace((unsigned char)*second)) second++;
+    const char* second_end = second;
+    while (second_end < end && !isspace((unsigned char)*second_end)) second_end++;
+
+    if (table->order == NULL) {
+        printf("错误：有序索引不可用\n");
+        return 1;
+    }
+
+    // 前缀查询也转换成范围：前缀补零为起点，补 0xFF 为终点
+    uint64_t packed[2], from[2], to[2];
+    if (prefix) {
+        size_t prefix_len = (size_t)(first_end - first);
+        if (first == first_end || second != end) {
+            printf("用法：Prefix <前缀>\n");
+            return 1;
+        }
+        if (!pack_key(first, prefix_len, packed)) {
+            printf("共 0 个键值对\n");
+            return 1;
+        }
+        order_key(packed, from);
+        memset((unsigned char*)packed + prefix_len, 0xFF, sizeof(packed) - prefix_len);
+        order_key(packed, to);
+    }
+    else {
+        if (first == first_end || second == second_end || second_end != end) {
+            printf("用法：Range <起点> <终点>\n");
+            return 1;
+        }
+        if (!pack_key(first, first_end - first, packed)) {
+            printf("错误：范围端点不能超过 %d 个字符\n", MAX_KEY_LEN - 1);
+            return 1;
+        }
+        order_key(packed, from);
+        if (!pack_key(second, second_end - second, packed)) {
+            printf("错误：范围端点不能超过 %d 个字符\n", MAX_KEY_LEN - 1);
+            return 1;
+        }
+        order_key(packed, to);
+    }
+
+    size_t item_count, count;
+    OverlayItem* items = overlay_items(from, to, &item_count);
+    if (items == NULL) {
+        printf("错误：内存不足\n");
+        return 1;
+    }
+    walk_range(table, from, to, items, item_count, stdout, &count);
+    free(items);
+    printf("共 %zu 个键值对\n", count);
+    return 1;
+}
+
+// 释放一张表
+void destroy_table(KvTable* table) {
+    if (table == NULL) {
+        return;
+    }
+    if (table->partitions != NULL && !table->from_cache) {
+        for (int i = 0; i < table->partition_count; i++) {
+            free(table->partitions[i].slots);
+        }
+        free(table->order);
+    }
+    free(table->partitions);
+    free(table->converted);
+    close_view(&table->view);
+    free(table);
+}
+
+// 解析 size 字节的文件使用的线程数，threads 为 0 时按文件大小和核心数选择
+int parse_threads(size_t size, int threads) {
+    if (threads <= 0) {
+        threads = size >= PARALLEL_MIN_SIZE ? cpu_count() : 1;
+    }
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if ((size_t)threads > size / 4096 + 1) threads = (int)(size / 4096 + 1);
+    return threads;
+}
+
+// 解析数据文件：文件按换行符切成 threads 块并行解析，
+// 再按哈希分区并行建立索引，结果与逐行顺序解析相同。
+// 返回新建的表（引用计数为1），失败返回 NULL；copy 见 open_view()
+KvTable* parse_data_file(const char* filename, int threads, int copy) {
+    KvTable* table = (KvTable*)calloc(1, sizeof(KvTable));
+    if (table == NULL) {
+        fprintf(log_out, "错误：内存不足\n");
+        return NULL;
+    }
+    if (!open_view(filename, &table->view, copy)) {
+        fprintf(log_out, "错误：无法打开文件 '%s'\n", filename);
+        fprintf(log_out, "请确保文件与程序在同一目录下\n");
+        free(table);
+        return NULL;
+    }
+    table->values = table->view.data;
+    table->values_size = table->view.size;
+    table->refs = 1;
+
+    double start_time = now_seconds();
+    fprintf(log_out, "正在解析文件 '%s'...\n", filename);
+
+    size_t size = table->values_size;
+    threads = parse_threads(size, threads);
+
+    int chunk_count = threads;
+    table->partition_count = threads;
+    ParseChunk* chunks = (ParseChunk*)calloc(chunk_count, sizeof(ParseChunk));
+    table->partitions = (IndexPartition*)calloc(table->partition_count, sizeof(IndexPartition));
+    PartitionJob* jobs = (PartitionJob*)calloc(table->partition_count, sizeof(PartitionJob));
+    int no_memory = chunks == NULL || table->partitions == NULL || jobs == NULL;
+
+    // 检查编码，GBK 文件转换后再切块；块边界移到下一个换行符之后
+    no_memory = no_memory || !detect_encoding(table, threads);
+    size = table->values_size;
+    const char* start = table->values;
+    for (int c = 0; !no_memory && c < chunk_count; c++) {
+        const char* chunk_end = split_point(table->values, size, chunk_count, c);
+        chunks[c].start = start;
+        chunks[c].end = chunk_end;
+        chunks[c].table = table;
+        chunks[c].candidates = (Array*)calloc(table->partition_count, sizeof(Array));
+        no_memory = chunks[c].candidates == NULL;
+        start = chunk_end;
+    }
+    if (no_memory) {
+        fprintf(log_out, "错误：内存不足\n");
+        for (int c = 0; chunks != NULL && c < chunk_count; c++) {
+            free(chunks[c].candidates);
+        }
+        free(chunks);
+        free(jobs);
+        destroy_table(table);
+        return NULL;
+    }
+
+    run_parallel(chunk_count, parse_chunk, chunks, sizeof(ParseChunk));
+
+    int line_number = 0;
+    int failed = 0;
+    for (int c = 0; c < chunk_count; c++) {
+        chunks[c].line_base = line_number;
+        line_number += chunks[c].lines;
+        failed |= chunks[c].failed;
+    }
+
+    for (int i = 0; i < table->partition_count; i++) {
+        jobs[i].index = i;
+        jobs[i].table = table;
+        jobs[i].chunks = chunks;
+        jobs[i].chunk_count = chunk_count;
+    }
+    run_parallel(table->partition_count, build_partition, jobs, sizeof(PartitionJob));
+
+    // 合并所有警告并按行号输出
+    Array warnings = { 0 };
+    for (int c = 0; c < chunk_count; c++) {
+        Warning* items = (Warning*)chunks[c].warnings.data;
+        for (size_t i = 0; i < chunks[c].warnings.count; i++) {
+            Warning* warning = (Warning*)array_push(&warnings, sizeof(Warning));
+            if (warning == NULL) { failed = 1; break; }
+            *warning = items[i];
+            warning->line += chunks[c].line_base;
+        }
+        free(chunks[c].warnings.data);
+        free(chunks[c].candidates);
+    }
+    for (int i = 0; i < table->partition_count; i++) {
+        Warning* items = (Warning*)jobs[i].duplicates.data;
+        for (size_t j = 0; j < jobs[i].duplicates.count; j++) {
+            Warning* warning = (Warning*)array_push(&warnings, sizeof(Warning));
+            if (warning == NULL) { failed = 1; break; }
+            *warning = items[j];
+        }
+        free(jobs[i].duplicates.data);
+        failed |= jobs[i].failed;
+        table->entry_count += (int)table->partitions[i].count;
+    }
+    free(jobs);
+    free(chunks);
+    table->complete = !failed;
+
+    if (warnings.count > 0) {
+        qsort(warnings.data, warnings.count, sizeof(Warning), compare_warning);
+    }
+    for (size_t i = 0; i < warnings.count; i++) {
+        print_warning(table, (Warning*)warnings.data + i);
+    }
+    if (failed) {
+        fprintf(log_out, "警告：内存不足，部分行未加载\n");
+    }
+
+    double seconds = now_seconds() - start_time;
+
+    double order_start = now_seconds();
+    if (!build_order(table)) {
+        fprintf(log_out, "警告：内存不足，无法建立有序索引，前缀和范围查询不可用\n");
+    }
+    double order_seconds = now_seconds() - order_start;
+
+    fprintf(log_out, "解析完成！\n");
+    fprintf(log_out, "有效键值对：%d，错误行：%d，总行数：%d\n", table->entry_count, (int)warnings.count, line_number);
+    fprintf(log_out, "成功加载 %d 个键值对\n", table->entry_count);
+    fprintf(log_out, "解析用时 %.3f 秒（%.1f MB/s，%d 个线程）\n", seconds,
+        seconds > 0 ? size / seconds / (1024 * 1024) : 0.0, threads);
+    fprintf(log_out, "有序索引用时 %.3f 秒\n\n", order_seconds);
+
+    free(warnings.data);
+    return table;
+}
+
+// 查找键对应的值（包括覆盖表中的修改），值不以 '\0' 结尾，长度写入 value_len
+const char* find_value(const KvTable* table, const char* key, size_t* value_len) {
+    uint64_t packed[2];
+    if (!pack_key(key, strlen(key), packed)) {
+        return NULL;
+    }
+    return lookup_value(table, packed, hash_key(packed), value_len);
+}
+
+// ===== 索引缓存 =====
+// 解析成功后把哈希索引和所有值写入 data.idx，文件头记录源文件的大小、修改时间和内容哈希。
+// 下次启动时如果源文件没有变化，直接映射 data.idx 查询，不再解析。
+// 文件结构：CacheHeader | CachePartition × partition_count | 各分区的槽 | 有序索引 | 值
+// 槽中的 value_offset 指向值区，所以映射后把表的 values 指向值区即可原样查询。
+
+#define CACHE_MAGIC "KVIDX01"
+#define CACHE_VERSION 3
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t partition_count;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;       // 源文件内容哈希
+    int64_t built_time;         // 写入缓存的时间
+    uint64_t entry_count;
+    uint64_t order_offset;      // 有序索引在缓存文件中的位置，共 entry_count 项
+    uint64_t blob_offset;       // 值区在缓存文件中的位置
+    uint64_t blob_size;
+    uint64_t checksum;          // 文件头其余字段和分区表的校验
+} CacheHeader;
+
+typedef struct {
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t slots_offset;
+} CachePartition;
+
+// 数据块的 64 位哈希，每次处理 8 字节
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed ^ (size * 0x9E3779B97F4A7C15ull);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h ^= word * 0xC2B2AE3D27D4EB4Full;
+        h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ull;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, size - i);
+    h ^= tail * 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t cache_checksum(const CacheHeader* header, const CachePartition* parts) {
+    CacheHeader copy = *header;
+    copy.checksum = 0;
+    return hash_bytes(parts, sizeof(CachePartition) * header->partition_count,
+        hash_bytes(&copy, sizeof(copy), 0));
+}
+
+// 数据文件旁边的同名文件，扩展名换成 extension（如 ".idx"）
+void sibling_file_name(const char* filename, const char* extension, char* buffer, size_t size) {
+    const char* dot = strrchr(filename, '.');
+    size_t base = dot ? (size_t)(dot - filename) : strlen(filename);
+    snprintf(buffer, size, "%.*s%s", (int)base, filename, extension);
+}
+
+int source_stat(const char* filename, uint64_t* size, int64_t* mtime) {
+    struct stat file_stat;
+    if (stat(filename, &file_stat) != 0) {
+        return 0;
+    }
+    *size = (uint64_t)file_stat.st_size;
+    *mtime = (int64_t)file_stat.st_mtime;
+    return 1;
+}
+
+// 内容没变但修改时间变了（例如被 touch），更新缓存中记录的时间，下次启动不必再比较内容
+void refresh_cache_header(const char* cache_name, const CacheHeader* header,
+    const CachePartition* parts, int64_t source_mtime) {
+    CacheHeader updated = *header;
+    updated.source_mtime = source_mtime;
+    updated.built_time = (int64_t)time(NULL);
+    updated.checksum = cache_checksum(&updated, parts);
+
+    FILE* file = fopen(cache_name, "r+b");
+    if (file != NULL) {
+        fwrite(&updated, sizeof(updated), 1, file);
+        fclose(file);
+    }
+}
+
+// 尝试从缓存加载，返回新建的表（引用计数为1）；缓存不存在、过期或损坏时返回 NULL
+KvTable* load_index_cache(const char* filename) {
+    char cache_name[512];
+    uint64_t source_size;
+    int64_t source_mtime;
+    FileView cache_view;
+    sibling_file_name(filename, ".idx", cache_name, sizeof(cache_name));
+
+    if (!source_stat(filename, &source_size, &source_mtime) || !open_view(cache_name, &cache_view, 0)) {
+        return NULL;
+    }
+
+    const CacheHeader* header = (const CacheHeader*)cache_view.data;
+    const CachePartition* parts = (const CachePartition*)(header + 1);
+    const char* reason = NULL;
+
+    if (cache_view.size < sizeof(CacheHeader) || memcmp(header->magic, CACHE_MAGIC, 8) != 0 ||
+        header->version != CACHE_VERSION || header->partition_count == 0 || header->partition_count > MAX_THREADS ||
+        cache_view.size < sizeof(CacheHeader) + sizeof(CachePartition) * header->partition_count ||
+        header->checksum != cache_checksum(header, parts) ||
+        header->blob_offset > cache_view.size || header->blob_size > cache_view.size - header->blob_offset) {
+        reason = "索引缓存已损坏";
+    }
+    else if (header->source_size != source_size) {
+        reason = "数据文件已修改";
+    }
+    else if (header->source_mtime != source_mtime || source_mtime >= header->built_time - 1) {
+        // 时间戳只精确到秒，修改时间变了或与写缓存在同一秒内时比较内容
+        FileView source;
+        if (!open_view(filename, &source, 0)) {
+            reason = "数据文件已修改";
+        }
+        else {
+            if (hash_bytes(source.data, source.size, 0) != header->source_hash) {
+                reason = "数据文件已修改";
+            }
+            close_view(&source);
+            if (reason == NULL) {
+                refresh_cache_header(cache_name, header, parts, source_mtime);
+            }
+        }
+    }
+
+    uint64_t entries_total = 0;
+    for (uint32_t i = 0; reason == NULL && i < header->partition_count; i++) {
+        const CachePartition* part = &parts[i];
+        if (part->capacity == 0 || (part->capacity & (part->capacity - 1)) != 0 || part->count > part->capacity ||
+            part->slots_offset % 8 != 0 || part->slots_offset > cache_view.size ||
+            part->capacity > (cache_view.size - part->slots_offset) / sizeof(IndexSlot)) {
+            reason = "索引缓存已损坏";
+        }
+        entries_total += part->count;
+    }
+    if (reason == NULL && (entries_total != header->entry_count ||
+        header->order_offset % 8 != 0 || header->order_offset > cache_view.size ||
+        header->entry_count > (cache_view.size - header->order_offset) / sizeof(OrderEntry))) {
+        reason = "索引缓存已损坏";
+    }
+
+    if (reason != NULL) {
+        fprintf(log_out, "%s，重新解析\n", reason);
+        close_view(&cache_view);
+        return NULL;
+    }
+
+    KvTable* table = (KvTable*)calloc(1, sizeof(KvTable));
+    IndexPartition* partitions = (IndexPartition*)calloc(header->partition_count, sizeof(IndexPartition));
+    if (table == NULL || partitions == NULL) {
+        free(table);
+        free(partitions);
+        close_view(&cache_view);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < header->partition_count; i++) {
+        partitions[i].slots = (IndexSlot*)(cache_view.data + parts[i].slots_offset);
+        partitions[i].capacity = (size_t)parts[i].capacity;
+        partitions[i].count = (size_t)parts[i].count;
+    }
+    table->view = cache_view;
+    table->values = cache_view.data + header->blob_offset;
+    table->values_size = (size_t)header->blob_size;
+    table->partitions = partitions;
+    table->partition_count = (int)header->partition_count;
+    table->entry_count = (int)header->entry_count;
+    table->order = (OrderEntry*)(cache_view.data + header->order_offset);
+    table->order_count = (size_t)header->entry_count;
+    table->from_cache = 1;
+    table->complete = 1;
+    table->refs = 1;
+
+    fprintf(log_out, "已从索引缓存 '%s' 加载 %d 个键值对\n\n", cache_name, table->entry_count);
+    return table;
+}
+
+// 把表写入缓存文件（先写临时文件再改名），成功返回1
+int save_index_cache(const char* filename, const KvTable* kv) {
+    char cache_name[512], temp_name[520];
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    sibling_file_name(filename, ".idx", cache_name, sizeof(cache_name));
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", cache_name);
+
+    // 源文件的大小和哈希按原始内容计算（GBK 文件的值是转换后的文本）
+    if (kv->from_cache || !kv->complete || kv->order == NULL ||
+        !source_stat(filename, &header.source_size, &header.source_mtime) ||
+        header.source_size != kv->view.size) {
+        return 0;
+    }
+
+    int partition_count = kv->partition_count;
+    const IndexPartition* partitions = kv->partitions;
+    CachePartition* parts = (CachePartition*)calloc(partition_count, sizeof(CachePartition));
+    FILE* file = fopen(temp_name, "wb");
+    if (parts == NULL || file == NULL) {
+        free(parts);
+        if (file != NULL) fclose(file);
+        return 0;
+    }
+
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    header.version = CACHE_VERSION;
+    header.partition_count = (uint32_t)partition_count;
+    header.source_hash = hash_bytes(kv->view.data, kv->view.size, 0);
+    header.built_time = (int64_t)time(NULL);
+    header.entry_count = (uint64_t)kv->entry_count;
+
+    uint64_t offset = sizeof(CacheHeader) + sizeof(CachePartition) * partition_count;
+    for (int i = 0; i < partition_count; i++) {
+        parts[i].capacity = partitions[i].capacity;
+        parts[i].count = partitions[i].count;
+        parts[i].slots_offset = offset;
+        offset += sizeof(IndexSlot) * partitions[i].capacity;
+    }
+    header.order_offset = offset;
+    header.blob_offset = offset + sizeof(OrderEntry) * kv->order_count;
+
+    int ok = fseek(file, (long)(sizeof(CacheHeader) + sizeof(CachePartition) * partition_count), SEEK_SET) == 0;
+
+    // 槽按顺序写出，值按同样顺序排进值区
+    uint64_t blob = 0;
+    for (int i = 0; ok && i < partition_count; i++) {
+        for (size_t j = 0; j < partitions[i].capacity; j++) {
+            IndexSlot slot = partitions[i].slots[j];
+            if (slot.value_len != 0) {
+                slot.value_offset = blob;
+                blob += slot.value_len;
+            }
+            ok = ok && fwrite(&slot, sizeof(slot), 1, file) == 1;
+        }
+    }
+    // 有序索引引用的是分区号和槽号，原样写出
+    ok = ok && fwrite(kv->order, sizeof(OrderEntry), kv->order_count, file) == kv->order_count;
+    for (int i = 0; ok && i < partition_count; i++) {
+        for (size_t j = 0; j < partitions[i].capacity; j++) {
+            const IndexSlot* slot = &partitions[i].slots[j];
+            if (slot->value_len != 0) {
+                ok = ok && fwrite(kv->values + slot->value_offset, 1, slot->value_len, file) == slot->value_len;
+            }
+        }
+    }
+    header.blob_size = blob;
+    header.checksum = cache_checksum(&header, parts);
+
+    rewind(file);
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(parts, sizeof(CachePartition), partition_count, file) == (size_t)partition_count;
+    ok = fclose(file) == 0 && ok;
+    free(parts);
+
+    if (ok) {
+#ifdef _WIN32
+        remove(cache_name);
+#endif
+        ok = rename(temp_name, cache_name) == 0;
+    }
+    if (!ok) {
+        remove(temp_name);
+    }
+    return ok;
+}
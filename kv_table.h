@@ -0,0 +1,175 @@
+﻿#ifndef KV_TABLE_H
+#define KV_TABLE_H
+
+// 键值表：data.txt 的解析和建立在其上的索引
+//
+// 数据文件整个映射到内存，按块多线程解析成按哈希分区的开放寻址索引，键值直接指向映射；
+// 另外建立按键排序的有序索引供前缀和范围查询使用。GBK 编码的文件先转换成 UTF-8。
+// 解析好的索引可以写入数据文件旁的索引缓存，下次启动时直接映射。
+// SET/DELETE 的结果放在覆盖表中，查询时优先于数据文件（写入和日志见 kv_store.h）。
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <threads.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN     // 不带入旧的 winsock.h，网络部分另外包含 winsock2.h
+#include <windows.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCAN_SSE2
+#endif
+
+#if defined(__GNUC__)
+#define PREFETCH(p) __builtin_prefetch(p)
+#elif defined(__AVX2__) || defined(SCAN_SSE2)
+#define PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define PREFETCH(p) ((void)(p))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_KEY_LEN 11       // 键最大长度（10字符 + 1个结束符）
+
+// 整个数据文件映射到内存（映射失败时读入一块堆内存），键值直接指向其中
+typedef struct {
+    const char* data;
+    size_t size;
+    int mapped;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} FileView;
+
+// 哈希索引槽：键补零后存成 16 字节，比较时只比较两个 64 位整数；
+// 值是数据文件映射中的一段。解析时同样的结构也用来暂存候选键值对
+typedef struct {
+    uint64_t key[2];
+    uint64_t value_offset;
+    uint32_t value_len;     // 0 表示空槽（有效的值不能为空）
+    uint32_t line;          // 候选键值对所在行（块内行号）
+} IndexSlot;
+
+// 索引按哈希值分成若干分区，每个分区是一张开放寻址（线性探测）的表，
+// 多线程加载时每个线程独立构建一个分区
+typedef struct {
+    IndexSlot* slots;
+    size_t capacity;        // 槽数，2 的幂，至少为条目数的两倍
+    size_t count;
+} IndexPartition;
+
+// 有序索引的一项：键按大端序装入两个整数，整数比较的结果就是字典序
+typedef struct {
+    uint64_t key[2];
+    uint32_t partition;
+    uint32_t slot;
+} OrderEntry;
+
+// 一份完整的键值表：数据文件（或索引缓存）的映射和建立在其上的索引。
+// 监视模式下后台线程建立新表后整体替换，查询通过 acquire_table()/release_table()
+// 持有引用，旧表在最后一个引用释放后才销毁
+typedef struct {
+    FileView view;          // 数据文件或索引缓存的映射
+    const char* values;     // value_offset 的基址
+    size_t values_size;
+    IndexPartition* partitions;
+    int partition_count;
+    int entry_count;        // 存储的键值对数量
+    OrderEntry* order;      // 按键排序的有序索引，NULL 表示内存不足未能建立
+    size_t order_count;
+    char* converted;        // GBK 文件转换成的 UTF-8 文本，values 指向其中；NULL 表示值直接在 view 中
+    int from_cache;         // 分区的槽和有序索引位于 view 中，不单独释放
+    int complete;           // 解析时没有发生内存不足
+    int refs;
+} KvTable;
+
+// 覆盖表的一项
+typedef struct {
+    uint64_t key[2];
+    char* value;            // NULL 表示该键已删除
+    uint32_t value_len;
+    uint32_t used;
+    uint64_t seq;           // 修改序号，压缩完成后删除不晚于压缩快照的项
+} OverlayEntry;
+
+// 覆盖表：开放寻址（线性探测），容量为 2 的幂，装载率不超过一半
+typedef struct {
+    OverlayEntry* slots;
+    size_t capacity;
+    size_t count;
+} Overlay;
+
+// 覆盖表中的一项，按有序索引的键排序后与数据文件的有序索引归并
+typedef struct {
+    uint64_t order[2];      // 有序索引中的键
+    uint64_t key[2];
+    const char* value;      // NULL 表示已删除
+    uint32_t value_len;
+} OverlayItem;
+
+extern FILE* log_out;       // 解析、缓存和监视的提示信息；批量模式下为 stderr，不混入查询结果
+extern Overlay overlay;     // 只由查询线程访问
+extern uint64_t write_seq;
+
+// 文本
+void trim_view(const char** start, const char** end);
+void trim_whitespace(char* str);
+const char* find_space(const char* p, const char* end);
+unsigned ctz32(unsigned mask);
+const char* find_byte(const char* p, const char* end, char c);
+const char* find_colon(const char* p, const char* end, size_t* len);
+int is_valid_key(const char* key, size_t len);
+int utf8_valid(const char* data, size_t len);
+
+// 文件映射
+int open_view(const char* filename, FileView* view, int copy);
+void close_view(FileView* view);
+double now_seconds();
+
+// 键和哈希索引
+int pack_key(const char* key, size_t len, uint64_t packed[2]);
+uint64_t hash_key(const uint64_t packed[2]);
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed);
+int partition_of(const KvTable* table, uint64_t hash);
+void order_key(const uint64_t packed[2], uint64_t key[2]);
+int order_less(const uint64_t a[2], const uint64_t b[2]);
+
+// 覆盖表
+int overlay_rebuild(size_t capacity, uint64_t drop_until);
+int overlay_put(const uint64_t packed[2], char* value, uint32_t value_len);
+void overlay_free();
+OverlayItem* overlay_items(const uint64_t from[2], const uint64_t to[2], size_t* count);
+
+// 查询：lookup_value 先查覆盖表再查表；ordered_query 处理 Prefix/Range 行并输出结果，
+// 不是这两种查询时返回0
+const char* lookup_value(const KvTable* table, const uint64_t packed[2], uint64_t hash, size_t* value_len);
+const char* find_value(const KvTable* table, const char* key, size_t* value_len);
+int ordered_query(const KvTable* table, const char* line, size_t len);
+// 按键的顺序把 [from, to] 中的键值对写入 out
+int walk_range(const KvTable* table, const uint64_t from[2], const uint64_t to[2],
+    const OverlayItem* items, size_t item_count, FILE* out, size_t* count);
+
+// 解析数据文件，threads 为 0 时按文件大小和核心数选择；copy 为 1 时读入内存而不是映射
+int parse_threads(size_t size, int threads);
+int detect_encoding(KvTable* table, int threads);
+KvTable* parse_data_file(const char* filename, int threads, int copy);
+void destroy_table(KvTable* table);
+
+// 索引缓存
+void sibling_file_name(const char* filename, const char* extension, char* buffer, size_t size);
+int source_stat(const char* filename, uint64_t* size, int64_t* mtime);
+KvTable* load_index_cache(const char* filename);
+int save_index_cache(const char* filename, const KvTable* kv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
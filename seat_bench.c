@@ -0,0 +1,701 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+#define _GNU_SOURCE
+
+// 座位预约引擎的测试程序：吞吐量测试、轨迹回放和多进程压力测试。
+// 与图书馆预约系统 2.0 使用同一套任务分发（seat_jobs），测试数据不写入正式数据文件的审计日志。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <threads.h>
+#include <stdint.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+#include "seat_engine.h"
+#include "seat_jobs.h"
+
+#define FLOORS ENGINE_FLOORS
+#define ROWS ENGINE_ROWS
+#define COLS ENGINE_COLS
+#define DAYS ENGINE_DAYS
+#define BOOKINGS_PER_FLOOR ENGINE_BOOKINGS_PER_FLOOR
+#define FILENAME "library_data.dat"
+#define FLOOR_FILENAME "library_data_f%d.dat" // 分片模式下每层独立的数据文件
+#define STRESS_FILENAME "library_stress.dat"  // 压力测试使用的数据文件，不影响正式数据
+#define STRESS_AUDIT_PREFIX "stress_audit"     // 压力测试的审计日志
+#define REPLAY_FILENAME "library_replay.dat"  // 回放轨迹使用的数据文件，不影响正式数据
+#define REPLAY_FLOOR_FILENAME "library_replay_f%d.dat"
+#define CHECK_FILENAME "library_check.dat"    // 导入检查使用的数据文件
+#define CHECK_FLOOR_FILENAME "library_check_f%d.dat"
+
+// ===== 吞吐量测试 =====
+
+int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// 吞吐量测试：在随机座位的随机时段上成对执行 预约/取消（使用用户 '#'，不影响已有预约）
+// 分片模式下任务按窗口批量提交，不逐个等待
+void run_benchmark(int ops) {
+    enum { WINDOW = FLOORS * SHARD_QUEUE_LEN };
+    static Job jobs[WINDOW];
+    struct timespec start, end;
+    int done = 0;
+    double* latencies = (double*)malloc(sizeof(double) * (ops > 0 ? ops : 1));
+    int latency_count = 0;
+
+    srand((unsigned)time(NULL));
+    timespec_get(&start, TIME_UTC);
+
+    while (done < ops) {
+        int n = (ops - done < WINDOW) ? ops - done : WINDOW;
+        n &= ~1;
+        if (n == 0) break;
+
+        JobBatch batch;
+        mtx_init(&batch.lock, mtx_plain);
+        cnd_init(&batch.done);
+        batch.pending = n;
+
+        for (int i = 0; i < n; i += 2) {
+            Job* reserve = &jobs[i];
+            Job* cancel = &jobs[i + 1];
+            memset(reserve, 0, sizeof(*reserve));
+            reserve->type = JOB_RESERVE;
+            reserve->floor = rand() % FLOORS;
+            reserve->row = rand() % floor_rows(reserve->floor);
+            reserve->col = rand() % floor_cols(reserve->floor);
+            reserve->day = rand() % DAYS;
+            reserve->start = rand() % engine_slot_count(engine);
+            reserve->end = reserve->start + 1;
+            reserve->user_char = '#';
+            reserve->user_type = USER_NORMAL;
+            *cancel = *reserve;
+            cancel->type = JOB_CANCEL;
+
+            if (shard_count == 0) {
+                // 单线程模式下记录每次操作从提交到可以回复的延迟
+                double begin = now_us();
+                dispatch_job(reserve);
+                double middle = now_us();
+                dispatch_job(cancel);
+                latencies[latency_count++] = middle - begin;
+                latencies[latency_count++] = now_us() - middle;
+            }
+            else {
+                reserve->batch = &batch;
+                cancel->batch = &batch;
+                submit_job(&shards[floor_owner[reserve->floor]], reserve);
+                submit_job(&shards[floor_owner[cancel->floor]], cancel);
+            }
+        }
+
+        if (shard_count > 0) {
+            wait_batch(&batch);
+        }
+        cnd_destroy(&batch.done);
+        mtx_destroy(&batch.lock);
+        done += n;
+    }
+
+    timespec_get(&end, TIME_UTC);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("测试完成：%d 次操作，用时 %.3f 秒，%.0f 次/秒（%s）\n",
+        done, seconds, seconds > 0 ? done / seconds : 0.0,
+        shard_count == 0 ? "单线程" : "分片");
+
+    if (latency_count > 0) {
+        qsort(latencies, latency_count, sizeof(double), compare_double);
+        printf("操作延迟（微秒）：p50 %.1f，p99 %.1f，最大 %.1f\n",
+            latencies[latency_count / 2], latencies[latency_count * 99 / 100],
+            latencies[latency_count - 1]);
+    }
+    free(latencies);
+}
+
+// ===== 轨迹回放 =====
+
+const char* job_type_name(int type) {
+    static const char* names[] = { "预约", "取消", "取消某层", "调整楼层", "查看座位", "查看所有", "取消某天", "清空", "导入" };
+    return type >= 0 && type < JOB_STOP ? names[type] : "未知";
+}
+
+// 回放轨迹：speed 为 0 时尽快执行，为 1 时按录制的节奏，2 为两倍速，以此类推。
+// 在单独的数据文件上执行，shards 大于 0 时使用分片模式
+void run_replay(const char* filename, double speed, int shards) {
+    TraceHeader header;
+    unsigned char* image;
+    TraceRecord* records;
+    EngineFloorSnapshot* restores;
+    long count = read_trace(filename, &header, &image, &records, &restores);
+    if (count < 0) {
+        printf("无效的轨迹文件 %s！\n", filename);
+        return;
+    }
+
+    engine_config.data_file = REPLAY_FILENAME;
+    engine_config.floor_file_format = REPLAY_FLOOR_FILENAME;
+    engine_config.open_hour = header.open_hour;
+    engine_config.close_hour = header.close_hour;
+    engine_config.slot_minutes = header.slot_minutes;
+    remove(REPLAY_FILENAME);
+    for (int floor = 0; floor < FLOORS; floor++) {
+        char name[64];
+        snprintf(name, sizeof(name), REPLAY_FLOOR_FILENAME, floor + 1);
+        remove(name);
+    }
+
+    engine = engine_create(&engine_config);
+    if (engine == NULL || engine_import_image(engine, image, header.image_size) != ENGINE_OK ||
+        engine_checksum(engine) != header.initial_checksum) {
+        printf("无法恢复录制开始时的数据！\n");
+        engine_destroy(engine);
+        free(image);
+        free(records);
+        free(restores);
+        return;
+    }
+    free(image);
+    if (shards > 0) {
+        start_shards(shards);
+    }
+
+    static EngineReservation collected[FLOORS][BOOKINGS_PER_FLOOR];
+    int collected_counts[FLOORS];
+    EngineFloorSnapshot snapshot;
+    double* latencies = (double*)malloc(sizeof(double) * (count > 0 ? count : 1));
+    double* sorted = (double*)malloc(sizeof(double) * (count > 0 ? count : 1));
+    EngineFloorSnapshot* next_restore = restores;
+    int mismatched = 0;
+
+    double begin = now_us(), schedule = 0;
+    for (long i = 0; i < count; i++) {
+        const TraceRecord* record = &records[i];
+        if (speed > 0) {
+            schedule += record->delta_us / speed;
+            double wait = begin + schedule - now_us();
+            if (wait > 0) {
+                struct timespec pause;
+                pause.tv_sec = (time_t)(wait / 1e6);
+                pause.tv_nsec = (long)((wait - pause.tv_sec * 1e6) * 1000);
+                thrd_sleep(&pause, NULL);
+            }
+        }
+
+        Job job;
+        memset(&job, 0, sizeof(job));
+        job.type = (JobType)record->type;
+        job.floor = record->floor;
+        job.row = record->row;
+        job.col = record->col;
+        job.day = record->day;
+        job.start = record->start;
+        job.end = record->end;
+        job.new_rows = record->new_rows;
+        job.new_cols = record->new_cols;
+        job.user_char = record->user_char;
+        job.user_type = (UserType)record->user_type;
+        job.snapshot = &snapshot;
+        job.records = collected;
+        job.record_counts = collected_counts;
+        if (job.type == JOB_RESTORE) {
+            job.snapshot = next_restore;
+            next_restore += FLOORS;
+        }
+
+        double start = now_us();
+        if (job.type < JOB_STOP && job.floor >= 0 && job.floor < FLOORS) {
+            run_job(&job);
+        }
+        latencies[i] = now_us() - start;
+        if (job.result != record->result || job.count != record->count) {
+            mismatched++;
+        }
+    }
+    double seconds = (now_us() - begin) / 1e6;
+    stop_shards();
+    uint64_t checksum = engine_checksum(engine);
+
+    printf("回放 %ld 个任务，用时 %.3f 秒（%s）\n", count, seconds,
+        speed > 0 ? "按录制节奏" : "尽快执行");
+    if (speed > 0 && speed != 1) {
+        printf("回放速度 %.2f 倍\n", speed);
+    }
+    printf("%-10s %8s %12s %12s %12s %12s（微秒）\n", "任务", "次数", "录制 p50", "回放 p50", "回放 p99", "回放最大");
+    for (int type = 0; type < JOB_STOP; type++) {
+        int n = 0, m = 0;
+        for (long i = 0; i < count; i++) {
+            if (records[i].type == type) sorted[n++] = records[i].latency_us;
+        }
+        if (n == 0) continue;
+        qsort(sorted, n, sizeof(double), compare_double);
+        double recorded_p50 = sorted[n / 2];
+        for (long i = 0; i < count; i++) {
+            if (records[i].type == type) sorted[m++] = latencies[i];
+        }
+        qsort(sorted, m, sizeof(double), compare_double);
+        printf("%-10s %8d %12.1f %12.1f %12.1f %12.1f\n", job_type_name(type), n,
+            recorded_p50, sorted[m / 2], sorted[m * 99 / 100], sorted[m - 1]);
+    }
+
+    printf("结果与录制时不同的任务：%d 个\n", mismatched);
+    if (header.final_checksum == 0) {
+        printf("最终校验和 %016llx（录制没有正常结束，无法比较）\n", (unsigned long long)checksum);
+    }
+    else {
+        printf("最终校验和 %016llx，录制时 %016llx，%s\n", (unsigned long long)checksum,
+            (unsigned long long)header.final_checksum, checksum == header.final_checksum ? "一致" : "不一致");
+    }
+
+    free(sorted);
+    free(latencies);
+    free(records);
+    free(restores);
+    engine_destroy(engine);
+    remove(REPLAY_FILENAME);
+    for (int floor = 0; floor < FLOORS; floor++) {
+        char name[64];
+        snprintf(name, sizeof(name), REPLAY_FLOOR_FILENAME, floor + 1);
+        remove(name);
+    }
+}
+
+// ===== 多进程压力测试 =====
+// 同时启动多个子进程，用各自的用户字母（A、B、C…）在第 1 层第 1 天的随机座位和时段上
+// 执行预约/取消，冲突很多。每个子进程走正常的 run_job() 路径（每次修改后保存数据文件），
+// 结束时通过管道报告成功的预约数和取消数。父进程检查座位表和数据文件中每个用户的
+// 预约段数是否等于 预约数 - 取消数，不相等就是丢失了更新；再检查每个座位的预约段没有重叠、位图一致。
+// 共享模式下各进程同时写审计日志，再检查每个用户的审计记录数等于 预约数 + 取消数，
+// 并用重新打开的引擎再查一遍（检查索引和段文件）。
+// 另有一个子进程在运行中途被 SIGKILL 杀掉，检查其他进程不会被它留下的锁卡住。
+// 不加 --shared 时各进程独立加载和保存数据文件，可以看到旧方式丢失的更新数
+// （各进程的审计状态也互相独立，这时不记录审计日志）。
+
+#ifdef __linux__
+#define STRESS_MAX_PROCS 25   // 用户字母 A-Y，最后一个字母留给被杀掉的子进程
+
+// ===== 导入检查 =====
+
+void remove_data_files(const char* filename, const char* floor_format) {
+    remove(filename);
+    for (int floor = 0; floor < FLOORS; floor++) {
+        char name[64];
+        snprintf(name, sizeof(name), floor_format, floor + 1);
+        remove(name);
+    }
+}
+
+// 通过分片取得整栋楼的快照，与 expected 比较座位和行列数
+int building_equals(const EngineFloorSnapshot* expected) {
+    static EngineFloorSnapshot current;
+    for (int floor = 0; floor < FLOORS; floor++) {
+        Job job;
+        memset(&job, 0, sizeof(job));
+        job.type = JOB_SNAPSHOT;
+        job.floor = floor;
+        job.snapshot = &current;
+        dispatch_job(&job);
+        if (current.rows != expected[floor].rows || current.cols != expected[floor].cols ||
+            memcmp(current.seats, expected[floor].seats, sizeof(current.seats)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 检查导入是整栋楼一起进行的：快照中最后一层的行列数与当前的不同时（相当于读入文件后
+// 该层被其他进程调整过），导入必须返回 ENGINE_ERR_CHANGED，第1层的修改也不能生效；
+// 行列数一致时整栋楼都被替换。在单独的数据文件上执行，返回是否通过
+int run_restore_check(int shards) {
+    engine_config.data_file = CHECK_FILENAME;
+    engine_config.floor_file_format = CHECK_FLOOR_FILENAME;
+    remove_data_files(CHECK_FILENAME, CHECK_FLOOR_FILENAME);
+    engine = engine_create(&engine_config);
+    if (engine == NULL) {
+        printf("无法初始化预约系统！\n");
+        return 0;
+    }
+    if (shards > 0) {
+        start_shards(shards);
+    }
+
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_RESERVE;
+    job.start = 0;
+    job.end = 1;
+    job.user_char = 'A';
+    job.user_type = USER_NORMAL;
+    dispatch_job(&job);
+    int reserved = job.result == ENGINE_OK;
+
+    // 快照中第1层的预约被取消，最后一层少一行
+    static EngineFloorSnapshot original[FLOORS], floors[FLOORS];
+    for (int floor = 0; floor < FLOORS; floor++) {
+        memset(&job, 0, sizeof(job));
+        job.type = JOB_SNAPSHOT;
+        job.floor = floor;
+        job.snapshot = &original[floor];
+        dispatch_job(&job);
+    }
+    memcpy(floors, original, sizeof(floors));
+    memset(&floors[0].seats[0][0][0], 0, sizeof(Seat));
+    floors[FLOORS - 1].rows--;
+
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_RESTORE;
+    job.snapshot = floors;
+    dispatch_job(&job);
+    EngineStatus changed = job.result;
+    int untouched = building_equals(original);
+
+    floors[FLOORS - 1].rows++;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_RESTORE;
+    job.snapshot = floors;
+    dispatch_job(&job);
+    EngineStatus restored = job.result;
+    int replaced = building_equals(floors);
+
+    stop_shards();
+    engine_destroy(engine);
+    remove_data_files(CHECK_FILENAME, CHECK_FLOOR_FILENAME);
+
+    int passed = reserved && changed == ENGINE_ERR_CHANGED && untouched && restored == ENGINE_OK && replaced;
+    printf("导入检查（%s）：行列数不同时返回 %d、数据%s；行列数一致时返回 %d、数据%s —— %s\n",
+        shards > 0 ? "分片" : "单线程", changed, untouched ? "未修改" : "被修改",
+        restored, replaced ? "已替换" : "未替换", passed ? "通过" : "失败");
+    return passed;
+}
+
+// 子进程：使用自己的引擎，报告成功的预约数和取消数后退出。
+// 与正常启动一样，读到写了一半的数据文件时按损坏处理，使用默认数据继续
+void stress_child(int index, int ops, int report_fd) {
+    engine = engine_create(&engine_config);
+    if (engine == NULL) {
+        _exit(1);
+    }
+    engine_load(engine);
+    srand((unsigned)getpid());
+
+    int rows = floor_rows(0), cols = floor_cols(0), slots = engine_slot_count(engine);
+    int done[2] = { 0, 0 };   // 成功的预约数、取消数
+    for (int i = 0; ops == 0 || i < ops; i++) {
+        Job job;
+        memset(&job, 0, sizeof(job));
+        job.type = (rand() % 3 == 0) ? JOB_CANCEL : JOB_RESERVE;
+        job.row = rand() % rows;
+        job.col = rand() % cols;
+        job.start = rand() % slots;
+        job.end = job.start + 1 + rand() % 2;
+        if (job.end > slots) job.end = slots;
+        job.user_char = (char)('A' + index);
+        job.user_type = USER_NORMAL;
+        run_job(&job);
+        if (job.result == ENGINE_OK) {
+            done[job.type == JOB_RESERVE ? 0 : 1]++;
+        }
+    }
+
+    engine_destroy(engine);
+    ssize_t written = write(report_fd, done, sizeof(done));
+    _exit(written == sizeof(done) ? 0 : 1);
+}
+
+// 统计第 1 层第 1 天每个用户的预约段数，返回预约段重叠或位图不一致的座位数
+int stress_count(SeatEngine* target, int counts[26]) {
+    int broken = 0;
+    memset(counts, 0, sizeof(int) * 26);
+    for (int row = 0; row < ROWS; row++) {
+        for (int col = 0; col < COLS; col++) {
+            Seat seat;
+            if (engine_get_seat(target, 0, row, col, 0, &seat) != ENGINE_OK) continue;
+            uint64_t busy = 0;
+            int ok = 1;
+            for (int i = 0; i < seat.count; i++) {
+                const Booking* booking = &seat.bookings[i];
+                int start = engine_slot_boundary(target, booking->start);
+                int end = engine_slot_boundary(target, booking->end);
+                uint64_t mask = engine_slot_mask(start, end);
+                if (start < 0 || end <= start || (busy & mask)) ok = 0;
+                busy |= mask;
+                if (booking->reserved_by >= 'A' && booking->reserved_by <= 'Z') {
+                    counts[booking->reserved_by - 'A']++;
+                }
+            }
+            broken += !ok || busy != seat.busy;
+        }
+    }
+    return broken;
+}
+
+// 删除审计日志：段号从 1 开始连续编号（压力测试总是从空的审计日志开始，不会压缩）
+void stress_remove_audit(void) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s_index.dat", STRESS_AUDIT_PREFIX);
+    remove(name);
+    for (int id = 1; ; id++) {
+        snprintf(name, sizeof(name), "%s_%06d.seg", STRESS_AUDIT_PREFIX, id);
+        if (remove(name) != 0) break;
+    }
+}
+
+void stress_count_audit(const AuditRecord* record, void* context) {
+    int* counts = (int*)context;
+    if (record->user >= 'A' && record->user <= 'Z') {
+        counts[record->user - 'A']++;
+    }
+}
+
+// 统计审计日志中每个用户的记录数
+void stress_audit(SeatEngine* target, int counts[26]) {
+    memset(counts, 0, sizeof(int) * 26);
+    engine_audit_query(target, '\0', 0, time(NULL) + 1, stress_count_audit, counts, NULL, NULL);
+}
+
+void run_stress(int procs, int ops) {
+    if (procs < 1) procs = 1;
+    if (procs > STRESS_MAX_PROCS) procs = STRESS_MAX_PROCS;
+
+    // 从空数据开始；共享模式下父进程一直连接着段，段在子进程之间不会被删除
+    engine_config.data_file = STRESS_FILENAME;
+    engine_config.audit_prefix = engine_config.shared_name != NULL ? STRESS_AUDIT_PREFIX : NULL;
+    remove(STRESS_FILENAME);
+    stress_remove_audit();
+    engine = engine_create(&engine_config);
+    if (engine == NULL) {
+        printf("无法初始化预约系统！\n");
+        return;
+    }
+    engine_load(engine);
+    for (int floor = 0; floor < FLOORS; floor++) {
+        engine_clear_floor(engine, floor);
+    }
+    engine_save(engine);
+
+    printf("压力测试：%d 个进程 × %d 次操作（%s）\n", procs, ops,
+        engine_config.shared_name != NULL ? "共享内存" : "各进程独立加载");
+    fflush(stdout);
+
+    int fds[STRESS_MAX_PROCS][2];
+    pid_t pids[STRESS_MAX_PROCS + 1];
+    double begin = now_us();
+    for (int i = 0; i <= procs; i++) {
+        if (i < procs && pipe(fds[i]) != 0) {
+            printf("无法创建管道！\n");
+            exit(1);
+        }
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            // 最后一个子进程不停地操作，直到被杀掉
+            stress_child(i, i < procs ? ops : 0, i < procs ? fds[i][1] : -1);
+        }
+        if (i < procs) {
+            close(fds[i][1]);
+        }
+    }
+
+    struct timespec pause = { 0, 50 * 1000000L };
+    thrd_sleep(&pause, NULL);
+    kill(pids[procs], SIGKILL);
+    waitpid(pids[procs], NULL, 0);
+
+    int done[STRESS_MAX_PROCS][2];
+    int expected[26] = { 0 };
+    int failed = 0;
+    memset(done, 0, sizeof(done));
+    for (int i = 0; i < procs; i++) {
+        int status = 0;
+        if (read(fds[i][0], done[i], sizeof(done[i])) != sizeof(done[i])) failed++;
+        expected[i] = done[i][0] - done[i][1];
+        close(fds[i][0]);
+        waitpid(pids[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+    }
+    double seconds = (now_us() - begin) / 1e6;
+
+    // 数据文件用一个独立加载的私有引擎检查；共享模式下再检查共享座位表
+    int in_map[26], in_file[26];
+    EngineConfig file_config = engine_config;
+    file_config.shared_name = NULL;
+    SeatEngine* file_engine = engine_create(&file_config);
+    int broken = 0;
+    if (file_engine == NULL || engine_load(file_engine) != ENGINE_OK) {
+        printf("无法读取数据文件！\n");
+        failed++;
+    }
+    else {
+        broken += stress_count(file_engine, in_file);
+    }
+    engine_destroy(file_engine);
+    if (engine_config.shared_name != NULL) {
+        broken += stress_count(engine, in_map);
+    }
+    else {
+        memcpy(in_map, in_file, sizeof(in_map));
+    }
+
+    int lost = 0;
+    for (int i = 0; i < procs; i++) {
+        int diff_map = abs(expected[i] - in_map[i]);
+        int diff_file = abs(expected[i] - in_file[i]);
+        lost += diff_map > diff_file ? diff_map : diff_file;
+        printf("用户 %c：成功预约减取消 %d，座位表中 %d 段，数据文件中 %d 段\n",
+            'A' + i, expected[i], in_map[i], in_file[i]);
+    }
+    printf("用时 %.3f 秒；丢失的更新 %d 次，不一致的座位 %d 个，异常退出的子进程 %d 个\n",
+        seconds, lost, broken, failed);
+
+    // 审计日志：运行中的共享引擎和重新打开的私有引擎各查一遍
+    if (engine_config.audit_prefix != NULL) {
+        int in_audit[26], reopened[26];
+        stress_audit(engine, in_audit);
+        engine_destroy(engine);
+        engine = NULL;
+        SeatEngine* audit_engine = engine_create(&file_config);
+        if (audit_engine != NULL) {
+            stress_audit(audit_engine, reopened);
+        }
+        else {
+            memset(reopened, 0, sizeof(reopened));
+        }
+        engine_destroy(audit_engine);
+
+        int missing = 0;
+        for (int i = 0; i < procs; i++) {
+            int want = done[i][0] + done[i][1];
+            missing += abs(want - in_audit[i]) + abs(want - reopened[i]);
+            if (in_audit[i] != want || reopened[i] != want) {
+                printf("用户 %c：预约加取消 %d，审计记录 %d 条，重新打开后 %d 条\n",
+                    'A' + i, want, in_audit[i], reopened[i]);
+            }
+        }
+        printf("审计日志：不一致的记录 %d 条（被杀掉的子进程 %c 留下 %d 条）\n",
+            missing, 'A' + procs, in_audit[procs]);
+    }
+
+    engine_destroy(engine);
+    remove(STRESS_FILENAME);
+    stress_remove_audit();
+}
+#endif
+
+// 主函数
+// 用法：seat_bench --bench 操作数 [--shards N]
+//       seat_bench --replay 轨迹文件 [--replay-speed 倍数] [--shards N]
+//       seat_bench --stress 进程数 [--stress-ops 每进程操作数] [--shared 共享内存段名称]
+//       seat_bench --check-restore [--shards N]
+//       以及 [--persist sync|durable|optimistic] [--no-uring] [--audit-retention 天数]
+//       [--audit-segment 每段记录数] [--hours 开馆-闭馆] [--slot-minutes 时段分钟数]
+// 吞吐量测试在正式数据文件上执行，结束后数据不变；回放、压力测试和导入检查使用各自的数据文件。
+// 导入检查不通过时返回非零
+int main(int argc, char* argv[]) {
+    int shard_arg = 0;
+    int check_restore = 0;
+    int bench_ops = 0;
+    int stress_procs = 0;
+    int stress_ops = 2000;
+    const char* replay_path = NULL;
+    double replay_speed = 0;
+
+    engine_config_default(&engine_config);
+    engine_config.data_file = FILENAME;
+    engine_config.floor_file_format = FLOOR_FILENAME;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shard_arg = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_ops = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--persist") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "durable") == 0) engine_config.persist_mode = PERSIST_DURABLE;
+            else if (strcmp(argv[i], "optimistic") == 0) engine_config.persist_mode = PERSIST_OPTIMISTIC;
+            else engine_config.persist_mode = PERSIST_SYNC;
+        }
+        else if (strcmp(argv[i], "--no-uring") == 0) {
+            engine_config.use_uring = 0;
+        }
+        else if (strcmp(argv[i], "--audit-retention") == 0 && i + 1 < argc) {
+            engine_config.audit_retention_days = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--audit-segment") == 0 && i + 1 < argc) {
+            engine_config.audit_segment_records = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+            sscanf(argv[++i], "%d-%d", &engine_config.open_hour, &engine_config.close_hour);
+        }
+        else if (strcmp(argv[i], "--slot-minutes") == 0 && i + 1 < argc) {
+            engine_config.slot_minutes = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--shared") == 0 && i + 1 < argc) {
+            engine_config.shared_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stress") == 0 && i + 1 < argc) {
+            stress_procs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--stress-ops") == 0 && i + 1 < argc) {
+            stress_ops = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) {
+            replay_speed = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--check-restore") == 0) {
+            check_restore = 1;
+        }
+    }
+
+    if (stress_procs > 0) {
+#ifdef __linux__
+        engine_config.persist_mode = PERSIST_SYNC;
+        run_stress(stress_procs, stress_ops); // 压力测试使用自己的审计日志
+#else
+        printf("压力测试只支持 Linux！\n");
+#endif
+        return 0;
+    }
+
+    engine_config.audit_prefix = NULL; // 测试数据不写入审计日志
+    if (replay_path != NULL) {
+        engine_config.shared_name = NULL;
+        run_replay(replay_path, replay_speed, shard_arg);
+        return 0;
+    }
+    if (check_restore) {
+        engine_config.shared_name = NULL;
+        return run_restore_check(shard_arg) ? 0 : 1;
+    }
+    if (bench_ops <= 0) {
+        printf("用法：seat_bench --bench 操作数 | --replay 轨迹文件 | --stress 进程数 | --check-restore\n");
+        return 1;
+    }
+
+    engine = engine_create(&engine_config);
+    if (engine == NULL) {
+        printf("无法初始化预约系统！\n");
+        return 1;
+    }
+    EngineStatus status = engine_load(engine);
+    if (status != ENGINE_OK && status != ENGINE_NO_DATA) {
+        printf("数据文件已损坏，使用默认数据\n");
+    }
+    if (shard_arg > 0) {
+        start_shards(shard_arg);
+    }
+    run_benchmark(bench_ops);
+    stop_shards();
+    engine_save(engine);
+    engine_destroy(engine);
+    return 0;
+}
@@ -0,0 +1,2471 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+#define _GNU_SOURCE
+
+#include "seat_engine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <threads.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/file.h>
+#include <dirent.h>
+#include <signal.h>
+#include <errno.h>
+#include <pthread.h>
+#include <linux/io_uring.h>
+#endif
+
+#define FLOORS ENGINE_FLOORS
+#define ROWS ENGINE_ROWS
+#define COLS ENGINE_COLS
+#define DAYS ENGINE_DAYS
+#define PATH_LEN 260
+#define NAME_LEN (PATH_LEN + 32)  // 由前缀或格式生成的文件名
+#define TEMP_NAME_LEN (NAME_LEN + 32) // 文件名加上临时文件后缀
+
+#define PERSIST_FILES (FLOORS + 1)  // 0 为总数据文件，1..FLOORS 为楼层文件
+// 数据文件镜像：座位、各层行数、各层列数，最后是各层 8 字节的保存序号
+#define MAIN_IMAGE_SIZE (sizeof(Seat) * FLOORS * ROWS * COLS * DAYS + (2 * sizeof(int) + sizeof(uint64_t)) * FLOORS)
+#define FLOOR_IMAGE_SIZE (sizeof(Seat) * ROWS * COLS * DAYS + 2 * sizeof(int) + sizeof(uint64_t))
+
+typedef char dirty_bits_fit[(ROWS * COLS <= 32) ? 1 : -1];
+
+// 旧版数据文件中的座位：每天只有一条整天的预约
+typedef struct {
+    SeatStatus status;
+    char reserved_by;
+    time_t reserve_time;
+} LegacySeat;
+
+// ===== 预约审计日志 =====
+// 每次预约、取消和管理员批量取消都追加一条定长记录，记录写入分段文件
+// <前缀>_NNNNNN.seg，每段最多 segment_records 条。
+// <前缀>_index.dat 登记每段的条数、时间范围和涉及用户的位图（最后一项是正在写入的段），
+// 查询时只读取时间和用户都可能匹配的段。索引和压缩改写的段都经临时文件改名替换，
+// 索引是提交点：段文件以索引登记的条数为准。
+
+// 审计段索引项
+typedef struct {
+    int32_t id;
+    int32_t count;
+    int64_t min_time;
+    int64_t max_time;
+    uint32_t users;        // 位 0-25 对应用户 A-Z，位 26 表示管理员或其他
+    uint32_t reserved;
+} AuditSegment;
+
+typedef struct {
+    int enabled;
+    int segment_records;
+    int retention_days;
+    mtx_t lock;
+    AuditSegment* segments; // 已写满的段
+    int segment_count;
+    int segment_capacity;
+    AuditSegment active;    // 正在写入的段；共享模式下是加锁时从共享内存段取来的副本
+    FILE* file;
+    int file_id;            // file 对应的段号
+    uint32_t generation;    // 共享模式下本进程读到的索引代数
+} AuditLog;
+
+// ===== 异步持久化 =====
+// 修改座位后把数据文件的镜像交给后台写线程，不在请求路径上等待文件写入。
+// Linux 下用 io_uring 一次提交所有待写文件的 write+fsync，
+// 不支持 io_uring 的系统由后台线程用普通文件接口写入。
+// 同一文件在写入前被多次修改时只写最新的镜像，等待者一起完成。
+// 所有保存方式都先写临时文件并刷到磁盘，再改名替换数据文件，崩溃时不会留下写了一半的数据文件。
+
+// 一个数据文件的写入状态
+typedef struct {
+    unsigned char* pending;    // 最新提交的镜像
+    unsigned char* writing;    // 正在写入的镜像
+    size_t size;
+    long submitted_seq;        // 最近一次提交的序号
+    long written_seq;          // 已经写完的序号
+    long failed_seq;           // 最近一次写入失败的序号
+    int has_pending;
+    int fd;                    // io_uring 本次写入的临时文件
+} PersistFile;
+
+typedef struct {
+    int file_id;
+    long seq;
+} PersistTicket;
+
+#ifdef __linux__
+// 最小的 io_uring 封装：只用到 write 和 fsync
+typedef struct {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+} Uring;
+#endif
+
+typedef struct {
+    PersistMode mode;
+    int use_uring;
+    int running;
+    int stopping;
+    PersistFile files[PERSIST_FILES];
+    mtx_t lock;
+    cnd_t wakeup;   // 有新的写入请求
+    cnd_t written;  // 有写入完成
+    thrd_t thread;
+#ifdef __linux__
+    Uring uring;
+#endif
+} Persister;
+
+// ===== 多进程共享座位表 =====
+// 配置了 shared_name 时座位表放在 POSIX 共享内存段里，同一台机器上的多个进程
+// 直接读写同一份数据，不再各自加载数据文件、保存时互相覆盖。
+// 每层一个进程间共享的健壮互斥量：持锁的进程崩溃后，下一个加锁的进程得到
+// EOWNERDEAD，修复该层数据后继续使用。写数据文件时持有段内的总锁，并在锁内重新
+// 生成镜像，文件不会被较旧的镜像覆盖。
+// 审计日志正在写入的段和索引代数也放在段内，由段内的审计锁保护：各进程在锁内追加记录、
+// 换段时改写索引，其他进程发现代数变化后重新读取索引。
+// 每个进程对段持有共享 flock，最后一个退出的进程删除共享内存段；
+// 所有进程都崩溃时段会保留下来，下次启动直接使用其中的数据。
+
+// 座位表：私有模式下在 SeatEngine 内，共享模式下在共享内存段内
+typedef struct {
+    Seat seats[FLOORS][ROWS][COLS][DAYS]; // 5层×4行×4列×7天
+    int floor_rows[FLOORS];    // 每层实际行数
+    int floor_cols[FLOORS];    // 每层实际列数
+} SeatMap;
+
+typedef struct SharedSegment SharedSegment;
+
+#ifdef __linux__
+#define SHARED_MAGIC 0x4c425353u  // "SSBL"
+
+struct SharedSegment {
+    uint32_t magic;
+    uint32_t size;             // sizeof(SharedSegment)，结构变化后旧段不能使用
+    int32_t open_minute;       // 时段配置必须与段一致
+    int32_t slot_minutes;
+    int32_t loaded;            // 已有进程从数据文件加载过
+    int32_t unlinked;          // 段已被删除，正在连接的进程需要重新创建
+    uint32_t versions[FLOORS]; // 每层的修改计数，engine_reload() 据此发现其他进程的修改
+    uint32_t cell_versions[FLOORS][DAYS][ROWS * COLS]; // 每个座位每天的修改计数，预约/取消时加一
+    pthread_mutex_t lock;      // 加载数据和写数据文件
+    pthread_mutex_t floor_locks[FLOORS];
+    uint64_t save_seq;             // 最近一次生成数据文件镜像的保存序号
+    pthread_mutex_t audit_lock;    // 审计日志：正在写入的段和索引
+    int32_t audit_ready;           // 已有进程恢复过审计日志
+    uint32_t audit_generation;     // 索引每改写一次加一
+    AuditSegment audit_active;     // 所有进程共同写入的段
+    SeatMap map;
+};
+#endif
+
+struct SeatEngine {
+    SeatMap* map;              // 指向 own_map 或共享内存段中的座位表
+    SeatMap own_map;
+
+    SharedSegment* shared;     // 共享模式下的共享内存段，私有模式为 NULL
+    int shared_fd;
+    int shared_loader;         // 本进程从数据文件加载了共享座位表
+    char shared_name[PATH_LEN];
+    uint32_t shared_seen[FLOORS]; // engine_reload() 上次看到的修改计数和行列数
+    int shared_rows[FLOORS];
+    int shared_cols[FLOORS];
+    uint32_t shared_cells[FLOORS][DAYS][ROWS * COLS]; // engine_reload() 上次看到的每个座位的修改计数
+
+    int open_minute;           // 第一个时段的开始时间（分钟）
+    int slot_minutes;
+    int slot_count;
+
+    char data_file[PATH_LEN];
+    char floor_file_format[PATH_LEN];
+    char audit_prefix[PATH_LEN];
+
+    // 看板使用的脏位：每层每天一个位图，位 row * COLS + col 表示该座位有变化。
+    // 每层的脏位只由操作该层的线程写入
+    uint32_t dirty_cells[FLOORS][DAYS];
+    int layout_dirty[FLOORS]; // 行列数变化，需要整层重画
+
+    // 保存序号：复制一层座位时在该层的锁内加一并写在镜像末尾，楼层文件的序号比总数据文件中
+    // 该层的序号大，说明它的内容更新。指向 own_save_seq 或共享内存段中的计数
+    uint64_t* save_seq;
+    uint64_t own_save_seq;
+
+    // engine_reload() 上次读到的保存序号：总数据文件各层的和各楼层文件的
+    uint64_t reload_main_seq[FLOORS];
+    uint64_t reload_floor_seq[FLOORS];
+
+    AuditLog audit;
+    Persister persist;
+};
+
+void engine_config_default(EngineConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->data_file = "library_data.dat";
+    config->floor_file_format = "library_data_f%d.dat";
+    config->audit_prefix = "audit";
+    config->audit_segment_records = 4096;
+    config->audit_retention_days = 0;
+    config->persist_mode = PERSIST_SYNC;
+    config->use_uring = 1;
+    config->open_hour = 8;
+    config->close_hour = 22;
+    config->slot_minutes = 60;
+}
+
+static void copy_path(char* buffer, const char* path) {
+    snprintf(buffer, PATH_LEN, "%s", path ? path : "");
+}
+
+static void floor_file_name(const SeatEngine* engine, char* buffer, int floor) {
+    snprintf(buffer, NAME_LEN, engine->floor_file_format, floor + 1);
+}
+
+static int valid_floor(int floor) {
+    return floor >= 0 && floor < FLOORS;
+}
+
+static int valid_day(int day) {
+    return day >= 0 && day < DAYS;
+}
+
+static void reset_floor_size(const SeatEngine* engine, int floor) {
+    engine->map->floor_rows[floor] = ROWS;
+    engine->map->floor_cols[floor] = COLS;
+}
+
+// 临时文件名：<文件名>.<进程号>.tmp，不同进程同时保存同一个文件时互不干扰
+static void temp_file_name(const char* filename, char* buffer) {
+#ifdef _WIN32
+    snprintf(buffer, TEMP_NAME_LEN, "%s.%d.tmp", filename, _getpid());
+#else
+    snprintf(buffer, TEMP_NAME_LEN, "%s.%ld.tmp", filename, (long)getpid());
+#endif
+}
+
+// 用临时文件替换目标文件（目标已存在时覆盖）
+static int rename_over(const char* temp, const char* filename) {
+#ifdef _WIN32
+    return MoveFileExA(temp, filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(temp, filename) == 0;
+#endif
+}
+
+// 写入一个文件：先写临时文件并刷到磁盘，再改名替换原文件。
+// 写到一半时进程或机器崩溃，原文件仍是完整的旧内容
+static int write_image(const char* filename, const void* image, size_t size) {
+    char temp[TEMP_NAME_LEN];
+    temp_file_name(filename, temp);
+    FILE* file = fopen(temp, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+    int ok = (size == 0 || fwrite(image, size, 1, file) == 1) && fflush(file) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = fclose(file) == 0 && ok;
+    if (!ok || !rename_over(temp, filename)) {
+        remove(temp);
+        return 0;
+    }
+    return 1;
+}
+
+// ===== 时段 =====
+
+int engine_slot_count(const SeatEngine* engine) {
+    return engine->slot_count;
+}
+
+int engine_slot_minute(const SeatEngine* engine, int slot) {
+    return engine->open_minute + slot * engine->slot_minutes;
+}
+
+int engine_slot_boundary(const SeatEngine* engine, int minute) {
+    int offset = minute - engine->open_minute;
+    if (offset < 0 || offset % engine->slot_minutes != 0 || offset / engine->slot_minutes > engine->slot_count) {
+        return -1;
+    }
+    return offset / engine->slot_minutes;
+}
+
+uint64_t engine_slot_mask(int start, int end) {
+    if (start < 0) start = 0;
+    if (end > ENGINE_MAX_SLOTS) end = ENGINE_MAX_SLOTS;
+    if (start >= end) {
+        return 0;
+    }
+    uint64_t bits = (end - start == 64) ? ~0ull : (1ull << (end - start)) - 1;
+    return bits << start;
+}
+
+// 一段预约占用的时段：与预约时间有重叠的时段都算占用（时段长度改过时向外取整）
+static uint64_t booking_mask(const SeatEngine* engine, const Booking* booking) {
+    int first = booking->start - engine->open_minute;
+    int last = booking->end - engine->open_minute;
+    if (last <= 0) {
+        return 0;
+    }
+    first = first > 0 ? first / engine->slot_minutes : 0;
+    last = (last + engine->slot_minutes - 1) / engine->slot_minutes;
+    return engine_slot_mask(first, last < engine->slot_count ? last : engine->slot_count);
+}
+
+// 由预约段重新计算时段位图，预约段数无效时清空
+static void rebuild_busy(const SeatEngine* engine, Seat* seat) {
+    if (seat->count < 0 || seat->count > ENGINE_MAX_BOOKINGS) {
+        seat->count = 0;
+    }
+    seat->busy = 0;
+    for (int i = 0; i < seat->count; i++) {
+        seat->busy |= booking_mask(engine, &seat->bookings[i]);
+    }
+}
+
+// ===== 共享座位表实现 =====
+
+// 持锁的进程在修改途中退出时，该层可能留下插入或删除到一半的预约段：
+// 插入时最后一段已经后移到 count 处但 count 还没有增加，删除时后面的段已经前移但 count 还没有减少。
+// 多检查 count 处的一段，去掉无效或与前一段重叠的段，再重新计算位图
+// （count 之后的空位在删除时清零，不会被误认为预约）
+static void repair_floor(const SeatEngine* engine, int floor) {
+    SeatMap* map = engine->map;
+    if (map->floor_rows[floor] <= 0 || map->floor_rows[floor] > ROWS ||
+        map->floor_cols[floor] <= 0 || map->floor_cols[floor] > COLS) {
+        reset_floor_size(engine, floor);
+    }
+
+    for (int row = 0; row < ROWS; row++) {
+        for (int col = 0; col < COLS; col++) {
+            for (int day = 0; day < DAYS; day++) {
+                Seat* seat = &map->seats[floor][row][col][day];
+                int count = seat->count < 0 ? 0 : seat->count + 1;
+                if (count > ENGINE_MAX_BOOKINGS) count = ENGINE_MAX_BOOKINGS;
+                int kept = 0;
+                for (int i = 0; i < count; i++) {
+                    const Booking* booking = &seat->bookings[i];
+                    if (booking->start >= booking->end || (kept > 0 && booking->start < seat->bookings[kept - 1].end)) {
+                        continue;
+                    }
+                    seat->bookings[kept++] = *booking;
+                }
+                memset(&seat->bookings[kept], 0, sizeof(Booking) * (ENGINE_MAX_BOOKINGS - kept));
+                seat->count = kept;
+                rebuild_busy(engine, seat);
+            }
+        }
+    }
+}
+
+#ifdef __linux__
+static int init_robust_mutex(pthread_mutex_t* mutex) {
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr) != 0) {
+        return 0;
+    }
+    int ok = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) == 0 &&
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) == 0 &&
+        pthread_mutex_init(mutex, &attr) == 0;
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+}
+
+// 新建的段（ftruncate 后全为 0）：填写配置、默认行列数并初始化互斥量，magic 最后写入
+static int shared_init(const SeatEngine* engine, SharedSegment* shared) {
+    shared->open_minute = engine->open_minute;
+    shared->slot_minutes = engine->slot_minutes;
+    for (int floor = 0; floor < FLOORS; floor++) {
+        shared->map.floor_rows[floor] = ROWS;
+        shared->map.floor_cols[floor] = COLS;
+        if (!init_robust_mutex(&shared->floor_locks[floor])) {
+            return 0;
+        }
+    }
+    if (!init_robust_mutex(&shared->lock) || !init_robust_mutex(&shared->audit_lock)) {
+        return 0;
+    }
+    shared->size = sizeof(SharedSegment);
+    shared->magic = SHARED_MAGIC;
+    return 1;
+}
+
+// 打开或创建共享内存段；段的结构或时段配置与本进程不一致时失败
+static int shared_open(SeatEngine* engine, const char* name) {
+    copy_path(engine->shared_name, name);
+
+    while (1) {
+        int fd = shm_open(engine->shared_name, O_RDWR | O_CREAT, 0600);
+        if (fd < 0) {
+            return 0;
+        }
+
+        // 连接期间一直持有共享锁；新建的段在排他锁下初始化，之后再降回共享锁
+        struct stat segment_stat;
+        int created = 0;
+        if (flock(fd, LOCK_SH) != 0 || fstat(fd, &segment_stat) != 0) {
+            close(fd);
+            return 0;
+        }
+        if (segment_stat.st_size == 0) {
+            if (flock(fd, LOCK_EX) != 0 || fstat(fd, &segment_stat) != 0) {
+                close(fd);
+                return 0;
+            }
+            if (segment_stat.st_size == 0) {
+                if (ftruncate(fd, sizeof(SharedSegment)) != 0) {
+                    close(fd);
+                    return 0;
+                }
+                created = 1;
+            }
+        }
+        if (!created && segment_stat.st_size != (off_t)sizeof(SharedSegment)) {
+            close(fd);
+            return 0;
+        }
+
+        SharedSegment* shared = (SharedSegment*)mmap(NULL, sizeof(SharedSegment),
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (shared == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        if (created && !shared_init(engine, shared)) {
+            shm_unlink(engine->shared_name);
+        }
+
+        if (shared->magic != SHARED_MAGIC || shared->size != sizeof(SharedSegment) ||
+            shared->open_minute != engine->open_minute || shared->slot_minutes != engine->slot_minutes ||
+            flock(fd, LOCK_SH) != 0) {
+            munmap(shared, sizeof(SharedSegment));
+            close(fd);
+            return 0;
+        }
+        if (shared->unlinked) {
+            // 打开后最后一个进程正好退出并删除了段，重新创建
+            munmap(shared, sizeof(SharedSegment));
+            close(fd);
+            continue;
+        }
+
+        engine->shared = shared;
+        engine->shared_fd = fd;
+        engine->map = &shared->map;
+        engine->save_seq = &shared->save_seq;
+        return 1;
+    }
+}
+
+// 断开共享内存段；能拿到排他锁说明没有其他进程连接（崩溃进程的锁已由内核释放），删除段
+static void shared_close(SeatEngine* engine) {
+    if (engine->shared == NULL) return;
+    if (flock(engine->shared_fd, LOCK_EX | LOCK_NB) == 0) {
+        engine->shared->unlinked = 1;
+        shm_unlink(engine->shared_name);
+    }
+    munmap(engine->shared, sizeof(SharedSegment));
+    close(engine->shared_fd);
+    engine->shared = NULL;
+    engine->map = &engine->own_map;
+    engine->save_seq = &engine->own_save_seq;
+}
+
+// 加健壮互斥量，持锁进程已崩溃时返回 1，调用者修复数据后标记为一致
+static int lock_robust(pthread_mutex_t* mutex) {
+    return pthread_mutex_lock(mutex) == EOWNERDEAD;
+}
+#endif
+
+// 共享模式下锁住一层；私有模式下由调用者保证互斥（见头文件的线程约定），这里什么也不做
+static void lock_floor(const SeatEngine* engine, int floor) {
+#ifdef __linux__
+    SharedSegment* shared = engine->shared;
+    if (shared != NULL && lock_robust(&shared->floor_locks[floor])) {
+        repair_floor(engine, floor);
+        shared->versions[floor]++;
+        uint32_t* cells = &shared->cell_versions[floor][0][0];
+        for (int i = 0; i < DAYS * ROWS * COLS; i++) cells[i]++;
+        pthread_mutex_consistent(&shared->floor_locks[floor]);
+    }
+#else
+    (void)engine;
+    (void)floor;
+#endif
+}
+
+static void unlock_floor(const SeatEngine* engine, int floor) {
+#ifdef __linux__
+    if (engine->shared != NULL) {
+        pthread_mutex_unlock(&engine->shared->floor_locks[floor]);
+    }
+#else
+    (void)engine;
+    (void)floor;
+#endif
+}
+
+// 共享模式下加载数据和写数据文件时持有的总锁。持锁进程崩溃时可能留下写到一半的文件，
+// 下一次保存会重写，不需要修复
+static void lock_files(const SeatEngine* engine) {
+#ifdef __linux__
+    if (engine->shared != NULL && lock_robust(&engine->shared->lock)) {
+        pthread_mutex_consistent(&engine->shared->lock);
+    }
+#else
+    (void)engine;
+#endif
+}
+
+static void unlock_files(const SeatEngine* engine) {
+#ifdef __linux__
+    if (engine->shared != NULL) {
+        pthread_mutex_unlock(&engine->shared->lock);
+    }
+#else
+    (void)engine;
+#endif
+}
+
+// 增加该层的修改计数，共享模式下其他进程的 engine_reload() 据此发现变化
+static void touch_floor(SeatEngine* engine, int floor) {
+#ifdef __linux__
+    if (engine->shared != NULL) {
+        engine->shared->versions[floor]++;
+    }
+#else
+    (void)engine;
+    (void)floor;
+#endif
+}
+
+// 共享模式下增加一个座位某天的修改计数，其他进程的 engine_reload() 据此只标记这一格
+static void touch_cell(SeatEngine* engine, int floor, int row, int col, int day) {
+#ifdef __linux__
+    if (engine->shared != NULL) {
+        engine->shared->cell_versions[floor][day][row * COLS + col]++;
+    }
+#else
+    (void)engine;
+    (void)floor;
+    (void)row;
+    (void)col;
+    (void)day;
+#endif
+}
+
+// 整层被替换：所有座位标记为脏
+static void mark_floor_dirty(SeatEngine* engine, int floor) {
+    for (int day = 0; day < DAYS; day++) {
+        engine->dirty_cells[floor][day] = (1u << (ROWS * COLS)) - 1;
+        for (int row = 0; row < ROWS; row++) {
+            for (int col = 0; col < COLS; col++) {
+                touch_cell(engine, floor, row, col, day);
+            }
+        }
+    }
+    touch_floor(engine, floor);
+}
+
+// 记下各层当前的修改计数和行列数，之后的 engine_reload() 只报告新的变化
+static void shared_remember(SeatEngine* engine) {
+#ifdef __linux__
+    for (int floor = 0; floor < FLOORS && engine->shared != NULL; floor++) {
+        lock_floor(engine, floor);
+        engine->shared_seen[floor] = engine->shared->versions[floor];
+        memcpy(engine->shared_cells[floor], engine->shared->cell_versions[floor], sizeof(engine->shared_cells[floor]));
+        engine->shared_rows[floor] = engine->map->floor_rows[floor];
+        engine->shared_cols[floor] = engine->map->floor_cols[floor];
+        unlock_floor(engine, floor);
+    }
+#else
+    (void)engine;
+#endif
+}
+
+// ===== 审计日志实现 =====
+
+// 用户字母对应的位
+static uint32_t audit_user_bit(char user) {
+    if (user >= 'A' && user <= 'Z') {
+        return 1u << (user - 'A');
+    }
+    return 1u << 26;
+}
+
+static void audit_segment_name(const SeatEngine* engine, char* buffer, int id) {
+    snprintf(buffer, NAME_LEN, "%s_%06d.seg", engine->audit_prefix, id);
+}
+
+static void audit_index_name(const SeatEngine* engine, char* buffer) {
+    snprintf(buffer, NAME_LEN, "%s_index.dat", engine->audit_prefix);
+}
+
+// 把记录计入段的时间范围和用户位图
+static void audit_account(AuditSegment* segment, const AuditRecord* record) {
+    if (segment->count == 0 || record->event_time < segment->min_time) {
+        segment->min_time = record->event_time;
+    }
+    if (segment->count == 0 || record->event_time > segment->max_time) {
+        segment->max_time = record->event_time;
+    }
+    segment->users |= audit_user_bit(record->user) | audit_user_bit(record->actor);
+    segment->count++;
+}
+
+// 读取段的前 limit 条记录，返回记录数，buffer 由调用者 free。
+// 已写满的段以索引登记的条数为准：压缩在提交新索引之前中断时，合并目标的文件里可能多出记录
+static int audit_read_segment(const SeatEngine* engine, int id, int limit, AuditRecord** buffer) {
+    char filename[NAME_LEN];
+    audit_segment_name(engine, filename, id);
+    *buffer = NULL;
+
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    int capacity = (int)(size / (long)sizeof(AuditRecord));
+    if (capacity > limit) {
+        capacity = limit;
+    }
+    *buffer = (AuditRecord*)malloc(sizeof(AuditRecord) * (capacity > 0 ? capacity : 1));
+    if (*buffer == NULL) {
+        fclose(file);
+        return 0;
+    }
+    int count = (int)fread(*buffer, sizeof(AuditRecord), capacity, file);
+    fclose(file);
+    return count;
+}
+
+// 重写索引文件：已写满的段、待删除的段（count 为 -1）、最后一项是正在写入的段。
+// 先写临时文件再改名，写到一半时崩溃旧索引仍然完整
+static int audit_write_index(SeatEngine* engine, const int32_t* dropped, int dropped_count) {
+    AuditLog* audit = &engine->audit;
+    int total = audit->segment_count + dropped_count + 1;
+    AuditSegment* entries = (AuditSegment*)calloc(total, sizeof(AuditSegment));
+    if (entries == NULL) {
+        return 0;
+    }
+    if (audit->segment_count > 0) {
+        memcpy(entries, audit->segments, sizeof(AuditSegment) * audit->segment_count);
+    }
+    for (int i = 0; i < dropped_count; i++) {
+        entries[audit->segment_count + i].id = dropped[i];
+        entries[audit->segment_count + i].count = -1;
+    }
+    entries[total - 1] = audit->active;
+
+    char filename[NAME_LEN];
+    audit_index_name(engine, filename);
+    int ok = write_image(filename, entries, sizeof(AuditSegment) * total);
+    free(entries);
+    return ok;
+}
+
+static void audit_push_segment(AuditLog* audit, const AuditSegment* segment) {
+    if (audit->segment_count == audit->segment_capacity) {
+        int capacity = audit->segment_capacity ? audit->segment_capacity * 2 : 16;
+        AuditSegment* segments = (AuditSegment*)realloc(audit->segments, sizeof(AuditSegment) * capacity);
+        if (segments == NULL) {
+            return;
+        }
+        audit->segments = segments;
+        audit->segment_capacity = capacity;
+    }
+    audit->segments[audit->segment_count++] = *segment;
+}
+
+// 压缩时正在拼装的段：最后一个保留的段的全部记录
+typedef struct {
+    AuditRecord* records;
+    int count;
+    int capacity;
+    int changed;           // 与段文件的内容不同，需要写回
+} AuditBuilder;
+
+static int builder_append(AuditBuilder* builder, const AuditRecord* records, int count) {
+    if (builder->count + count > builder->capacity) {
+        int capacity = builder->count + count;
+        AuditRecord* grown = (AuditRecord*)realloc(builder->records, sizeof(AuditRecord) * (capacity > 0 ? capacity : 1));
+        if (grown == NULL) {
+            return 0;
+        }
+        builder->records = grown;
+        builder->capacity = capacity;
+    }
+    if (count > 0) {
+        memcpy(builder->records + builder->count, records, sizeof(AuditRecord) * count);
+    }
+    builder->count += count;
+    return 1;
+}
+
+// 把拼装好的段写回段文件（临时文件改名），没有变化时什么也不做
+static int builder_flush(const SeatEngine* engine, AuditBuilder* builder, int id) {
+    int ok = 1;
+    if (builder->changed) {
+        char filename[NAME_LEN];
+        audit_segment_name(engine, filename, id);
+        ok = write_image(filename, builder->records, sizeof(AuditRecord) * builder->count);
+    }
+    builder->count = 0;
+    builder->changed = 0;
+    return ok;
+}
+
+// 压缩已写满的段：删除超出保留期的记录，再把相邻的未满段合并。只在打开审计日志时执行，
+// 不占用预约/取消的请求路径。
+// 改动过的段都先写临时文件再改名替换，全部成功后才提交新索引（其中登记待删除的段），
+// 最后删除不再需要的段文件。提交前中断时旧索引仍然有效：裁剪过的段只是少了过期记录，
+// 合并目标多出的记录超出旧索引登记的条数，不会被读到；提交后中断时，
+// 下次打开按索引中的待删除项删除残留的段文件
+static void audit_compact(SeatEngine* engine) {
+    AuditLog* audit = &engine->audit;
+    time_t cutoff = audit->retention_days > 0 ? time(NULL) - (time_t)audit->retention_days * 86400 : 0;
+    int count = audit->segment_count;
+    if (count == 0) {
+        return;
+    }
+
+    AuditSegment* kept = (AuditSegment*)malloc(sizeof(AuditSegment) * count);
+    int32_t* dropped = (int32_t*)calloc(count, sizeof(int32_t));
+    AuditBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    int kept_count = 0, dropped_count = 0;
+    int loaded = 0;        // builder 中是 kept[kept_count - 1] 的记录
+    int last_trimmed = 0;  // kept[kept_count - 1] 本次被裁剪过
+    int ok = kept != NULL && dropped != NULL;
+
+    for (int i = 0; i < count && ok; i++) {
+        AuditSegment segment = audit->segments[i];
+        if (segment.max_time < cutoff) {
+            dropped[dropped_count++] = segment.id;
+            continue;
+        }
+
+        // 部分过期：只留下保留期内的记录
+        AuditRecord* records = NULL;
+        int record_count = 0;
+        int trimmed = segment.min_time < cutoff;
+        if (trimmed) {
+            record_count = audit_read_segment(engine, segment.id, segment.count, &records);
+            AuditSegment recount;
+            memset(&recount, 0, sizeof(recount));
+            recount.id = segment.id;
+            int n = 0;
+            for (int j = 0; j < record_count; j++) {
+                if (records[j].event_time >= cutoff) {
+                    records[n++] = records[j];
+                    audit_account(&recount, &records[j]);
+                }
+            }
+            record_count = n;
+            segment = recount;
+            if (record_count == 0) {
+                free(records);
+                dropped[dropped_count++] = segment.id;
+                continue;
+            }
+        }
+
+        // 与前一段合并后不超过段大小时并入前一段。本次裁剪过的段不作合并目标：
+        // 它的记录已经前移，提交前中断时旧索引按原条数读取会读到并入的记录
+        if (kept_count > 0 && !last_trimmed
+            && kept[kept_count - 1].count + segment.count <= audit->segment_records) {
+            AuditSegment* target = &kept[kept_count - 1];
+            if (!loaded) {
+                AuditRecord* existing;
+                int existing_count = audit_read_segment(engine, target->id, target->count, &existing);
+                ok = builder_append(&builder, existing, existing_count);
+                free(existing);
+                loaded = 1;
+            }
+            if (!trimmed) {
+                record_count = audit_read_segment(engine, segment.id, segment.count, &records);
+            }
+            ok = ok && builder_append(&builder, records, record_count);
+            free(records);
+            if (ok) {
+                // 按实际读到的记录重新统计
+                AuditSegment merged;
+                memset(&merged, 0, sizeof(merged));
+                merged.id = target->id;
+                for (int j = 0; j < builder.count; j++) {
+                    audit_account(&merged, &builder.records[j]);
+                }
+                *target = merged;
+                builder.changed = 1;
+                dropped[dropped_count++] = segment.id;
+            }
+            continue;
+        }
+
+        // 成为新的保留段：先写回上一个保留段
+        if (kept_count > 0) {
+            ok = builder_flush(engine, &builder, kept[kept_count - 1].id);
+        }
+        loaded = 0;
+        if (ok && trimmed) {
+            ok = builder_append(&builder, records, record_count);
+            builder.changed = 1;
+            loaded = 1;
+        }
+        free(records);
+        kept[kept_count++] = segment;
+        last_trimmed = trimmed;
+    }
+    if (ok && kept_count > 0) {
+        ok = builder_flush(engine, &builder, kept[kept_count - 1].id);
+    }
+    free(builder.records);
+
+    // 提交新索引后才删除段文件；任何一步失败都保留原来的索引
+    if (ok && (kept_count != count || dropped_count > 0)) {
+        AuditSegment* original = audit->segments;
+        int original_count = audit->segment_count;
+        audit->segments = kept;
+        audit->segment_count = kept_count;
+        if (audit_write_index(engine, dropped, dropped_count)) {
+            kept = original;
+            for (int i = 0; i < dropped_count; i++) {
+                char filename[NAME_LEN];
+                audit_segment_name(engine, filename, dropped[i]);
+                remove(filename);
+            }
+        }
+        else {
+            audit->segments = original;
+            audit->segment_count = original_count;
+        }
+    }
+    free(kept);
+    free(dropped);
+}
+
+// 读取索引：已写满的段放入 segments，返回最后一项（正在写入的段）的编号。
+// remove_dropped 时删除登记为待删除的段文件，返回时 *dropped 为待删除项的个数
+static int audit_load_index(SeatEngine* engine, int remove_dropped, int* dropped) {
+    AuditLog* audit = &engine->audit;
+    char filename[NAME_LEN];
+    int tombstones = 0;
+    audit->segment_count = 0;
+
+    audit_index_name(engine, filename);
+    FILE* file = fopen(filename, "rb");
+    if (file != NULL) {
+        AuditSegment segment;
+        while (fread(&segment, sizeof(segment), 1, file) == 1) {
+            if (segment.count < 0) {
+                if (remove_dropped) {
+                    audit_segment_name(engine, filename, segment.id);
+                    remove(filename);
+                }
+                tombstones++;
+                continue;
+            }
+            audit_push_segment(audit, &segment);
+        }
+        fclose(file);
+    }
+    if (dropped != NULL) {
+        *dropped = tombstones;
+    }
+    return audit->segment_count > 0 ? audit->segments[--audit->segment_count].id : 1;
+}
+
+// 按索引和段文件恢复审计日志：删除待删除的段，重新统计正在写入的段。
+// compact 时再压缩已写满的段，只在没有其他进程使用审计日志时进行
+static void audit_restore(SeatEngine* engine, int compact) {
+    AuditLog* audit = &engine->audit;
+    char filename[NAME_LEN];
+    int tombstones;
+    int active_id = audit_load_index(engine, 1, &tombstones);
+    memset(&audit->active, 0, sizeof(audit->active));
+    audit->active.id = active_id;
+
+    // 上次运行未写满的段需要重新统计；崩溃时末尾可能留下半条记录，去掉后再继续追加
+    AuditRecord* records;
+    int count = audit_read_segment(engine, audit->active.id, INT_MAX, &records);
+    for (int i = 0; i < count; i++) {
+        audit_account(&audit->active, &records[i]);
+    }
+    struct stat segment_stat;
+    audit_segment_name(engine, filename, audit->active.id);
+    if (stat(filename, &segment_stat) == 0 && segment_stat.st_size % (long)sizeof(AuditRecord) != 0) {
+        write_image(filename, records, sizeof(AuditRecord) * count);
+    }
+    free(records);
+
+    if (compact) {
+        audit_compact(engine);
+    }
+    if (tombstones > 0) {
+        audit_write_index(engine, NULL, 0);
+    }
+}
+
+// 打开正在写入的段文件
+static void audit_open_file(SeatEngine* engine) {
+    AuditLog* audit = &engine->audit;
+    char filename[NAME_LEN];
+    if (audit->file != NULL) {
+        fclose(audit->file);
+    }
+    audit_segment_name(engine, filename, audit->active.id);
+    audit->file = fopen(filename, "ab");
+    audit->file_id = audit->active.id;
+}
+
+#ifdef __linux__
+// 共享模式：持有段内审计锁时与其他进程同步。索引被改写过（代数变化）时重新读取已写满的段，
+// 并重新打开段文件（恢复时可能替换了段文件）
+static void audit_sync(SeatEngine* engine) {
+    AuditLog* audit = &engine->audit;
+    SharedSegment* shared = engine->shared;
+    int reopen = audit->file == NULL || audit->file_id != shared->audit_active.id;
+    if (audit->generation != shared->audit_generation) {
+        audit_load_index(engine, 0, NULL);
+        audit->generation = shared->audit_generation;
+        reopen = 1;
+    }
+    audit->active = shared->audit_active;
+    if (reopen) {
+        audit_open_file(engine);
+    }
+}
+
+// 恢复后的状态写回共享内存段，增加代数让其他进程重新读取
+static void audit_publish(SeatEngine* engine) {
+    SharedSegment* shared = engine->shared;
+    shared->audit_active = engine->audit.active;
+    shared->audit_generation++;
+    shared->audit_ready = 1;
+}
+#endif
+
+// 加审计锁。共享模式下还持有段内的审计锁：持锁进程崩溃时按索引和段文件重新统计正在写入的段
+static void audit_lock(SeatEngine* engine) {
+    mtx_lock(&engine->audit.lock);
+#ifdef __linux__
+    SharedSegment* shared = engine->shared;
+    if (shared != NULL) {
+        if (lock_robust(&shared->audit_lock)) {
+            audit_restore(engine, 0);
+            audit_publish(engine);
+            pthread_mutex_consistent(&shared->audit_lock);
+        }
+        audit_sync(engine);
+    }
+#endif
+}
+
+static void audit_unlock(SeatEngine* engine) {
+#ifdef __linux__
+    SharedSegment* shared = engine->shared;
+    if (shared != NULL) {
+        shared->audit_active = engine->audit.active;
+        pthread_mutex_unlock(&shared->audit_lock);
+    }
+#endif
+    mtx_unlock(&engine->audit.lock);
+}
+
+// 打开审计日志。共享模式下由第一个打开的进程恢复和压缩，其他进程直接使用段内的状态
+static void audit_open(SeatEngine* engine) {
+    AuditLog* audit = &engine->audit;
+    mtx_init(&audit->lock, mtx_plain);
+#ifdef __linux__
+    SharedSegment* shared = engine->shared;
+    if (shared != NULL) {
+        int dead = lock_robust(&shared->audit_lock);
+        if (dead || !shared->audit_ready) {
+            audit_restore(engine, !shared->audit_ready);
+            audit_publish(engine);
+        }
+        if (dead) {
+            pthread_mutex_consistent(&shared->audit_lock);
+        }
+        audit_sync(engine);
+        pthread_mutex_unlock(&shared->audit_lock);
+        return;
+    }
+#endif
+    audit_restore(engine, 1);
+    audit_open_file(engine);
+}
+
+// 当前段写满后登记到索引并开始新段；压缩留到下次打开时进行
+static void audit_roll_segment(SeatEngine* engine) {
+    AuditLog* audit = &engine->audit;
+    audit_push_segment(audit, &audit->active);
+
+    int next_id = audit->active.id + 1;
+    memset(&audit->active, 0, sizeof(audit->active));
+    audit->active.id = next_id;
+    audit_write_index(engine, NULL, 0);
+#ifdef __linux__
+    if (engine->shared != NULL) {
+        audit->generation = ++engine->shared->audit_generation;
+    }
+#endif
+
+    audit_open_file(engine);
+}
+
+// 追加一条审计记录
+static void audit_append(SeatEngine* engine, AuditEvent event, char actor,
+    int floor, int row, int col, int day, const Booking* booking) {
+    AuditLog* audit = &engine->audit;
+    if (!audit->enabled || audit->file == NULL) {
+        return;
+    }
+
+    AuditRecord record;
+    memset(&record, 0, sizeof(record));
+    record.event_time = (int64_t)time(NULL);
+    record.reserve_time = booking->reserve_time;
+    record.event = (uint8_t)event;
+    record.user = booking->reserved_by;
+    record.actor = actor;
+    record.floor = (uint8_t)floor;
+    record.row = (uint8_t)row;
+    record.col = (uint8_t)col;
+    record.day = (uint8_t)day;
+    record.start = booking->start;
+    record.end = booking->end;
+
+    // 共享模式下各进程以追加方式写同一个段文件，每条记录在锁内写出，条数与文件一致
+    audit_lock(engine);
+    fwrite(&record, sizeof(record), 1, audit->file);
+    if (engine->shared != NULL) {
+        fflush(audit->file);
+    }
+    audit_account(&audit->active, &record);
+    if (audit->active.count >= audit->segment_records) {
+        audit_roll_segment(engine);
+    }
+    audit_unlock(engine);
+}
+
+// 把缓冲的审计记录写入文件，与座位数据的保存同步进行
+void engine_audit_flush(SeatEngine* engine) {
+    AuditLog* audit = &engine->audit;
+    if (!audit->enabled || audit->file == NULL) return;
+    mtx_lock(&audit->lock);
+    fflush(audit->file);
+    mtx_unlock(&audit->lock);
+}
+
+static void audit_close(SeatEngine* engine) {
+    AuditLog* audit = &engine->audit;
+    if (!audit->enabled) return;
+    if (audit->file != NULL) {
+        fclose(audit->file);
+        audit->file = NULL;
+    }
+    free(audit->segments);
+    audit->segments = NULL;
+    audit->segment_count = audit->segment_capacity = 0;
+    mtx_destroy(&audit->lock);
+}
+
+// 段是否可能包含匹配的记录
+static int audit_segment_matches(const AuditSegment* segment, uint32_t user_mask, time_t from, time_t to) {
+    return segment->count > 0 &&
+        segment->max_time >= from && segment->min_time <= to &&
+        (segment->users & user_mask) != 0;
+}
+
+// 查询某用户（'\0' 表示全部）在 [from, to] 内的记录，每条匹配记录调用一次 callback，返回匹配数
+int engine_audit_query(SeatEngine* engine, char user, time_t from, time_t to,
+    AuditCallback callback, void* context, int* segments_read, int* segments_total) {
+    AuditLog* audit = &engine->audit;
+    uint32_t user_mask = user ? audit_user_bit(user) : 0xFFFFFFFFu;
+    int matched = 0;
+    int scanned = 0;
+
+    if (!audit->enabled) {
+        if (segments_read) *segments_read = 0;
+        if (segments_total) *segments_total = 0;
+        return 0;
+    }
+
+    audit_lock(engine);
+    if (audit->file != NULL) {
+        fflush(audit->file);
+    }
+
+    for (int i = 0; i <= audit->segment_count; i++) {
+        const AuditSegment* segment = (i < audit->segment_count) ? &audit->segments[i] : &audit->active;
+        if (!audit_segment_matches(segment, user_mask, from, to)) {
+            continue;
+        }
+
+        AuditRecord* records;
+        int count = audit_read_segment(engine, segment->id, segment->count, &records);
+        scanned++;
+        for (int j = 0; j < count; j++) {
+            AuditRecord* record = &records[j];
+            if (record->event_time < from || record->event_time > to) continue;
+            if (user && record->user != user && record->actor != user) continue;
+            callback(record, context);
+            matched++;
+        }
+        free(records);
+    }
+    if (segments_read) *segments_read = scanned;
+    if (segments_total) *segments_total = audit->segment_count + 1;
+    audit_unlock(engine);
+
+    return matched;
+}
+
+// ===== 异步持久化实现 =====
+
+static void persist_file_name(const SeatEngine* engine, char* buffer, int file_id) {
+    if (file_id == 0) {
+        snprintf(buffer, NAME_LEN, "%s", engine->data_file);
+    }
+    else {
+        floor_file_name(engine, buffer, file_id - 1);
+    }
+}
+
+// 取下一个保存序号。分片线程可能同时保存各自的楼层，共享模式下计数在段内，都用原子加
+static uint64_t next_save_seq(const SeatEngine* engine) {
+#ifdef _WIN32
+    return (uint64_t)InterlockedIncrement64((volatile LONG64*)engine->save_seq);
+#else
+    return __atomic_add_fetch(engine->save_seq, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+// 生成文件镜像，格式与同步保存相同；共享模式下逐层加锁复制。
+// 每层的保存序号在复制该层时取得，同一层序号更大的镜像不会包含更旧的数据
+static void persist_snapshot(const SeatEngine* engine, int file_id, unsigned char* image) {
+    const SeatMap* map = engine->map;
+    uint64_t seq;
+    if (file_id == 0) {
+        unsigned char* rows = image + sizeof(map->seats);
+        unsigned char* cols = rows + sizeof(map->floor_rows);
+        unsigned char* seqs = cols + sizeof(map->floor_cols);
+        for (int floor = 0; floor < FLOORS; floor++) {
+            lock_floor(engine, floor);
+            memcpy(image + sizeof(map->seats[floor]) * floor, map->seats[floor], sizeof(map->seats[floor]));
+            memcpy(rows + sizeof(int) * floor, &map->floor_rows[floor], sizeof(int));
+            memcpy(cols + sizeof(int) * floor, &map->floor_cols[floor], sizeof(int));
+            seq = next_save_seq(engine);
+            unlock_floor(engine, floor);
+            memcpy(seqs + sizeof(seq) * floor, &seq, sizeof(seq));
+        }
+    }
+    else {
+        int floor = file_id - 1;
+        lock_floor(engine, floor);
+        memcpy(image, map->seats[floor], sizeof(map->seats[floor]));
+        image += sizeof(map->seats[floor]);
+        memcpy(image, &map->floor_rows[floor], sizeof(int));
+        image += sizeof(int);
+        memcpy(image, &map->floor_cols[floor], sizeof(int));
+        image += sizeof(int);
+        seq = next_save_seq(engine);
+        unlock_floor(engine, floor);
+        memcpy(image, &seq, sizeof(seq));
+    }
+}
+
+#ifdef __linux__
+static int uring_init(Uring* uring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return 0;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size) sq_size = cq_size;
+        cq_size = sq_size;
+    }
+
+    unsigned char* sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    unsigned char* cq = sq;
+    if (sq != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    void* sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+
+    uring->fd = fd;
+    uring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    uring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    uring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    uring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    uring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    uring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    uring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    uring->sqes = (struct io_uring_sqe*)sqes;
+    return 1;
+}
+
+// 取一个提交项，调用者填写后由 uring_submit_and_wait 提交
+static struct io_uring_sqe* uring_get_sqe(Uring* uring) {
+    unsigned tail = *uring->sq_tail;
+    unsigned index = tail & *uring->sq_mask;
+    struct io_uring_sqe* sqe = &uring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    uring->sq_array[index] = index;
+    __atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+// 提交 count 个请求并等待全部完成，返回失败的文件位图
+static unsigned uring_submit_and_wait(Persister* persist, unsigned count) {
+    Uring* uring = &persist->uring;
+    unsigned failed = 0;
+    unsigned completed = 0;
+
+    if (syscall(__NR_io_uring_enter, uring->fd, count, count, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+        return ~0u;
+    }
+
+    while (completed < count) {
+        unsigned head = *uring->cq_head;
+        unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            syscall(__NR_io_uring_enter, uring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            continue;
+        }
+        while (head != tail) {
+            struct io_uring_cqe* cqe = &uring->cqes[head & *uring->cq_mask];
+            int file_id = (int)(cqe->user_data >> 1);
+            int is_write = (int)(cqe->user_data & 1);
+            if (cqe->res < 0 || (is_write && (size_t)cqe->res != persist->files[file_id].size)) {
+                failed |= 1u << file_id;
+            }
+            head++;
+            completed++;
+        }
+        __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return failed;
+}
+
+// 打开本次写入用的临时文件，写完并 fsync 后由 persist_finish_fd 改名替换数据文件
+static int persist_open_fd(SeatEngine* engine, int file_id) {
+    PersistFile* file = &engine->persist.files[file_id];
+    char filename[NAME_LEN], temp[TEMP_NAME_LEN];
+    persist_file_name(engine, filename, file_id);
+    temp_file_name(filename, temp);
+    file->fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    return file->fd >= 0;
+}
+
+// 关闭临时文件，写入成功时改名替换数据文件，否则删除临时文件；成功返回 1
+static int persist_finish_fd(SeatEngine* engine, int file_id, int ok) {
+    PersistFile* file = &engine->persist.files[file_id];
+    char filename[NAME_LEN], temp[TEMP_NAME_LEN];
+    persist_file_name(engine, filename, file_id);
+    temp_file_name(filename, temp);
+    ok = close(file->fd) == 0 && ok;
+    file->fd = -1;
+    if (!ok || rename(temp, filename) != 0) {
+        remove(temp);
+        return 0;
+    }
+    return 1;
+}
+#endif
+
+// 后台写线程：取走所有待写镜像，一次提交，完成后唤醒等待者
+static int persist_main(void* arg) {
+    SeatEngine* engine = (SeatEngine*)arg;
+    Persister* persist = &engine->persist;
+
+    while (1) {
+        mtx_lock(&persist->lock);
+        int ready;
+        while (1) {
+            ready = 0;
+            for (int i = 0; i < PERSIST_FILES; i++) {
+                ready += persist->files[i].has_pending;
+            }
+            if (ready > 0 || persist->stopping) break;
+            cnd_wait(&persist->wakeup, &persist->lock);
+        }
+        if (ready == 0) {
+            mtx_unlock(&persist->lock);
+            return 0;
+        }
+
+        long seqs[PERSIST_FILES] = { 0 };
+        unsigned batch = 0;
+        for (int i = 0; i < PERSIST_FILES; i++) {
+            PersistFile* file = &persist->files[i];
+            if (file->has_pending) {
+                unsigned char* swap = file->writing;
+                file->writing = file->pending;
+                file->pending = swap;
+                file->has_pending = 0;
+                seqs[i] = file->submitted_seq;
+                batch |= 1u << i;
+            }
+        }
+        mtx_unlock(&persist->lock);
+
+        // 共享模式下其他进程也在写这些文件：持有总锁，并在锁内重新生成镜像，
+        // 保证最后写入的总是最新的数据
+        lock_files(engine);
+        if (engine->shared != NULL) {
+            for (int i = 0; i < PERSIST_FILES; i++) {
+                if (batch & (1u << i)) {
+                    persist_snapshot(engine, i, persist->files[i].writing);
+                }
+            }
+        }
+
+        unsigned failed = 0;
+#ifdef __linux__
+        if (persist->use_uring) {
+            unsigned count = 0;
+            for (int i = 0; i < PERSIST_FILES; i++) {
+                if (!(batch & (1u << i))) continue;
+                if (!persist_open_fd(engine, i)) {
+                    failed |= 1u << i;
+                    continue;
+                }
+                struct io_uring_sqe* sqe = uring_get_sqe(&persist->uring);
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->fd = persist->files[i].fd;
+                sqe->addr = (unsigned long long)(uintptr_t)persist->files[i].writing;
+                sqe->len = (unsigned)persist->files[i].size;
+                sqe->off = 0;
+                sqe->flags = IOSQE_IO_LINK;
+                sqe->user_data = ((unsigned long long)i << 1) | 1;
+
+                sqe = uring_get_sqe(&persist->uring);
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fd = persist->files[i].fd;
+                sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+                sqe->user_data = (unsigned long long)i << 1;
+                count += 2;
+            }
+            if (count > 0) {
+                failed |= uring_submit_and_wait(persist, count);
+            }
+            for (int i = 0; i < PERSIST_FILES; i++) {
+                if ((batch & (1u << i)) && persist->files[i].fd >= 0 &&
+                    !persist_finish_fd(engine, i, !(failed & (1u << i)))) {
+                    failed |= 1u << i;
+                }
+            }
+        }
+        else
+#endif
+        {
+            for (int i = 0; i < PERSIST_FILES; i++) {
+                char filename[NAME_LEN];
+                if (!(batch & (1u << i))) continue;
+                persist_file_name(engine, filename, i);
+                if (!write_image(filename, persist->files[i].writing, persist->files[i].size)) {
+                    failed |= 1u << i;
+                }
+            }
+        }
+        unlock_files(engine);
+
+        mtx_lock(&persist->lock);
+        for (int i = 0; i < PERSIST_FILES; i++) {
+            if (!(batch & (1u << i))) continue;
+            if (failed & (1u << i)) {
+                persist->files[i].failed_seq = seqs[i];
+            }
+            persist->files[i].written_seq = seqs[i];
+        }
+        cnd_broadcast(&persist->written);
+        mtx_unlock(&persist->lock);
+    }
+}
+
+// 启动后台写线程
+static int persist_start(SeatEngine* engine, PersistMode mode, int use_uring) {
+    Persister* persist = &engine->persist;
+    memset(persist, 0, sizeof(*persist));
+    persist->mode = mode;
+    if (mode == PERSIST_SYNC) {
+        return 1;
+    }
+
+    for (int i = 0; i < PERSIST_FILES; i++) {
+        PersistFile* file = &persist->files[i];
+        file->size = (i == 0) ? MAIN_IMAGE_SIZE : FLOOR_IMAGE_SIZE;
+        file->pending = (unsigned char*)malloc(file->size);
+        file->writing = (unsigned char*)malloc(file->size);
+        file->fd = -1;
+        if (file->pending == NULL || file->writing == NULL) {
+            return 0;
+        }
+    }
+
+    persist->use_uring = use_uring;
+#ifdef __linux__
+    if (persist->use_uring && !uring_init(&persist->uring, 2 * PERSIST_FILES)) {
+        persist->use_uring = 0;
+    }
+#else
+    persist->use_uring = 0;
+#endif
+
+    mtx_init(&persist->lock, mtx_plain);
+    cnd_init(&persist->wakeup);
+    cnd_init(&persist->written);
+    persist->running = 1;
+    thrd_create(&persist->thread, persist_main, engine);
+    return 1;
+}
+
+// 提交一个文件的最新镜像，调用者必须是该文件数据的所有者
+static PersistTicket persist_submit(SeatEngine* engine, int file_id) {
+    Persister* persist = &engine->persist;
+    PersistFile* file = &persist->files[file_id];
+    PersistTicket ticket;
+
+    mtx_lock(&persist->lock);
+    persist_snapshot(engine, file_id, file->pending);
+    file->has_pending = 1;
+    ticket.file_id = file_id;
+    ticket.seq = ++file->submitted_seq;
+    cnd_signal(&persist->wakeup);
+    mtx_unlock(&persist->lock);
+    return ticket;
+}
+
+// 等待写入完成（仅 PERSIST_DURABLE），成功返回1
+static int persist_complete(SeatEngine* engine, PersistTicket ticket) {
+    Persister* persist = &engine->persist;
+    if (persist->mode != PERSIST_DURABLE) {
+        return 1;
+    }
+
+    PersistFile* file = &persist->files[ticket.file_id];
+    mtx_lock(&persist->lock);
+    while (file->written_seq < ticket.seq) {
+        cnd_wait(&persist->written, &persist->lock);
+    }
+    int ok = file->failed_seq < ticket.seq;
+    mtx_unlock(&persist->lock);
+    return ok;
+}
+
+// 写完所有待写镜像后停止后台写线程
+static void persist_stop(SeatEngine* engine) {
+    Persister* persist = &engine->persist;
+    if (persist->running) {
+        mtx_lock(&persist->lock);
+        persist->stopping = 1;
+        cnd_signal(&persist->wakeup);
+        mtx_unlock(&persist->lock);
+        thrd_join(persist->thread, NULL);
+
+        cnd_destroy(&persist->written);
+        cnd_destroy(&persist->wakeup);
+        mtx_destroy(&persist->lock);
+        persist->running = 0;
+    }
+
+    for (int i = 0; i < PERSIST_FILES; i++) {
+#ifdef __linux__
+        if (persist->files[i].fd >= 0) close(persist->files[i].fd);
+#endif
+        free(persist->files[i].pending);
+        free(persist->files[i].writing);
+        persist->files[i].pending = persist->files[i].writing = NULL;
+        persist->files[i].fd = -1;
+    }
+#ifdef __linux__
+    if (persist->use_uring) close(persist->uring.fd);
+#endif
+    persist->use_uring = 0;
+}
+
+const char* engine_persist_backend(const SeatEngine* engine) {
+    if (engine->persist.mode == PERSIST_SYNC) return "同步";
+    return engine->persist.use_uring ? "io_uring" : "后台线程";
+}
+
+// ===== 创建与数据文件 =====
+
+SeatEngine* engine_create(const EngineConfig* config) {
+    EngineConfig defaults;
+    if (config == NULL) {
+        engine_config_default(&defaults);
+        config = &defaults;
+    }
+
+    int open_minute = config->open_hour * 60;
+    int day_minutes = (config->close_hour - config->open_hour) * 60;
+    if (config->open_hour < 0 || config->close_hour > 24 || day_minutes <= 0 || config->slot_minutes <= 0 ||
+        day_minutes % config->slot_minutes != 0 || day_minutes / config->slot_minutes > ENGINE_MAX_SLOTS) {
+        return NULL;
+    }
+
+    SeatEngine* engine = (SeatEngine*)calloc(1, sizeof(SeatEngine));
+    if (engine == NULL) {
+        return NULL;
+    }
+
+    engine->open_minute = open_minute;
+    engine->slot_minutes = config->slot_minutes;
+    engine->slot_count = day_minutes / config->slot_minutes;
+    engine->map = &engine->own_map;
+    engine->save_seq = &engine->own_save_seq;
+
+    copy_path(engine->data_file, config->data_file);
+    copy_path(engine->floor_file_format, config->floor_file_format);
+    if (config->shared_name != NULL) {
+#ifdef __linux__
+        if (!shared_open(engine, config->shared_name)) {
+            free(engine);
+            return NULL;
+        }
+#else
+        free(engine);
+        return NULL;
+#endif
+    }
+    else {
+        for (int floor = 0; floor < FLOORS; floor++) {
+            reset_floor_size(engine, floor);
+        }
+    }
+
+    if (config->audit_prefix != NULL) {
+        copy_path(engine->audit_prefix, config->audit_prefix);
+        engine->audit.enabled = 1;
+        engine->audit.segment_records = config->audit_segment_records > 0 ? config->audit_segment_records : 1;
+        engine->audit.retention_days = config->audit_retention_days;
+        audit_open(engine);
+    }
+
+    if (!persist_start(engine, config->persist_mode, config->use_uring)) {
+        engine_destroy(engine);
+        return NULL;
+    }
+    return engine;
+}
+
+void engine_destroy(SeatEngine* engine) {
+    if (engine == NULL) return;
+    persist_stop(engine);
+    audit_close(engine);
+#ifdef __linux__
+    shared_close(engine);
+#endif
+    free(engine);
+}
+
+// 读入整个文件，由调用者 free；文件不存在时返回 NULL 且 *size 为 0，读取失败时 *size 为 -1
+static unsigned char* read_whole_file(const char* filename, long* size) {
+    *size = 0;
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char* buffer = (unsigned char*)malloc(length > 0 ? length : 1);
+    if (buffer == NULL || length < 0 || fread(buffer, 1, length, file) != (size_t)length) {
+        free(buffer);
+        fclose(file);
+        *size = -1;
+        return NULL;
+    }
+    fclose(file);
+    *size = length;
+    return buffer;
+}
+
+// 解析数据文件镜像，floors 为 FLOORS（总数据文件）或 1（楼层文件）。
+// 按文件大小区分版本：旧版文件每个座位每天只有一条整天的预约，转换为覆盖全部开放时间的一段；
+// seqs 为各层的保存序号（可以为 NULL），没有保存序号的旧版文件为 0。
+// 返回 0 表示大小不对，1 表示只有座位数据（最早的版本，没有行列数），2 表示带行列数
+static int decode_seat_image(const SeatEngine* engine, const unsigned char* image, long size, int floors,
+    Seat* seats, int* rows, int* cols, uint64_t* seqs) {
+    size_t cells = (size_t)floors * ROWS * COLS * DAYS;
+    size_t layout_size = 2 * sizeof(int) * floors;
+    size_t seats_size;
+    int result;
+
+    if (seqs != NULL) {
+        memset(seqs, 0, sizeof(uint64_t) * floors);
+    }
+    if ((size_t)size == sizeof(Seat) * cells + layout_size + sizeof(uint64_t) * floors) {
+        seats_size = sizeof(Seat) * cells;
+        memcpy(seats, image, seats_size);
+        if (seqs != NULL) {
+            memcpy(seqs, image + seats_size + layout_size, sizeof(uint64_t) * floors);
+        }
+        result = 2;
+    }
+    else if ((size_t)size == sizeof(Seat) * cells + layout_size) {
+        seats_size = sizeof(Seat) * cells;
+        memcpy(seats, image, seats_size);
+        result = 2;
+    }
+    else if ((size_t)size == sizeof(LegacySeat) * cells + layout_size ||
+        (floors == FLOORS && (size_t)size == sizeof(LegacySeat) * cells)) {
+        const LegacySeat* legacy = (const LegacySeat*)image;
+        for (size_t i = 0; i < cells; i++) {
+            memset(&seats[i], 0, sizeof(Seat));
+            if (legacy[i].status != STATUS_EMPTY) {
+                Booking* booking = &seats[i].bookings[0];
+                booking->start = (int16_t)engine->open_minute;
+                booking->end = (int16_t)engine_slot_minute(engine, engine->slot_count);
+                booking->reserved_by = legacy[i].reserved_by;
+                booking->status = (uint8_t)legacy[i].status;
+                booking->reserve_time = (int64_t)legacy[i].reserve_time;
+                seats[i].count = 1;
+            }
+        }
+        seats_size = sizeof(LegacySeat) * cells;
+        result = (size_t)size > seats_size ? 2 : 1;
+    }
+    else {
+        return 0;
+    }
+
+    for (size_t i = 0; i < cells; i++) {
+        rebuild_busy(engine, &seats[i]);
+    }
+    if (result == 2) {
+        memcpy(rows, image + seats_size, sizeof(int) * floors);
+        memcpy(cols, image + seats_size + sizeof(int) * floors, sizeof(int) * floors);
+    }
+    return result;
+}
+
+// 把总数据文件格式的镜像读入座位表
+static EngineStatus apply_main_image(SeatEngine* engine, const unsigned char* image, long size) {
+    // 最早的数据文件只有座位数据，没有楼层配置
+    int loaded = decode_seat_image(engine, image, size, FLOORS, &engine->map->seats[0][0][0][0],
+        engine->map->floor_rows, engine->map->floor_cols, NULL);
+    if (loaded == 0) {
+        return ENGINE_ERR_IO;
+    }
+
+    for (int floor = 0; floor < FLOORS; floor++) {
+        if (loaded == 1 || engine->map->floor_rows[floor] <= 0 || engine->map->floor_rows[floor] > ROWS ||
+            engine->map->floor_cols[floor] <= 0 || engine->map->floor_cols[floor] > COLS) {
+            reset_floor_size(engine, floor);
+        }
+    }
+    return ENGINE_OK;
+}
+
+// 从总数据文件读入座位表
+static EngineStatus load_data_file(SeatEngine* engine) {
+    long size;
+    unsigned char* image = read_whole_file(engine->data_file, &size);
+    if (image == NULL) {
+        if (size < 0) {
+            return ENGINE_ERR_IO;
+        }
+        memset(engine->map->seats, 0, sizeof(engine->map->seats));
+        for (int floor = 0; floor < FLOORS; floor++) {
+            reset_floor_size(engine, floor);
+        }
+        return ENGINE_NO_DATA;
+    }
+
+    EngineStatus status = apply_main_image(engine, image, size);
+    free(image);
+    return status;
+}
+
+#ifdef __linux__
+// 删除已退出的进程在保存途中留下的临时文件 <文件名>.<进程号>.tmp
+static void remove_stale_temps(const char* filename) {
+    const char* slash = strrchr(filename, '/');
+    const char* base = slash != NULL ? slash + 1 : filename;
+    char directory[NAME_LEN];
+    snprintf(directory, sizeof(directory), "%.*s", (int)(base - filename), filename);
+    DIR* dir = opendir(directory[0] ? directory : ".");
+    if (dir == NULL) {
+        return;
+    }
+
+    size_t base_len = strlen(base);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (strncmp(name, base, base_len) != 0 || name[base_len] != '.') continue;
+        char* end;
+        long pid = strtol(name + base_len + 1, &end, 10);
+        if (end == name + base_len + 1 || strcmp(end, ".tmp") != 0 || pid <= 0) continue;
+        if (pid == (long)getpid() || kill((pid_t)pid, 0) == 0 || errno != ESRCH) continue;
+
+        char path[TEMP_NAME_LEN + NAME_LEN];
+        snprintf(path, sizeof(path), "%s%s", directory, name);
+        remove(path);
+    }
+    closedir(dir);
+}
+#endif
+
+// 只读出数据文件末尾的 count 个保存序号；文件不存在、大小不对（旧版文件）时全为 0
+static void read_save_seqs(const char* filename, size_t image_size, uint64_t* seqs, int count) {
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL || fseek(file, 0, SEEK_END) != 0 || ftell(file) != (long)image_size ||
+        fseek(file, -(long)(sizeof(uint64_t) * count), SEEK_END) != 0 ||
+        fread(seqs, sizeof(uint64_t), count, file) != (size_t)count) {
+        memset(seqs, 0, sizeof(uint64_t) * count);
+    }
+    if (file != NULL) {
+        fclose(file);
+    }
+}
+
+static uint64_t read_floor_seq(const SeatEngine* engine, int floor) {
+    char filename[NAME_LEN];
+    uint64_t seq;
+    floor_file_name(engine, filename, floor);
+    read_save_seqs(filename, FLOOR_IMAGE_SIZE, &seq, 1);
+    return seq;
+}
+
+// 保存序号从现有文件中最大的序号继续，之后写的文件序号都比它们大
+static void init_save_seq(SeatEngine* engine) {
+    uint64_t main_seqs[FLOORS];
+    uint64_t seq = 0;
+    read_save_seqs(engine->data_file, MAIN_IMAGE_SIZE, main_seqs, FLOORS);
+    for (int floor = 0; floor < FLOORS; floor++) {
+        uint64_t floor_seq = read_floor_seq(engine, floor);
+        if (main_seqs[floor] > seq) seq = main_seqs[floor];
+        if (floor_seq > seq) seq = floor_seq;
+    }
+    if (seq > *engine->save_seq) {
+        *engine->save_seq = seq;
+    }
+}
+
+// 从总数据文件加载；文件不存在时使用默认数据并返回 ENGINE_NO_DATA。
+// 共享模式下只有第一个进程读取文件，之后连接的进程直接使用段中的数据
+EngineStatus engine_load(SeatEngine* engine) {
+#ifdef __linux__
+    char filename[NAME_LEN];
+    remove_stale_temps(engine->data_file);
+    for (int floor = 0; floor < FLOORS; floor++) {
+        floor_file_name(engine, filename, floor);
+        remove_stale_temps(filename);
+    }
+#endif
+    if (engine->shared == NULL) {
+        init_save_seq(engine);
+        return load_data_file(engine);
+    }
+
+    EngineStatus status = ENGINE_OK;
+    lock_files(engine);
+#ifdef __linux__
+    if (!engine->shared->loaded) {
+        // 其他进程在 loaded 置位之前不会访问座位表
+        init_save_seq(engine);
+        status = load_data_file(engine);
+        engine->shared->loaded = 1;
+        engine->shared_loader = 1;
+    }
+#endif
+    unlock_files(engine);
+    shared_remember(engine);
+    return status;
+}
+
+// 读取单层文件，只有保存序号比总数据文件中该层的序号大（内容比总数据文件新，说明上次分片运行
+// 未正常退出）时才使用。没有保存序号的旧版楼层文件不使用
+static int read_floor_file(const SeatEngine* engine, int floor,
+    Seat seats[ROWS][COLS][DAYS], int* rows, int* cols) {
+    char filename[NAME_LEN];
+    uint64_t main_seqs[FLOORS];
+    floor_file_name(engine, filename, floor);
+
+    uint64_t floor_seq = read_floor_seq(engine, floor);
+    read_save_seqs(engine->data_file, MAIN_IMAGE_SIZE, main_seqs, FLOORS);
+    if (floor_seq == 0 || floor_seq <= main_seqs[floor]) {
+        return 0;
+    }
+
+    long size;
+    unsigned char* image = read_whole_file(filename, &size);
+    if (image == NULL) {
+        return 0;
+    }
+
+    int ok = decode_seat_image(engine, image, size, 1, &seats[0][0][0], rows, cols, &floor_seq) == 2 &&
+        floor_seq != 0 && *rows > 0 && *rows <= ROWS && *cols > 0 && *cols <= COLS;
+    free(image);
+    return ok;
+}
+
+// 加载比总数据文件新的楼层文件；共享模式下只由加载了数据文件的进程读取
+void engine_load_floor_files(SeatEngine* engine, int first_floor, int last_floor) {
+    Seat seats[ROWS][COLS][DAYS];
+    int rows, cols;
+    if (engine->shared != NULL && !engine->shared_loader) {
+        return;
+    }
+    for (int floor = first_floor; floor <= last_floor && valid_floor(floor); floor++) {
+        if (read_floor_file(engine, floor, seats, &rows, &cols)) {
+            lock_floor(engine, floor);
+            memcpy(engine->map->seats[floor], seats, sizeof(seats));
+            engine->map->floor_rows[floor] = rows;
+            engine->map->floor_cols[floor] = cols;
+            mark_floor_dirty(engine, floor);
+            unlock_floor(engine, floor);
+        }
+    }
+}
+
+// 保存总数据文件
+EngineStatus engine_save(SeatEngine* engine) {
+    int ok;
+    if (engine->persist.mode == PERSIST_SYNC) {
+        unsigned char* image = (unsigned char*)malloc(MAIN_IMAGE_SIZE);
+        if (image == NULL) {
+            return ENGINE_ERR_NO_MEMORY;
+        }
+        lock_files(engine);
+        persist_snapshot(engine, 0, image);
+        ok = write_image(engine->data_file, image, MAIN_IMAGE_SIZE);
+        unlock_files(engine);
+        free(image);
+    }
+    else {
+        ok = persist_complete(engine, persist_submit(engine, 0));
+    }
+    engine_audit_flush(engine);
+    return ok ? ENGINE_OK : ENGINE_ERR_IO;
+}
+
+// 保存 floor_mask 中各层的楼层文件；异步模式下一起提交再等待
+EngineStatus engine_save_floors(SeatEngine* engine, unsigned floor_mask) {
+    PersistTicket tickets[FLOORS];
+    int ok = 1;
+
+    for (int floor = 0; floor < FLOORS; floor++) {
+        if (!(floor_mask & (1u << floor))) continue;
+        if (engine->persist.mode == PERSIST_SYNC) {
+            unsigned char image[FLOOR_IMAGE_SIZE];
+            char filename[NAME_LEN];
+            floor_file_name(engine, filename, floor);
+            lock_files(engine);
+            persist_snapshot(engine, floor + 1, image);
+            ok = write_image(filename, image, sizeof(image)) && ok;
+            unlock_files(engine);
+        }
+        else {
+            tickets[floor] = persist_submit(engine, floor + 1);
+        }
+    }
+    if (engine->persist.mode != PERSIST_SYNC) {
+        for (int floor = 0; floor < FLOORS; floor++) {
+            if (floor_mask & (1u << floor)) {
+                ok = persist_complete(engine, tickets[floor]) && ok;
+            }
+        }
+    }
+    engine_audit_flush(engine);
+    return ok ? ENGINE_OK : ENGINE_ERR_IO;
+}
+
+size_t engine_image_size(void) {
+    return MAIN_IMAGE_SIZE;
+}
+
+void engine_export_image(const SeatEngine* engine, unsigned char* image) {
+    persist_snapshot(engine, 0, image);
+}
+
+// 从内存中的镜像加载，调用者保证此时没有其他线程访问引擎
+EngineStatus engine_import_image(SeatEngine* engine, const unsigned char* image, size_t size) {
+    EngineStatus status = apply_main_image(engine, image, (long)size);
+    for (int floor = 0; floor < FLOORS && status == ENGINE_OK; floor++) {
+        engine->layout_dirty[floor] = 1;
+        mark_floor_dirty(engine, floor);
+    }
+    return status;
+}
+
+// 等待后台写线程写完所有已提交的数据
+void engine_flush(SeatEngine* engine) {
+    Persister* persist = &engine->persist;
+    if (!persist->running) return;
+
+    mtx_lock(&persist->lock);
+    for (int i = 0; i < PERSIST_FILES; i++) {
+        while (persist->files[i].written_seq < persist->files[i].submitted_seq) {
+            cnd_wait(&persist->written, &persist->lock);
+        }
+    }
+    mtx_unlock(&persist->lock);
+}
+
+// ===== 查询 =====
+
+EngineStatus engine_floor_size(const SeatEngine* engine, int floor, int* rows, int* cols) {
+    if (!valid_floor(floor)) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    lock_floor(engine, floor);
+    *rows = engine->map->floor_rows[floor];
+    *cols = engine->map->floor_cols[floor];
+    unlock_floor(engine, floor);
+    return ENGINE_OK;
+}
+
+EngineStatus engine_get_seat(const SeatEngine* engine, int floor, int row, int col, int day, Seat* seat) {
+    if (!valid_floor(floor) || !valid_day(day)) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    EngineStatus status = ENGINE_ERR_INVALID_SEAT;
+    lock_floor(engine, floor);
+    if (row >= 0 && row < engine->map->floor_rows[floor] && col >= 0 && col < engine->map->floor_cols[floor]) {
+        *seat = engine->map->seats[floor][row][col][day];
+        status = ENGINE_OK;
+    }
+    unlock_floor(engine, floor);
+    return status;
+}
+
+EngineStatus engine_snapshot_floor(const SeatEngine* engine, int floor, EngineFloorSnapshot* snapshot) {
+    if (!valid_floor(floor)) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    lock_floor(engine, floor);
+    memcpy(snapshot->seats, engine->map->seats[floor], sizeof(snapshot->seats));
+    snapshot->rows = engine->map->floor_rows[floor];
+    snapshot->cols = engine->map->floor_cols[floor];
+    unlock_floor(engine, floor);
+    return ENGINE_OK;
+}
+
+// 收集某层的所有预约段（按 天、行、列、开始时间 顺序），out 至少有 ENGINE_BOOKINGS_PER_FLOOR 项，返回记录数
+int engine_collect_floor(const SeatEngine* engine, int floor, EngineReservation* out) {
+    if (!valid_floor(floor)) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+
+    int count = 0;
+    lock_floor(engine, floor);
+    for (int day = 0; day < DAYS; day++) {
+        for (int row = 0; row < engine->map->floor_rows[floor]; row++) {
+            for (int col = 0; col < engine->map->floor_cols[floor]; col++) {
+                const Seat* seat = &engine->map->seats[floor][row][col][day];
+                for (int i = 0; i < seat->count; i++) {
+                    const Booking* booking = &seat->bookings[i];
+                    out[count].row = row;
+                    out[count].col = col;
+                    out[count].day = day;
+                    out[count].start = booking->start;
+                    out[count].end = booking->end;
+                    out[count].reserved_by = booking->reserved_by;
+                    out[count].reserve_time = (time_t)booking->reserve_time;
+                    count++;
+                }
+            }
+        }
+    }
+    unlock_floor(engine, floor);
+    return count;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 座位表的 64 位 FNV-1a 校验和：各层行列数和每段预约的起止时间、用户、状态。
+// 不含预约时间，同样的操作序列无论何时执行，得到的校验和都相同
+uint64_t engine_checksum(const SeatEngine* engine) {
+    uint64_t hash = 14695981039346656037ull;
+    for (int floor = 0; floor < FLOORS; floor++) {
+        lock_floor(engine, floor);
+        int32_t layout[2] = { engine->map->floor_rows[floor], engine->map->floor_cols[floor] };
+        hash = hash_bytes(hash, layout, sizeof(layout));
+        for (int row = 0; row < ROWS; row++) {
+            for (int col = 0; col < COLS; col++) {
+                for (int day = 0; day < DAYS; day++) {
+                    const Seat* seat = &engine->map->seats[floor][row][col][day];
+                    hash = hash_bytes(hash, &seat->count, sizeof(seat->count));
+                    for (int i = 0; i < seat->count; i++) {
+                        const Booking* booking = &seat->bookings[i];
+                        hash = hash_bytes(hash, &booking->start, sizeof(booking->start));
+                        hash = hash_bytes(hash, &booking->end, sizeof(booking->end));
+                        hash = hash_bytes(hash, &booking->reserved_by, sizeof(booking->reserved_by));
+                        hash = hash_bytes(hash, &booking->status, sizeof(booking->status));
+                    }
+                }
+            }
+        }
+        unlock_floor(engine, floor);
+    }
+    return hash;
+}
+
+// ===== 修改 =====
+
+// 预约/取消改变了一个座位：本进程的看板读脏位，共享模式下其他进程读该格的修改计数
+static void mark_dirty(SeatEngine* engine, int floor, int row, int col, int day) {
+    engine->dirty_cells[floor][day] |= 1u << (row * COLS + col);
+    touch_cell(engine, floor, row, col, day);
+    touch_floor(engine, floor);
+}
+
+// 记录审计日志后删除一段预约
+static void release_booking(SeatEngine* engine, int floor, int row, int col, int day, int index,
+    AuditEvent event, char actor) {
+    Seat* seat = &engine->map->seats[floor][row][col][day];
+    audit_append(engine, event, actor, floor, row, col, day, &seat->bookings[index]);
+    memmove(&seat->bookings[index], &seat->bookings[index + 1], sizeof(Booking) * (seat->count - index - 1));
+    seat->count--;
+    memset(&seat->bookings[seat->count], 0, sizeof(Booking));
+    rebuild_busy(engine, seat);
+    mark_dirty(engine, floor, row, col, day);
+}
+
+// 删除座位某天的所有预约段，返回删除的段数
+static int release_seat(SeatEngine* engine, int floor, int row, int col, int day, AuditEvent event) {
+    Seat* seat = &engine->map->seats[floor][row][col][day];
+    int count = seat->count;
+    while (seat->count > 0) {
+        release_booking(engine, floor, row, col, day, seat->count - 1, event, ENGINE_ADMIN_ACTOR);
+    }
+    return count;
+}
+
+static EngineStatus reserve_booking(SeatEngine* engine, int floor, int row, int col, int day,
+    int start, int end, char user_char, UserType by) {
+    if (row < 0 || row >= engine->map->floor_rows[floor] ||
+        col < 0 || col >= engine->map->floor_cols[floor]) {
+        return ENGINE_ERR_INVALID_SEAT;
+    }
+
+    Seat* seat = &engine->map->seats[floor][row][col][day];
+    uint64_t mask = engine_slot_mask(start, end);
+    if (seat->busy & mask) {
+        return ENGINE_ERR_OCCUPIED;
+    }
+    if (seat->count == ENGINE_MAX_BOOKINGS) {
+        return ENGINE_ERR_FULL;
+    }
+
+    // 按开始时间插入
+    int minute = engine_slot_minute(engine, start);
+    int index = seat->count;
+    while (index > 0 && seat->bookings[index - 1].start > minute) {
+        seat->bookings[index] = seat->bookings[index - 1];
+        index--;
+    }
+    Booking* booking = &seat->bookings[index];
+    memset(booking, 0, sizeof(*booking));
+    booking->start = (int16_t)minute;
+    booking->end = (int16_t)engine_slot_minute(engine, end);
+    booking->reserved_by = user_char;
+    booking->status = (uint8_t)((by == USER_ADMIN) ? STATUS_RESERVED : STATUS_SELF_RESERVED);
+    booking->reserve_time = (int64_t)time(NULL);
+    seat->count++;
+    seat->busy |= mask;
+
+    mark_dirty(engine, floor, row, col, day);
+    audit_append(engine, AUDIT_RESERVE, by == USER_ADMIN ? ENGINE_ADMIN_ACTOR : user_char,
+        floor, row, col, day, booking);
+    return ENGINE_OK;
+}
+
+// 预约一个座位的时段 [start, end)：管理员代用户预约记为 STATUS_RESERVED，用户自己预约记为 STATUS_SELF_RESERVED
+EngineStatus engine_reserve(SeatEngine* engine, int floor, int row, int col, int day,
+    int start, int end, char user_char, UserType by) {
+    if (!valid_floor(floor) || !valid_day(day) || start < 0 || end > engine->slot_count || start >= end) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    lock_floor(engine, floor);
+    EngineStatus status = reserve_booking(engine, floor, row, col, day, start, end, user_char, by);
+    unlock_floor(engine, floor);
+    return status;
+}
+
+static EngineStatus cancel_booking(SeatEngine* engine, int floor, int row, int col, int day,
+    int slot, char user_char, UserType by) {
+    if (row < 0 || row >= engine->map->floor_rows[floor] ||
+        col < 0 || col >= engine->map->floor_cols[floor]) {
+        return ENGINE_ERR_INVALID_SEAT;
+    }
+
+    Seat* seat = &engine->map->seats[floor][row][col][day];
+    uint64_t bit = engine_slot_mask(slot, slot + 1);
+    if (!(seat->busy & bit)) {
+        return ENGINE_ERR_NOT_RESERVED;
+    }
+
+    int index = 0;
+    while (!(booking_mask(engine, &seat->bookings[index]) & bit)) {
+        index++;
+    }
+    if (by == USER_NORMAL && seat->bookings[index].reserved_by != user_char) {
+        return ENGINE_ERR_NOT_OWNER;
+    }
+
+    release_booking(engine, floor, row, col, day, index, AUDIT_CANCEL,
+        by == USER_ADMIN ? ENGINE_ADMIN_ACTOR : user_char);
+    return ENGINE_OK;
+}
+
+// 取消覆盖时段 slot 的那一段预约，普通用户只能取消自己的预约
+EngineStatus engine_cancel(SeatEngine* engine, int floor, int row, int col, int day,
+    int slot, char user_char, UserType by) {
+    if (!valid_floor(floor) || !valid_day(day) || slot < 0 || slot >= engine->slot_count) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    lock_floor(engine, floor);
+    EngineStatus status = cancel_booking(engine, floor, row, col, day, slot, user_char, by);
+    unlock_floor(engine, floor);
+    return status;
+}
+
+static int cancel_floor_day(SeatEngine* engine, int floor, int day, AuditEvent event) {
+    int count = 0;
+    for (int row = 0; row < engine->map->floor_rows[floor]; row++) {
+        for (int col = 0; col < engine->map->floor_cols[floor]; col++) {
+            count += release_seat(engine, floor, row, col, day, event);
+        }
+    }
+    return count;
+}
+
+// 取消某层某天的所有预约，返回取消的段数
+int engine_cancel_floor_day(SeatEngine* engine, int floor, int day) {
+    if (!valid_floor(floor) || !valid_day(day)) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    lock_floor(engine, floor);
+    int count = cancel_floor_day(engine, floor, day, AUDIT_CANCEL_DAY);
+    unlock_floor(engine, floor);
+    return count;
+}
+
+// 取消某层所有预约，返回取消的段数
+int engine_cancel_floor(SeatEngine* engine, int floor) {
+    if (!valid_floor(floor)) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    int count = 0;
+    lock_floor(engine, floor);
+    for (int day = 0; day < DAYS; day++) {
+        count += cancel_floor_day(engine, floor, day, AUDIT_CANCEL_FLOOR);
+    }
+    unlock_floor(engine, floor);
+    return count;
+}
+
+// 调整楼层行列数，取消超出范围的预约，返回取消的段数
+int engine_adjust_floor(SeatEngine* engine, int floor, int rows, int cols) {
+    if (!valid_floor(floor) || rows <= 0 || rows > ROWS || cols <= 0 || cols > COLS) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+
+    int canceled = 0;
+    lock_floor(engine, floor);
+    for (int day = 0; day < DAYS; day++) {
+        for (int row = 0; row < engine->map->floor_rows[floor]; row++) {
+            for (int col = 0; col < engine->map->floor_cols[floor]; col++) {
+                if (row >= rows || col >= cols) {
+                    canceled += release_seat(engine, floor, row, col, day, AUDIT_ADJUST);
+                }
+            }
+        }
+    }
+
+    engine->map->floor_rows[floor] = rows;
+    engine->map->floor_cols[floor] = cols;
+    engine->layout_dirty[floor] = 1;
+    touch_floor(engine, floor);
+    unlock_floor(engine, floor);
+    return canceled;
+}
+
+// 清空某层的所有预约并恢复默认行列数，返回取消的段数
+int engine_clear_floor(SeatEngine* engine, int floor) {
+    if (!valid_floor(floor)) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+
+    int count = 0;
+    lock_floor(engine, floor);
+    for (int day = 0; day < DAYS; day++) {
+        for (int row = 0; row < ROWS; row++) {
+            for (int col = 0; col < COLS; col++) {
+                count += release_seat(engine, floor, row, col, day, AUDIT_CLEAR);
+            }
+        }
+    }
+    memset(engine->map->seats[floor], 0, sizeof(engine->map->seats[floor]));
+    reset_floor_size(engine, floor);
+    engine->layout_dirty[floor] = 1;
+    touch_floor(engine, floor);
+    unlock_floor(engine, floor);
+    return count;
+}
+
+// 检查一层的快照：预约段按开始时间排序、互不重叠，行列范围外没有预约
+static EngineStatus check_snapshot(const EngineFloorSnapshot* snapshot) {
+    if (snapshot->rows <= 0 || snapshot->rows > ROWS || snapshot->cols <= 0 || snapshot->cols > COLS) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    for (int row = 0; row < ROWS; row++) {
+        for (int col = 0; col < COLS; col++) {
+            for (int day = 0; day < DAYS; day++) {
+                const Seat* seat = &snapshot->seats[row][col][day];
+                if (seat->count < 0 || seat->count > ENGINE_MAX_BOOKINGS) {
+                    return ENGINE_ERR_INVALID_ARG;
+                }
+                if (seat->count > 0 && (row >= snapshot->rows || col >= snapshot->cols)) {
+                    return ENGINE_ERR_INVALID_SEAT;
+                }
+                for (int i = 0; i < seat->count; i++) {
+                    const Booking* booking = &seat->bookings[i];
+                    if (booking->start >= booking->end) {
+                        return ENGINE_ERR_INVALID_ARG;
+                    }
+                    if (i > 0 && booking->start < seat->bookings[i - 1].end) {
+                        return ENGINE_ERR_OCCUPIED;
+                    }
+                }
+            }
+        }
+    }
+    return ENGINE_OK;
+}
+
+// 用快照替换整栋楼的座位（导入数据使用，不记审计日志），要么所有楼层都替换，要么都不修改：
+// 先检查所有快照，再按楼层顺序锁住所有楼层，行列数全部与快照相同后才开始写入
+EngineStatus engine_restore(SeatEngine* engine, const EngineFloorSnapshot* snapshots) {
+    for (int floor = 0; floor < FLOORS; floor++) {
+        EngineStatus status = check_snapshot(&snapshots[floor]);
+        if (status != ENGINE_OK) {
+            return status;
+        }
+    }
+
+    for (int floor = 0; floor < FLOORS; floor++) {
+        lock_floor(engine, floor);
+    }
+    // 快照按读入时的行列数检查过，期间有楼层被调整过就不能再套用
+    EngineStatus status = ENGINE_OK;
+    for (int floor = 0; floor < FLOORS; floor++) {
+        if (engine->map->floor_rows[floor] != snapshots[floor].rows ||
+            engine->map->floor_cols[floor] != snapshots[floor].cols) {
+            status = ENGINE_ERR_CHANGED;
+        }
+    }
+    for (int floor = 0; floor < FLOORS && status == ENGINE_OK; floor++) {
+        memcpy(engine->map->seats[floor], snapshots[floor].seats, sizeof(snapshots[floor].seats));
+        for (int row = 0; row < ROWS; row++) {
+            for (int col = 0; col < COLS; col++) {
+                for (int day = 0; day < DAYS; day++) {
+                    rebuild_busy(engine, &engine->map->seats[floor][row][col][day]);
+                }
+            }
+        }
+        mark_floor_dirty(engine, floor);
+    }
+    for (int floor = FLOORS - 1; floor >= 0; floor--) {
+        unlock_floor(engine, floor);
+    }
+    return status;
+}
+
+// ===== 变化跟踪 =====
+
+uint32_t engine_take_dirty(SeatEngine* engine, int floor, int day) {
+    if (!valid_floor(floor) || !valid_day(day)) {
+        return 0;
+    }
+    uint32_t bits = engine->dirty_cells[floor][day];
+    engine->dirty_cells[floor][day] = 0;
+    return bits;
+}
+
+int engine_take_layout_dirty(SeatEngine* engine, int floor) {
+    if (!valid_floor(floor)) {
+        return 0;
+    }
+    int dirty = engine->layout_dirty[floor];
+    engine->layout_dirty[floor] = 0;
+    return dirty;
+}
+
+// 两个座位的预约段是否相同
+static int same_bookings(const Seat* a, const Seat* b) {
+    if (a->count != b->count) {
+        return 0;
+    }
+    for (int i = 0; i < a->count; i++) {
+        const Booking* x = &a->bookings[i];
+        const Booking* y = &b->bookings[i];
+        if (x->start != y->start || x->end != y->end || x->reserved_by != y->reserved_by || x->status != y->status) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 把新读到的一层数据合并进内存，只标记变化的座位
+static void merge_floor(SeatEngine* engine, int floor, Seat seats[ROWS][COLS][DAYS], int rows, int cols) {
+    if (rows != engine->map->floor_rows[floor] || cols != engine->map->floor_cols[floor]) {
+        engine->map->floor_rows[floor] = rows;
+        engine->map->floor_cols[floor] = cols;
+        engine->layout_dirty[floor] = 1;
+    }
+
+    for (int row = 0; row < ROWS; row++) {
+        for (int col = 0; col < COLS; col++) {
+            for (int day = 0; day < DAYS; day++) {
+                Seat* current = &engine->map->seats[floor][row][col][day];
+                Seat* fresh = &seats[row][col][day];
+                if (!same_bookings(current, fresh)) {
+                    *current = *fresh;
+                    mark_dirty(engine, floor, row, col, day);
+                }
+            }
+        }
+    }
+}
+
+// 共享模式下不读文件：修改计数变化的楼层中，只有预约/取消时修改计数变化的座位标记为脏
+static int reload_shared(SeatEngine* engine) {
+    int reloaded = 0;
+#ifdef __linux__
+    for (int floor = 0; floor < FLOORS; floor++) {
+        uint32_t cells[DAYS][ROWS * COLS];
+        lock_floor(engine, floor);
+        uint32_t version = engine->shared->versions[floor];
+        int rows = engine->map->floor_rows[floor];
+        int cols = engine->map->floor_cols[floor];
+        memcpy(cells, engine->shared->cell_versions[floor], sizeof(cells));
+        unlock_floor(engine, floor);
+
+        if (version == engine->shared_seen[floor]) continue;
+        engine->shared_seen[floor] = version;
+        if (rows != engine->shared_rows[floor] || cols != engine->shared_cols[floor]) {
+            engine->shared_rows[floor] = rows;
+            engine->shared_cols[floor] = cols;
+            engine->layout_dirty[floor] = 1;
+        }
+        for (int day = 0; day < DAYS; day++) {
+            for (int i = 0; i < ROWS * COLS; i++) {
+                if (cells[day][i] != engine->shared_cells[floor][day][i]) {
+                    engine->dirty_cells[floor][day] |= 1u << i;
+                }
+            }
+        }
+        memcpy(engine->shared_cells[floor], cells, sizeof(cells));
+        reloaded = 1;
+    }
+#else
+    (void)engine;
+#endif
+    return reloaded;
+}
+
+// 只读进程（如看板）用：数据文件被其他进程修改后重新读取，
+// 与内存不同的座位标记为脏。返回是否读取了新数据。
+// 每次只读出各文件末尾的保存序号，与上次读到的相同就不读文件；
+// 总数据文件变化时只合并序号变化的楼层
+int engine_reload(SeatEngine* engine) {
+    if (engine->shared != NULL) {
+        return reload_shared(engine);
+    }
+
+    uint64_t seqs[FLOORS];
+    int reloaded = 0;
+
+    read_save_seqs(engine->data_file, MAIN_IMAGE_SIZE, seqs, FLOORS);
+    if (memcmp(seqs, engine->reload_main_seq, sizeof(seqs)) != 0) {
+        Seat (*seats)[ROWS][COLS][DAYS] = malloc(sizeof(Seat) * FLOORS * ROWS * COLS * DAYS);
+        int rows[FLOORS], cols[FLOORS];
+        long size;
+        unsigned char* image = seats != NULL ? read_whole_file(engine->data_file, &size) : NULL;
+        // 按读到的镜像中的序号合并：读序号之后文件可能又被替换
+        if (image != NULL &&
+            decode_seat_image(engine, image, size, FLOORS, &seats[0][0][0][0], rows, cols, seqs) == 2) {
+            for (int floor = 0; floor < FLOORS; floor++) {
+                if (seqs[floor] != engine->reload_main_seq[floor] &&
+                    rows[floor] > 0 && rows[floor] <= ROWS && cols[floor] > 0 && cols[floor] <= COLS) {
+                    merge_floor(engine, floor, seats[floor], rows[floor], cols[floor]);
+                }
+            }
+            memcpy(engine->reload_main_seq, seqs, sizeof(seqs));
+            reloaded = 1;
+        }
+        free(image);
+        free(seats);
+    }
+
+    // 分片模式运行中的进程只写楼层文件
+    for (int floor = 0; floor < FLOORS; floor++) {
+        uint64_t seq = read_floor_seq(engine, floor);
+        if (seq == 0 || seq == engine->reload_floor_seq[floor] || seq <= engine->reload_main_seq[floor]) {
+            continue;
+        }
+        Seat seats[ROWS][COLS][DAYS];
+        int rows, cols;
+        if (read_floor_file(engine, floor, seats, &rows, &cols)) {
+            merge_floor(engine, floor, seats, rows, cols);
+            reloaded = 1;
+        }
+        engine->reload_floor_seq[floor] = seq;
+    }
+    return reloaded;
+}
@@ -0,0 +1,217 @@
+﻿#ifndef SEAT_ENGINE_H
+#define SEAT_ENGINE_H
+
+// 图书馆座位预约引擎
+//
+// 与控制台界面无关的预约逻辑：座位表、数据文件、审计日志和异步保存。
+// 每个 SeatEngine 是一个独立的图书馆（建筑），一个进程可以同时打开多个。
+// 每个座位每天按时段预约：开放时间按配置的时段长度划分为最多 ENGINE_MAX_SLOTS 个时段，
+// 一个座位一天的已占用时段是一个 64 位位图，检查和占用一段时间只需几次位运算。
+// 所有操作都只在内存中完成并返回状态码，不读取 stdin、不打印。
+// 座位表的检查和修改不分配堆内存，但开启审计日志时预约/取消会追加审计记录：
+// 当前段写满时切换到新段，改写索引文件并可能分配内存，这一次调用的耗时也随之变长。
+//
+// 线程约定：针对不同楼层的调用可以在不同线程上并发执行；
+// 同一楼层的调用以及 engine_save()、engine_reload() 等涉及整栋楼的调用
+// 需要由调用者保证互斥。
+//
+// 共享模式（配置 shared_name，仅 Linux）：座位表放在 POSIX 共享内存段中，多个进程
+// 同时打开同一个段，预约立即对所有进程可见。引擎内部按楼层加进程间共享的健壮互斥量，
+// 持锁进程崩溃不会让其他进程卡住；写数据文件时持有段内的总锁，各进程的保存不会互相覆盖。
+// 审计日志正在写入的段也在段内，各进程追加到同一组审计文件。
+// 同一进程内上面的线程约定不变。
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENGINE_FLOORS 5
+#define ENGINE_ROWS 4
+#define ENGINE_COLS 4
+#define ENGINE_DAYS 7
+#define ENGINE_SEATS_PER_FLOOR (ENGINE_ROWS * ENGINE_COLS * ENGINE_DAYS)
+#define ENGINE_MAX_SLOTS 64          // 每天最多的时段数
+#define ENGINE_MAX_BOOKINGS 16       // 每个座位每天最多的预约段数
+#define ENGINE_BOOKINGS_PER_FLOOR (ENGINE_SEATS_PER_FLOOR * ENGINE_MAX_BOOKINGS)
+#define ENGINE_ADMIN_ACTOR '*'   // 审计记录中管理员操作者的标记
+
+// 状态码
+typedef enum {
+    ENGINE_OK = 0,
+    ENGINE_NO_DATA,              // 数据文件不存在，使用默认数据
+    ENGINE_ERR_INVALID_ARG = -1, // 楼层、日期或参数超出范围
+    ENGINE_ERR_INVALID_SEAT = -2,// 行列超出该楼层范围
+    ENGINE_ERR_OCCUPIED = -3,    // 座位已被预约
+    ENGINE_ERR_NOT_RESERVED = -4,// 座位未被预约
+    ENGINE_ERR_NOT_OWNER = -5,   // 普通用户取消他人预约
+    ENGINE_ERR_IO = -6,          // 文件读写失败
+    ENGINE_ERR_NO_MEMORY = -7,
+    ENGINE_ERR_FULL = -8,        // 该座位当天的预约段数已达上限
+    ENGINE_ERR_CHANGED = -9      // 楼层的行列数在操作期间被其他进程修改
+} EngineStatus;
+
+// 用户类型
+typedef enum {
+    USER_NORMAL,
+    USER_ADMIN
+} UserType;
+
+// 座位状态
+typedef enum {
+    STATUS_EMPTY = 0,
+    STATUS_RESERVED = 1,
+    STATUS_SELF_RESERVED = 2
+} SeatStatus;
+
+// 一段预约：起止时间按从 0:00 起的分钟数保存，修改时段长度后仍然有效
+typedef struct {
+    int16_t start, end;      // [start, end)
+    char reserved_by;        // 预约的用户字母
+    uint8_t status;          // SeatStatus
+    int64_t reserve_time;    // 预约时间
+} Booking;
+
+// 座位某一天的预约（数据文件按此布局保存）
+typedef struct {
+    uint64_t busy;           // 已占用时段的位图，位 i 为第 i 个时段；加载时由 bookings 重新计算
+    int32_t count;
+    int32_t reserved;
+    Booking bookings[ENGINE_MAX_BOOKINGS]; // 按开始时间排序
+} Seat;
+
+// 一条预约记录
+typedef struct {
+    int row, col, day;
+    int start, end;          // 起止时间（分钟）
+    char reserved_by;
+    time_t reserve_time;
+} EngineReservation;
+
+// 单层座位快照
+typedef struct {
+    Seat seats[ENGINE_ROWS][ENGINE_COLS][ENGINE_DAYS];
+    int rows, cols;
+} EngineFloorSnapshot;
+
+// 保存方式
+typedef enum {
+    PERSIST_SYNC,       // 在调用线程上同步写文件
+    PERSIST_DURABLE,    // 交给后台写线程，写入并 fsync 完成后返回
+    PERSIST_OPTIMISTIC  // 交给后台写线程，提交后立即返回
+} PersistMode;
+
+// 审计事件类型
+typedef enum {
+    AUDIT_RESERVE = 1,     // 预约
+    AUDIT_CANCEL,          // 取消单个预约
+    AUDIT_CANCEL_DAY,      // 管理员取消某天所有预约
+    AUDIT_CANCEL_FLOOR,    // 管理员取消某层所有预约
+    AUDIT_ADJUST,          // 调整楼层时取消超出范围的预约
+    AUDIT_CLEAR            // 清空所有数据
+} AuditEvent;
+
+// 审计记录（32 字节定长）
+typedef struct {
+    int64_t event_time;    // 事件发生时间
+    int64_t reserve_time;  // 对应预约的预约时间
+    uint8_t event;         // AuditEvent
+    char user;             // 座位的预约用户
+    char actor;            // 操作者：用户字母，管理员为 ENGINE_ADMIN_ACTOR
+    uint8_t floor, row, col, day;
+    uint8_t reserved1;
+    int16_t start, end;      // 预约的起止时间（分钟），旧版记录为 0 表示整天
+    uint8_t reserved[4];
+} AuditRecord;
+
+// 引擎配置，先用 engine_config_default() 填默认值再修改
+typedef struct {
+    const char* data_file;          // 总数据文件
+    const char* floor_file_format;  // 楼层文件名格式，%d 为楼层号（从1开始）
+    const char* audit_prefix;       // 审计文件前缀，NULL 表示不记录审计日志
+    int audit_segment_records;      // 每个审计段的记录数
+    int audit_retention_days;       // 审计保留天数，0 表示永久保留
+    PersistMode persist_mode;
+    int use_uring;                  // Linux 下是否使用 io_uring
+    int open_hour;                  // 开馆时间（时）
+    int close_hour;                 // 闭馆时间（时）
+    int slot_minutes;               // 时段长度（分钟），需整除开放时间且时段数不超过 ENGINE_MAX_SLOTS
+    const char* shared_name;        // 共享内存段名称（如 "/library_seats"），NULL 表示每个进程独立加载数据
+} EngineConfig;
+
+typedef struct SeatEngine SeatEngine;
+
+typedef void (*AuditCallback)(const AuditRecord* record, void* context);
+
+void engine_config_default(EngineConfig* config);
+
+// 创建/销毁引擎；销毁前会写完所有待保存的数据。
+// 时段配置无效，或共享内存段无法打开、与本进程的时段配置不一致时返回 NULL
+SeatEngine* engine_create(const EngineConfig* config);
+void engine_destroy(SeatEngine* engine);
+
+// 数据文件；共享模式下只有第一个连接的进程真正读取数据文件
+EngineStatus engine_load(SeatEngine* engine);
+void engine_load_floor_files(SeatEngine* engine, int first_floor, int last_floor);
+EngineStatus engine_save(SeatEngine* engine);
+EngineStatus engine_save_floors(SeatEngine* engine, unsigned floor_mask);
+void engine_flush(SeatEngine* engine);
+// 只读进程取得其他进程的修改，变化的座位记入脏位（见 engine_take_dirty）：
+// 共享模式下按预约/取消时记下的每格修改计数，私有模式下重新读取保存序号变化的数据文件
+int engine_reload(SeatEngine* engine);
+const char* engine_persist_backend(const SeatEngine* engine);
+
+// 内存中的数据镜像，格式与总数据文件相同（录制命令轨迹时保存初始状态）
+size_t engine_image_size(void);
+void engine_export_image(const SeatEngine* engine, unsigned char* image);
+EngineStatus engine_import_image(SeatEngine* engine, const unsigned char* image, size_t size);
+
+// 时段：第 slot 个时段从 engine_slot_minute(engine, slot) 分开始，
+// engine_slot_minute(engine, engine_slot_count(engine)) 为闭馆时间
+int engine_slot_count(const SeatEngine* engine);
+int engine_slot_minute(const SeatEngine* engine, int slot);
+// minute 是时段边界（含闭馆时间）时返回对应的时段号，否则返回 -1
+int engine_slot_boundary(const SeatEngine* engine, int minute);
+// 时段 [start, end) 的位图
+uint64_t engine_slot_mask(int start, int end);
+
+// 查询
+EngineStatus engine_floor_size(const SeatEngine* engine, int floor, int* rows, int* cols);
+EngineStatus engine_get_seat(const SeatEngine* engine, int floor, int row, int col, int day, Seat* seat);
+EngineStatus engine_snapshot_floor(const SeatEngine* engine, int floor, EngineFloorSnapshot* snapshot);
+int engine_collect_floor(const SeatEngine* engine, int floor, EngineReservation* out);
+// 座位表校验和，不含预约时间；用于比较两次运行的最终状态
+uint64_t engine_checksum(const SeatEngine* engine);
+
+// 修改；批量操作返回取消的预约段数，小于0时为错误码。
+// engine_reserve 预约时段 [start, end)，engine_cancel 取消覆盖时段 slot 的那一段预约
+EngineStatus engine_reserve(SeatEngine* engine, int floor, int row, int col, int day,
+    int start, int end, char user_char, UserType by);
+EngineStatus engine_cancel(SeatEngine* engine, int floor, int row, int col, int day,
+    int slot, char user_char, UserType by);
+int engine_cancel_floor_day(SeatEngine* engine, int floor, int day);
+int engine_cancel_floor(SeatEngine* engine, int floor);
+int engine_adjust_floor(SeatEngine* engine, int floor, int rows, int cols);
+int engine_clear_floor(SeatEngine* engine, int floor);
+// 用 ENGINE_FLOORS 层的快照替换整栋楼（导入数据使用，不记审计日志），快照无效时返回错误码且不做修改。
+// 每层快照的行列数必须与该层当前的相同（持有所有楼层的锁时检查），否则返回 ENGINE_ERR_CHANGED，
+// 同样不修改任何楼层。调用者需要保证此时没有其他线程访问任何楼层
+EngineStatus engine_restore(SeatEngine* engine, const EngineFloorSnapshot* snapshots);
+
+// 看板使用的变化跟踪：取出并清除某层的脏位（位 row * ENGINE_COLS + col）
+uint32_t engine_take_dirty(SeatEngine* engine, int floor, int day);
+int engine_take_layout_dirty(SeatEngine* engine, int floor);
+
+// 审计日志
+void engine_audit_flush(SeatEngine* engine);
+int engine_audit_query(SeatEngine* engine, char user, time_t from, time_t to,
+    AuditCallback callback, void* context, int* segments_read, int* segments_total);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
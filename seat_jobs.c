@@ -0,0 +1,491 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+
+#include "seat_jobs.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FLOORS ENGINE_FLOORS
+
+SeatEngine* engine;
+EngineConfig engine_config;
+
+Shard shards[FLOORS];
+int shard_count = 0;       // 0 表示单线程模式
+int floor_owner[FLOORS];   // 每层所属的分片
+int shard_rows[FLOORS], shard_cols[FLOORS]; // 分片模式下各层行列数的副本，由所属分片更新，受该分片的 lock 保护
+
+// 当前时间（微秒）
+double now_us() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// 当前楼层的行数和列数。分片模式下楼层只能由所属分片线程访问，读取分片每批任务后更新的副本
+void floor_size(int floor, int* rows, int* cols) {
+    if (shard_count == 0) {
+        engine_floor_size(engine, floor, rows, cols);
+        return;
+    }
+    Shard* shard = &shards[floor_owner[floor]];
+    mtx_lock(&shard->lock);
+    *rows = shard_rows[floor];
+    *cols = shard_cols[floor];
+    mtx_unlock(&shard->lock);
+}
+
+int floor_rows(int floor) {
+    int rows, cols;
+    floor_size(floor, &rows, &cols);
+    return rows;
+}
+
+int floor_cols(int floor) {
+    int rows, cols;
+    floor_size(floor, &rows, &cols);
+    return cols;
+}
+
+// 在分片线程上刷新所属楼层行列数的副本（调整、清空、导入和其他进程都可能改变行列数）
+void update_floor_sizes(Shard* shard) {
+    int rows[FLOORS], cols[FLOORS];
+    for (int floor = shard->first_floor; floor <= shard->last_floor; floor++) {
+        engine_floor_size(engine, floor, &rows[floor], &cols[floor]);
+    }
+    mtx_lock(&shard->lock);
+    for (int floor = shard->first_floor; floor <= shard->last_floor; floor++) {
+        shard_rows[floor] = rows[floor];
+        shard_cols[floor] = cols[floor];
+    }
+    mtx_unlock(&shard->lock);
+}
+
+
+// 导入整栋楼。分片模式下每个分片都执行到这个任务后才导入，导入期间其他分片停在会合点上
+EngineStatus restore_building(Job* job) {
+    JobBarrier* barrier = job->barrier;
+    if (barrier == NULL) {
+        return engine_restore(engine, job->snapshot);
+    }
+    mtx_lock(&barrier->lock);
+    if (--barrier->waiting == 0) {
+        barrier->result = engine_restore(engine, job->snapshot);
+        barrier->finished = 1;
+        cnd_broadcast(&barrier->done);
+    }
+    while (!barrier->finished) {
+        cnd_wait(&barrier->done, &barrier->lock);
+    }
+    EngineStatus result = barrier->result;
+    mtx_unlock(&barrier->lock);
+    return result;
+}
+
+// 执行任务，楼层范围 [first_floor, last_floor] 用于分发类任务
+// 返回被修改的楼层位图
+unsigned execute_job(Job* job, int first_floor, int last_floor) {
+    unsigned dirty = 0;
+    int floor = job->floor;
+
+    switch (job->type) {
+    case JOB_RESERVE:
+        job->result = engine_reserve(engine, floor, job->row, job->col, job->day, job->start, job->end,
+            job->user_char, job->user_type);
+        if (job->result == ENGINE_OK) dirty |= 1u << floor;
+        break;
+    case JOB_CANCEL:
+        job->result = engine_cancel(engine, floor, job->row, job->col, job->day, job->start,
+            job->user_char, job->user_type);
+        if (job->result == ENGINE_OK) dirty |= 1u << floor;
+        break;
+    case JOB_CANCEL_FLOOR:
+        job->count = engine_cancel_floor(engine, floor);
+        dirty |= 1u << floor;
+        break;
+    case JOB_ADJUST_FLOOR:
+        job->count = engine_adjust_floor(engine, floor, job->new_rows, job->new_cols);
+        dirty |= 1u << floor;
+        break;
+    case JOB_SNAPSHOT:
+        engine_snapshot_floor(engine, floor, job->snapshot);
+        break;
+    case JOB_COLLECT:
+        for (int f = first_floor; f <= last_floor; f++) {
+            job->record_counts[f] = engine_collect_floor(engine, f, job->records[f]);
+        }
+        break;
+    case JOB_CANCEL_DAY:
+        for (int f = first_floor; f <= last_floor; f++) {
+            job->count += engine_cancel_floor_day(engine, f, job->day);
+            dirty |= 1u << f;
+        }
+        break;
+    case JOB_CLEAR:
+        for (int f = first_floor; f <= last_floor; f++) {
+            engine_clear_floor(engine, f);
+            dirty |= 1u << f;
+        }
+        break;
+    case JOB_RESTORE:
+        // 整栋楼一起导入，失败时所有楼层都不修改；各分片分别保存自己的楼层
+        job->result = restore_building(job);
+        for (int f = first_floor; f <= last_floor && job->result == ENGINE_OK; f++) {
+            dirty |= 1u << f;
+        }
+        break;
+    case JOB_STOP:
+        break;
+    }
+    return dirty;
+}
+
+// 任务完成，通知提交者
+void complete_job(Job* job) {
+    JobBatch* batch = job->batch;
+    mtx_lock(&batch->lock);
+    if (--batch->pending == 0) {
+        cnd_signal(&batch->done);
+    }
+    mtx_unlock(&batch->lock);
+}
+
+// 分片工作线程：一次取走队列里的所有任务，执行后每个被修改的楼层只保存一次
+int shard_main(void* arg) {
+    Shard* shard = (Shard*)arg;
+    Job* pending[SHARD_QUEUE_LEN];
+
+    while (1) {
+        mtx_lock(&shard->lock);
+        while (shard->count == 0) {
+            cnd_wait(&shard->not_empty, &shard->lock);
+        }
+        int n = shard->count;
+        for (int i = 0; i < n; i++) {
+            pending[i] = shard->queue[(shard->head + i) % SHARD_QUEUE_LEN];
+        }
+        shard->head = (shard->head + n) % SHARD_QUEUE_LEN;
+        shard->count = 0;
+        cnd_broadcast(&shard->not_full);
+        mtx_unlock(&shard->lock);
+
+        unsigned dirty = 0;
+        int stop = 0;
+        unsigned job_dirty[SHARD_QUEUE_LEN];
+        for (int i = 0; i < n; i++) {
+            job_dirty[i] = execute_job(pending[i], shard->first_floor, shard->last_floor);
+            dirty |= job_dirty[i];
+            if (pending[i]->type == JOB_STOP) stop = 1;
+        }
+
+        // 各层分别保存，失败时无法区分具体楼层，整批都报告失败
+        int saved = 1;
+        if (dirty) {
+            saved = engine_save_floors(engine, dirty) == ENGINE_OK;
+        }
+        update_floor_sizes(shard);
+
+        for (int i = 0; i < n; i++) {
+            pending[i]->saved = job_dirty[i] ? saved : -1;
+            complete_job(pending[i]);
+        }
+
+        if (stop) {
+            return 0;
+        }
+    }
+}
+
+// 把任务放入分片队列，队列满时等待
+void submit_job(Shard* shard, Job* job) {
+    mtx_lock(&shard->lock);
+    while (shard->count == SHARD_QUEUE_LEN) {
+        cnd_wait(&shard->not_full, &shard->lock);
+    }
+    shard->queue[(shard->head + shard->count) % SHARD_QUEUE_LEN] = job;
+    shard->count++;
+    cnd_signal(&shard->not_empty);
+    mtx_unlock(&shard->lock);
+}
+
+// 等待一组任务全部完成
+void wait_batch(JobBatch* batch) {
+    mtx_lock(&batch->lock);
+    while (batch->pending > 0) {
+        cnd_wait(&batch->done, &batch->lock);
+    }
+    mtx_unlock(&batch->lock);
+}
+
+// 执行一个任务并等待结果：
+// 单线程模式直接执行并保存总数据文件；分片模式下单层任务交给所属分片，
+// 分发类任务复制给每个分片并合并结果
+void dispatch_job(Job* job) {
+    job->result = ENGINE_OK;
+    job->count = 0;
+    job->saved = -1;
+
+    if (shard_count == 0) {
+        if (execute_job(job, 0, FLOORS - 1)) {
+            job->saved = engine_save(engine) == ENGINE_OK;
+        }
+        return;
+    }
+
+    JobBatch batch;
+    mtx_init(&batch.lock, mtx_plain);
+    cnd_init(&batch.done);
+
+    if (job->type < JOB_COLLECT) {
+        batch.pending = 1;
+        job->batch = &batch;
+        submit_job(&shards[floor_owner[job->floor]], job);
+        wait_batch(&batch);
+    }
+    else {
+        // 导入需要所有分片同时停下，同一时间只能有一个线程发起导入
+        JobBarrier barrier;
+        if (job->type == JOB_RESTORE) {
+            mtx_init(&barrier.lock, mtx_plain);
+            cnd_init(&barrier.done);
+            barrier.waiting = shard_count;
+            barrier.finished = 0;
+            job->barrier = &barrier;
+        }
+        Job parts[FLOORS];
+        batch.pending = shard_count;
+        for (int i = 0; i < shard_count; i++) {
+            parts[i] = *job;
+            parts[i].batch = &batch;
+            submit_job(&shards[i], &parts[i]);
+        }
+        wait_batch(&batch);
+
+        for (int i = 0; i < shard_count; i++) {
+            job->count += parts[i].count;
+            if (parts[i].result != ENGINE_OK) {
+                job->result = parts[i].result;
+            }
+            if (parts[i].saved == 0 || (parts[i].saved == 1 && job->saved != 0)) {
+                job->saved = parts[i].saved;
+            }
+        }
+        if (job->type == JOB_RESTORE) {
+            job->barrier = NULL;
+            cnd_destroy(&barrier.done);
+            mtx_destroy(&barrier.lock);
+        }
+    }
+
+    cnd_destroy(&batch.done);
+    mtx_destroy(&batch.lock);
+}
+
+// 启动分片线程，楼层按连续分组分配给 count 个线程
+void start_shards(int count) {
+    if (count < 1) count = 1;
+    if (count > FLOORS) count = FLOORS;
+
+    for (int i = 0; i < count; i++) {
+        Shard* shard = &shards[i];
+        memset(shard, 0, sizeof(*shard));
+        shard->first_floor = i * FLOORS / count;
+        shard->last_floor = (i + 1) * FLOORS / count - 1;
+        mtx_init(&shard->lock, mtx_plain);
+        cnd_init(&shard->not_empty);
+        cnd_init(&shard->not_full);
+
+        for (int floor = shard->first_floor; floor <= shard->last_floor; floor++) {
+            floor_owner[floor] = i;
+        }
+        engine_load_floor_files(engine, shard->first_floor, shard->last_floor);
+        update_floor_sizes(shard);
+    }
+
+    for (int i = 0; i < count; i++) {
+        thrd_create(&shards[i].thread, shard_main, &shards[i]);
+    }
+    shard_count = count;
+    printf("分片模式：%d 个工作线程\n", count);
+}
+
+// 停止分片线程，之后写回总数据文件
+void stop_shards() {
+    if (shard_count == 0) return;
+
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_STOP;
+    dispatch_job(&job);
+
+    for (int i = 0; i < shard_count; i++) {
+        thrd_join(shards[i].thread, NULL);
+        cnd_destroy(&shards[i].not_full);
+        cnd_destroy(&shards[i].not_empty);
+        mtx_destroy(&shards[i].lock);
+    }
+    shard_count = 0;
+}
+
+// ===== 命令轨迹 =====
+
+#define TRACE_MAGIC "LIBTRACE"
+#define TRACE_VERSION 2
+
+FILE* trace_file = NULL;
+TraceHeader trace_header;
+double trace_last_us;
+
+int16_t clamp_int16(int value) {
+    return (int16_t)(value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : value));
+}
+
+// 开始录制：写文件头和当前数据镜像
+int trace_start(const char* filename) {
+    size_t image_size = engine_image_size();
+    unsigned char* image = (unsigned char*)malloc(image_size);
+    FILE* file = fopen(filename, "wb");
+    if (image == NULL || file == NULL) {
+        free(image);
+        if (file != NULL) fclose(file);
+        return 0;
+    }
+
+    memset(&trace_header, 0, sizeof(trace_header));
+    memcpy(trace_header.magic, TRACE_MAGIC, sizeof(trace_header.magic));
+    trace_header.version = TRACE_VERSION;
+    trace_header.record_size = sizeof(TraceRecord);
+    trace_header.image_size = (uint32_t)image_size;
+    trace_header.restore_size = (uint32_t)(sizeof(EngineFloorSnapshot) * FLOORS);
+    trace_header.open_hour = engine_config.open_hour;
+    trace_header.close_hour = engine_config.close_hour;
+    trace_header.slot_minutes = engine_config.slot_minutes;
+    trace_header.start_time = (int64_t)time(NULL);
+    trace_header.initial_checksum = engine_checksum(engine);
+    engine_export_image(engine, image);
+
+    int ok = fwrite(&trace_header, sizeof(trace_header), 1, file) == 1 &&
+        fwrite(image, image_size, 1, file) == 1;
+    free(image);
+    if (!ok) {
+        fclose(file);
+        return 0;
+    }
+    trace_file = file;
+    trace_last_us = now_us();
+    return 1;
+}
+
+// 记录一个已完成的任务，begin 为提交时间
+void trace_job(const Job* job, double begin, double latency) {
+    TraceRecord record;
+    memset(&record, 0, sizeof(record));
+    double delta = begin - trace_last_us;
+    trace_last_us = begin;
+    record.delta_us = delta <= 0 ? 0 : (delta >= UINT32_MAX ? UINT32_MAX : (uint32_t)delta);
+    record.latency_us = latency >= UINT32_MAX ? UINT32_MAX : (uint32_t)latency;
+    record.type = (uint8_t)job->type;
+    record.user_type = (uint8_t)job->user_type;
+    record.user_char = job->user_char;
+    record.result = (int8_t)job->result;
+    record.floor = (int8_t)job->floor;
+    record.day = (int8_t)job->day;
+    record.start = (int8_t)job->start;
+    record.end = (int8_t)job->end;
+    record.row = clamp_int16(job->row);
+    record.col = clamp_int16(job->col);
+    record.new_rows = clamp_int16(job->new_rows);
+    record.new_cols = clamp_int16(job->new_cols);
+    record.count = job->count;
+    if (fwrite(&record, sizeof(record), 1, trace_file) != 1) {
+        return;
+    }
+    // 导入的数据不在其他地方保存，回放时要用同一份快照
+    if (job->type == JOB_RESTORE &&
+        fwrite(job->snapshot, trace_header.restore_size, 1, trace_file) != 1) {
+        return;
+    }
+    trace_header.record_count++;
+}
+
+// 结束录制：在文件头写入记录数和最终状态的校验和
+void trace_finish() {
+    if (trace_file == NULL) return;
+    trace_header.final_checksum = engine_checksum(engine);
+    if (trace_header.final_checksum == 0) {
+        trace_header.final_checksum = 1;
+    }
+    fseek(trace_file, 0, SEEK_SET);
+    fwrite(&trace_header, sizeof(trace_header), 1, trace_file);
+    fclose(trace_file);
+    trace_file = NULL;
+    printf("已录制 %u 个任务\n", trace_header.record_count);
+}
+
+// 执行一个任务并等待结果，录制轨迹时记下任务和耗时
+void run_job(Job* job) {
+    if (trace_file == NULL || job->type == JOB_STOP) {
+        dispatch_job(job);
+        return;
+    }
+    double begin = now_us();
+    dispatch_job(job);
+    trace_job(job, begin, now_us() - begin);
+}
+
+// 读入轨迹：文件头、初始镜像、所有记录和导入任务的快照（按记录顺序连续存放）。
+// 录制没有正常结束时读到最后一条完整的记录为止。镜像、记录和快照由调用者 free，失败时返回 -1
+long read_trace(const char* filename, TraceHeader* header, unsigned char** image, TraceRecord** records,
+    EngineFloorSnapshot** restores) {
+    *image = NULL;
+    *records = NULL;
+    *restores = NULL;
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    long count = -1;
+    if (fread(header, sizeof(*header), 1, file) == 1 &&
+        memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) == 0 &&
+        header->version == TRACE_VERSION && header->record_size == sizeof(TraceRecord) &&
+        header->image_size == engine_image_size() &&
+        header->restore_size == sizeof(EngineFloorSnapshot) * FLOORS) {
+        fseek(file, 0, SEEK_END);
+        long body = ftell(file) - (long)sizeof(*header) - (long)header->image_size;
+        fseek(file, (long)sizeof(*header), SEEK_SET);
+
+        // 记录数不超过 body / sizeof(TraceRecord)，快照数不超过 body / restore_size
+        long max_records = body > 0 ? body / (long)sizeof(TraceRecord) : 0;
+        long max_restores = body > 0 ? body / (long)header->restore_size : 0;
+        *image = (unsigned char*)malloc(header->image_size);
+        *records = (TraceRecord*)malloc(sizeof(TraceRecord) * (max_records > 0 ? max_records : 1));
+        *restores = (EngineFloorSnapshot*)malloc((size_t)header->restore_size * (max_restores > 0 ? max_restores : 1));
+        if (body >= 0 && *image != NULL && *records != NULL && *restores != NULL &&
+            fread(*image, header->image_size, 1, file) == 1) {
+            long restore_count = 0;
+            count = 0;
+            while (count < max_records && fread(&(*records)[count], sizeof(TraceRecord), 1, file) == 1) {
+                if ((*records)[count].type == JOB_RESTORE) {
+                    if (restore_count >= max_restores ||
+                        fread(*restores + restore_count * FLOORS, header->restore_size, 1, file) != 1) {
+                        break;
+                    }
+                    restore_count++;
+                }
+                count++;
+            }
+        }
+    }
+    fclose(file);
+    if (count < 0) {
+        free(*image);
+        free(*records);
+        free(*restores);
+        *image = NULL;
+        *records = NULL;
+        *restores = NULL;
+    }
+    return count;
+}
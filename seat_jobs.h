@@ -0,0 +1,158 @@
+﻿#ifndef SEAT_JOBS_H
+#define SEAT_JOBS_H
+
+// 任务分发和命令轨迹
+//
+// 界面和测试程序把对引擎的操作包装成任务交给 run_job()：单线程模式直接执行并保存总数据文件；
+// start_shards() 之后每个分片线程独占一组连续楼层，单层任务交给所属分片，分发类任务复制给每个分片。
+//
+// 录制（--record 文件）：每个交给引擎的任务（预约、取消、查看、管理员批量操作）追加一条
+// 定长记录，包括参数、用户、与上一条的间隔和执行耗时；导入任务的记录后面跟着导入的整栋楼快照。
+// 文件头后面是开始录制时的数据镜像，正常退出时在文件头写入最终状态的校验和。
+// 回放（seat_bench --replay 文件）：从镜像恢复初始状态，不读 stdin，按录制的节奏或尽快执行所有任务，
+// 报告每类任务的延迟分布、结果与录制时不同的任务数以及最终校验和是否一致。
+// 登录/退出登录不经过引擎，用户记录在每条任务里；查询预约历史只读审计日志，不录制。
+
+#include <stdio.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include "seat_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHARD_QUEUE_LEN 64                    // 每个分片的任务队列长度
+
+// 任务类型：前五种针对单个楼层，其余的分发到所有分片
+typedef enum {
+    JOB_RESERVE,
+    JOB_CANCEL,
+    JOB_CANCEL_FLOOR,
+    JOB_ADJUST_FLOOR,
+    JOB_SNAPSHOT,
+    JOB_COLLECT,
+    JOB_CANCEL_DAY,
+    JOB_CLEAR,
+    JOB_RESTORE,
+    JOB_STOP
+} JobType;
+
+// 一组任务的完成通知
+typedef struct {
+    mtx_t lock;
+    cnd_t done;
+    int pending;
+} JobBatch;
+
+// 分片模式下导入的会合点：每个分片执行到导入任务时在这里等待，
+// 所有分片都到达后（此时没有分片在访问楼层）由最后到达的分片导入整栋楼
+typedef struct {
+    mtx_t lock;
+    cnd_t done;
+    int waiting;                     // 尚未到达的分片数
+    int finished;
+    EngineStatus result;
+} JobBarrier;
+
+// 提交给分片线程的任务
+typedef struct {
+    JobType type;
+    int floor, row, col, day;
+    int start, end;                  // 预约的时段 [start, end)；取消时 start 为预约内的任一时段
+    int new_rows, new_cols;          // JOB_ADJUST_FLOOR 的新行列数
+    char user_char;                  // 预约/取消的用户字母
+    UserType user_type;              // 发起操作的用户类型
+    EngineStatus result;
+    int count;                       // 批量操作影响的预约数
+    int saved;                       // 修改是否已写入文件（-1 表示未修改）
+    EngineReservation (*records)[ENGINE_BOOKINGS_PER_FLOOR]; // JOB_COLLECT 输出，按楼层存放
+    int* record_counts;
+    EngineFloorSnapshot* snapshot;   // JOB_SNAPSHOT 输出；JOB_RESTORE 输入，按楼层存放的整栋楼
+    JobBatch* batch;
+    JobBarrier* barrier;             // 分片模式下的 JOB_RESTORE 使用
+} Job;
+
+// 分片：一个工作线程独占一组连续楼层
+typedef struct {
+    int first_floor, last_floor;
+    thrd_t thread;
+    mtx_t lock;
+    cnd_t not_empty, not_full;
+    Job* queue[SHARD_QUEUE_LEN];
+    int head, count;
+} Shard;
+
+extern SeatEngine* engine;
+extern EngineConfig engine_config;           // 引擎配置，由命令行参数修改
+
+extern Shard shards[ENGINE_FLOORS];
+extern int shard_count;                      // 0 表示单线程模式
+extern int floor_owner[ENGINE_FLOORS];       // 每层所属的分片
+
+// 当前时间（微秒）
+double now_us();
+// 当前楼层的行数和列数；分片模式下读取所属分片维护的副本，可以在任何线程上调用
+void floor_size(int floor, int* rows, int* cols);
+int floor_rows(int floor);
+int floor_cols(int floor);
+
+// 把任务放入分片队列，队列满时等待；任务带 batch 时完成后通知
+void submit_job(Shard* shard, Job* job);
+// 等待一组任务全部完成
+void wait_batch(JobBatch* batch);
+// 执行一个任务并等待结果（不录制）
+void dispatch_job(Job* job);
+
+// 启动分片线程，楼层按连续分组分配给 count 个线程
+void start_shards(int count);
+// 停止分片线程，之后写回总数据文件
+void stop_shards();
+
+// ===== 命令轨迹 =====
+
+// 轨迹文件头
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;       // sizeof(TraceRecord)
+    uint32_t image_size;        // 紧跟在文件头后面的初始数据镜像的字节数
+    uint32_t record_count;
+    int32_t open_hour, close_hour, slot_minutes;
+    uint32_t restore_size;      // 每条导入任务记录后面的快照字节数
+    int64_t start_time;         // 开始录制的时间
+    uint64_t initial_checksum;
+    uint64_t final_checksum;    // 正常退出时写入，0 表示录制没有正常结束
+} TraceHeader;
+
+// 一条任务记录（28 字节）
+typedef struct {
+    uint32_t delta_us;          // 与上一条任务提交时间的间隔（微秒）
+    uint32_t latency_us;        // 录制时从提交到完成的时间（微秒）
+    uint8_t type;               // JobType
+    uint8_t user_type;          // UserType
+    char user_char;
+    int8_t result;              // EngineStatus
+    int8_t floor, day, start, end;
+    int16_t row, col;
+    int16_t new_rows, new_cols;
+    int32_t count;              // 批量操作影响的预约数
+} TraceRecord;
+
+extern FILE* trace_file;                     // 正在录制的轨迹，NULL 表示不录制
+
+// 开始录制：写文件头和当前数据镜像；退出前 trace_finish() 写入最终校验和
+int trace_start(const char* filename);
+void trace_finish();
+// 执行一个任务并等待结果，录制轨迹时记下任务和耗时
+void run_job(Job* job);
+// 读入轨迹：镜像、记录和导入任务的快照由调用者 free，失败时返回 -1
+long read_trace(const char* filename, TraceHeader* header, unsigned char** image, TraceRecord** records,
+    EngineFloorSnapshot** restores);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,559 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+
+#include "seat_text.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEXT_BUFFER_SIZE (1 << 20)
+#define TEXT_FIELD_LEN 32
+#define CSV_FIELDS 9
+
+static const char CSV_HEADER[] = "楼层,行,列,天,开始,结束,用户,状态,预约时间\n";
+
+// ===== 写出 =====
+
+// 输出缓冲区：攒满后一次 fwrite
+typedef struct {
+    FILE* out;
+    char* buffer;
+    size_t length;
+    int failed;
+} TextWriter;
+
+static void writer_flush(TextWriter* writer) {
+    if (writer->length > 0 && !writer->failed &&
+        fwrite(writer->buffer, 1, writer->length, writer->out) != writer->length) {
+        writer->failed = 1;
+    }
+    writer->length = 0;
+}
+
+// 保证缓冲区还有 need 字节的空间（每次写入的内容都远小于缓冲区）
+static char* writer_reserve(TextWriter* writer, size_t need) {
+    if (writer->length + need > TEXT_BUFFER_SIZE) {
+        writer_flush(writer);
+    }
+    return writer->buffer + writer->length;
+}
+
+static void put_char(TextWriter* writer, char c) {
+    *writer_reserve(writer, 1) = c;
+    writer->length++;
+}
+
+static void put_bytes(TextWriter* writer, const char* bytes, size_t length) {
+    memcpy(writer_reserve(writer, length), bytes, length);
+    writer->length += length;
+}
+
+static void put_uint(TextWriter* writer, unsigned value) {
+    char digits[12];
+    int length = 0;
+    do {
+        digits[length++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    char* out = writer_reserve(writer, length);
+    for (int i = 0; i < length; i++) {
+        out[i] = digits[length - 1 - i];
+    }
+    writer->length += length;
+}
+
+static void put_2digits(TextWriter* writer, int value) {
+    char* out = writer_reserve(writer, 2);
+    out[0] = (char)('0' + value / 10 % 10);
+    out[1] = (char)('0' + value % 10);
+    writer->length += 2;
+}
+
+// 时间 HH:MM
+static void put_minute(TextWriter* writer, int minute) {
+    put_2digits(writer, minute / 60);
+    put_char(writer, ':');
+    put_2digits(writer, minute % 60);
+}
+
+// 预约时间的 "YYYY-MM-DD HH:" 部分按小时缓存，同一小时内的记录只需计算分和秒
+typedef struct {
+    time_t hour_start;
+    char prefix[32];
+    int prefix_len;
+} TimeCache;
+
+// 预约时间为 0（没有记录）时不写
+static void put_timestamp(TextWriter* writer, TimeCache* cache, time_t value) {
+    if (value == 0) {
+        return;
+    }
+    if (cache->prefix_len == 0 || value < cache->hour_start || value >= cache->hour_start + 3600) {
+        struct tm* local = localtime(&value);
+        if (local == NULL) {
+            return;
+        }
+        cache->hour_start = value - local->tm_min * 60 - local->tm_sec;
+        cache->prefix_len = snprintf(cache->prefix, sizeof(cache->prefix), "%04d-%02d-%02d %02d:",
+            local->tm_year + 1900, local->tm_mon + 1, local->tm_mday, local->tm_hour);
+    }
+    int offset = (int)(value - cache->hour_start);
+    put_bytes(writer, cache->prefix, cache->prefix_len);
+    put_2digits(writer, offset / 60);
+    put_char(writer, ':');
+    put_2digits(writer, offset % 60);
+}
+
+static long export_csv(TextWriter* writer, const EngineFloorSnapshot* floors) {
+    TimeCache cache = { 0 };
+    long records = 0;
+    put_bytes(writer, CSV_HEADER, sizeof(CSV_HEADER) - 1);
+    for (int floor = 0; floor < ENGINE_FLOORS; floor++) {
+        const EngineFloorSnapshot* snapshot = &floors[floor];
+        for (int row = 0; row < snapshot->rows; row++) {
+            for (int col = 0; col < snapshot->cols; col++) {
+                for (int day = 0; day < ENGINE_DAYS; day++) {
+                    const Seat* seat = &snapshot->seats[row][col][day];
+                    for (int i = 0; i < seat->count; i++) {
+                        const Booking* booking = &seat->bookings[i];
+                        put_uint(writer, floor + 1);
+                        put_char(writer, ',');
+                        put_uint(writer, row + 1);
+                        put_char(writer, ',');
+                        put_uint(writer, col + 1);
+                        put_char(writer, ',');
+                        put_uint(writer, day + 1);
+                        put_char(writer, ',');
+                        put_minute(writer, booking->start);
+                        put_char(writer, ',');
+                        put_minute(writer, booking->end);
+                        put_char(writer, ',');
+                        put_char(writer, booking->reserved_by);
+                        put_char(writer, ',');
+                        put_uint(writer, booking->status);
+                        put_char(writer, ',');
+                        put_timestamp(writer, &cache, (time_t)booking->reserve_time);
+                        put_char(writer, '\n');
+                        records++;
+                    }
+                }
+            }
+        }
+    }
+    return records;
+}
+
+// 整表：行列范围外的座位也写出（都是 0）；与 library_data.txt 一样每组后面跟一个空格、不换行
+static long export_grid(TextWriter* writer, const SeatEngine* engine, const EngineFloorSnapshot* floors) {
+    int open = engine_slot_minute(engine, 0);
+    int close = engine_slot_minute(engine, engine_slot_count(engine));
+    long records = 0;
+    for (int floor = 0; floor < ENGINE_FLOORS; floor++) {
+        for (int row = 0; row < ENGINE_ROWS; row++) {
+            for (int col = 0; col < ENGINE_COLS; col++) {
+                for (int day = 0; day < ENGINE_DAYS; day++) {
+                    const Seat* seat = &floors[floor].seats[row][col][day];
+                    if (seat->count == 0) {
+                        put_bytes(writer, "0 ", 2);
+                        continue;
+                    }
+                    for (int i = 0; i < seat->count; i++) {
+                        const Booking* booking = &seat->bookings[i];
+                        if (i > 0) {
+                            put_bytes(writer, "+ ", 2);
+                        }
+                        put_uint(writer, booking->status);
+                        put_char(writer, ' ');
+                        put_char(writer, booking->reserved_by);
+                        put_char(writer, ' ');
+                        if (booking->start != open || booking->end != close) {
+                            put_minute(writer, booking->start);
+                            put_char(writer, '-');
+                            put_minute(writer, booking->end);
+                            put_char(writer, ' ');
+                        }
+                        records++;
+                    }
+                }
+            }
+        }
+    }
+    return records;
+}
+
+EngineStatus seat_text_export(const SeatEngine* engine, const EngineFloorSnapshot* floors,
+    SeatTextFormat format, FILE* out, long* records) {
+    TextWriter writer = { out, (char*)malloc(TEXT_BUFFER_SIZE), 0, 0 };
+    if (writer.buffer == NULL) {
+        return ENGINE_ERR_NO_MEMORY;
+    }
+    long count = (format == SEAT_TEXT_CSV) ? export_csv(&writer, floors) : export_grid(&writer, engine, floors);
+    writer_flush(&writer);
+    free(writer.buffer);
+    if (records != NULL) {
+        *records = count;
+    }
+    if (writer.failed || fflush(out) != 0) {
+        return ENGINE_ERR_IO;
+    }
+    return ENGINE_OK;
+}
+
+// ===== 读入 =====
+
+// 输入缓冲区：一次读入一大块，逐字节切分
+typedef struct {
+    FILE* in;
+    char* buffer;
+    size_t pos, length;
+    int failed;
+    long line;
+} TextReader;
+
+static int reader_peek(TextReader* reader) {
+    if (reader->pos == reader->length) {
+        if (reader->failed) {
+            return EOF;
+        }
+        reader->length = fread(reader->buffer, 1, TEXT_BUFFER_SIZE, reader->in);
+        reader->pos = 0;
+        if (reader->length == 0) {
+            reader->failed = ferror(reader->in) ? -1 : 1;
+            return EOF;
+        }
+    }
+    return (unsigned char)reader->buffer[reader->pos];
+}
+
+static int reader_get(TextReader* reader) {
+    int c = reader_peek(reader);
+    if (c != EOF) {
+        reader->pos++;
+        if (c == '\n') {
+            reader->line++;
+        }
+    }
+    return c;
+}
+
+static int is_space(int c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// 读到空白为止的一个词，超长的部分丢弃（长度仍然计入）；输入结束时返回 0
+static int read_token(TextReader* reader, char* token, int* length) {
+    int c;
+    while ((c = reader_peek(reader)) != EOF && is_space(c)) {
+        reader_get(reader);
+    }
+    if (c == EOF) {
+        return 0;
+    }
+    int count = 0;
+    while ((c = reader_peek(reader)) != EOF && !is_space(c)) {
+        if (count < TEXT_FIELD_LEN - 1) {
+            token[count] = (char)c;
+        }
+        count++;
+        reader->pos++;
+    }
+    token[count < TEXT_FIELD_LEN ? count : TEXT_FIELD_LEN - 1] = '\0';
+    *length = count;
+    return 1;
+}
+
+// 非负整数，最多 9 位
+static int parse_uint(const char* text, int length, int* value) {
+    if (length <= 0 || length > 9) {
+        return 0;
+    }
+    int number = 0;
+    for (int i = 0; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9') return 0;
+        number = number * 10 + (text[i] - '0');
+    }
+    *value = number;
+    return 1;
+}
+
+// 时间 H:MM 或 HH:MM
+static int parse_minute(const char* text, int length, int* minute) {
+    int hour, minutes;
+    if (length < 4 || length > 5 || text[length - 3] != ':' ||
+        !parse_uint(text, length - 3, &hour) || !parse_uint(text + length - 2, 2, &minutes) ||
+        minutes > 59 || hour * 60 + minutes > 24 * 60) {
+        return 0;
+    }
+    *minute = hour * 60 + minutes;
+    return 1;
+}
+
+// 预约时间 YYYY-MM-DD HH:MM:SS，mktime 的结果按小时缓存
+typedef struct {
+    char prefix[13];         // "YYYY-MM-DD HH"
+    time_t hour_start;
+    int valid;
+} ParseCache;
+
+static int parse_timestamp(ParseCache* cache, const char* text, int length, time_t* value) {
+    static const char pattern[] = "0000-00-00 00:00:00";
+    if (length != (int)sizeof(pattern) - 1) {
+        return 0;
+    }
+    for (int i = 0; i < length; i++) {
+        if (pattern[i] == '0' ? (text[i] < '0' || text[i] > '9') : text[i] != pattern[i]) return 0;
+    }
+    int minute = (text[14] - '0') * 10 + (text[15] - '0');
+    int second = (text[17] - '0') * 10 + (text[18] - '0');
+    if (minute > 59 || second > 59) {
+        return 0;
+    }
+    if (!cache->valid || memcmp(cache->prefix, text, sizeof(cache->prefix)) != 0) {
+        struct tm local;
+        memset(&local, 0, sizeof(local));
+        local.tm_year = atoi(text) - 1900;
+        local.tm_mon = (text[5] - '0') * 10 + (text[6] - '0') - 1;
+        local.tm_mday = (text[8] - '0') * 10 + (text[9] - '0');
+        local.tm_hour = (text[11] - '0') * 10 + (text[12] - '0');
+        local.tm_isdst = -1;
+        if (local.tm_mon < 0 || local.tm_mon > 11 || local.tm_mday < 1 || local.tm_mday > 31 || local.tm_hour > 23) {
+            return 0;
+        }
+        time_t start = mktime(&local);
+        if (start == (time_t)-1) {
+            return 0;
+        }
+        memcpy(cache->prefix, text, sizeof(cache->prefix));
+        cache->hour_start = start;
+        cache->valid = 1;
+    }
+    *value = cache->hour_start + minute * 60 + second;
+    return 1;
+}
+
+// 预约用户：一个可见字符（逗号和 + 用作分隔）
+static int valid_user(const char* text, int length) {
+    return length == 1 && text[0] > ' ' && text[0] < 127 && text[0] != ',' && text[0] != '+';
+}
+
+// 把一段预约加入快照中的座位，保持按开始时间排序
+static EngineStatus add_booking(const SeatEngine* engine, EngineFloorSnapshot* snapshot,
+    int row, int col, int day, int start, int end, char user, int status, time_t reserve_time) {
+    if (row < 0 || row >= snapshot->rows || col < 0 || col >= snapshot->cols) {
+        return ENGINE_ERR_INVALID_SEAT;
+    }
+    int first = engine_slot_boundary(engine, start);
+    int last = engine_slot_boundary(engine, end);
+    if (first < 0 || last < 0 || first >= last) {
+        return ENGINE_ERR_INVALID_ARG;
+    }
+
+    Seat* seat = &snapshot->seats[row][col][day];
+    uint64_t mask = engine_slot_mask(first, last);
+    if (seat->busy & mask) {
+        return ENGINE_ERR_OCCUPIED;
+    }
+    if (seat->count == ENGINE_MAX_BOOKINGS) {
+        return ENGINE_ERR_FULL;
+    }
+    int index = seat->count;
+    while (index > 0 && seat->bookings[index - 1].start > start) {
+        seat->bookings[index] = seat->bookings[index - 1];
+        index--;
+    }
+    Booking* booking = &seat->bookings[index];
+    memset(booking, 0, sizeof(*booking));
+    booking->start = (int16_t)start;
+    booking->end = (int16_t)end;
+    booking->reserved_by = user;
+    booking->status = (uint8_t)status;
+    booking->reserve_time = (int64_t)reserve_time;
+    seat->count++;
+    seat->busy |= mask;
+    return ENGINE_OK;
+}
+
+// 读一个 CSV 字段（到逗号或行尾），返回结束字符：',' 、'\n' 或 EOF
+static int read_field(TextReader* reader, char* field, int* length) {
+    int count = 0;
+    int c;
+    while ((c = reader_get(reader)) != EOF && c != ',' && c != '\n') {
+        if (count < TEXT_FIELD_LEN - 1) {
+            field[count] = (char)c;
+        }
+        count++;
+    }
+    if (count > 0 && count <= TEXT_FIELD_LEN - 1 && field[count - 1] == '\r') {
+        count--;
+    }
+    field[count < TEXT_FIELD_LEN ? count : TEXT_FIELD_LEN - 1] = '\0';
+    *length = count;
+    return c;
+}
+
+static EngineStatus import_csv(const SeatEngine* engine, TextReader* reader, EngineFloorSnapshot* floors,
+    long* records, long* error_line) {
+    char fields[CSV_FIELDS][TEXT_FIELD_LEN];
+    int lengths[CSV_FIELDS];
+    ParseCache cache = { { 0 }, 0, 0 };
+    time_t now = time(NULL);
+
+    for (;;) {
+        long line = reader->line;
+        int c = reader_peek(reader);
+        if (c == EOF) {
+            break;
+        }
+        // 空行跳过，第一行不以数字开头时是表头
+        if (c == '\n' || c == '\r' || (line == 1 && (c < '0' || c > '9'))) {
+            while ((c = reader_get(reader)) != EOF && c != '\n') {
+            }
+            continue;
+        }
+
+        int count = 0;
+        int end;
+        do {
+            if (count == CSV_FIELDS) {
+                *error_line = line;
+                return ENGINE_ERR_INVALID_ARG;
+            }
+            end = read_field(reader, fields[count], &lengths[count]);
+            count++;
+        } while (end == ',');
+        *error_line = line;
+        if (count < CSV_FIELDS - 1) {
+            return ENGINE_ERR_INVALID_ARG;
+        }
+
+        int floor, row, col, day, start, stop, status;
+        time_t reserve_time = now;
+        if (!parse_uint(fields[0], lengths[0], &floor) || floor < 1 || floor > ENGINE_FLOORS ||
+            !parse_uint(fields[1], lengths[1], &row) || !parse_uint(fields[2], lengths[2], &col) ||
+            !parse_uint(fields[3], lengths[3], &day) || day < 1 || day > ENGINE_DAYS ||
+            !parse_minute(fields[4], lengths[4], &start) || !parse_minute(fields[5], lengths[5], &stop) ||
+            !valid_user(fields[6], lengths[6]) ||
+            !parse_uint(fields[7], lengths[7], &status) ||
+            (status != STATUS_RESERVED && status != STATUS_SELF_RESERVED) ||
+            (count == CSV_FIELDS && lengths[8] > 0 &&
+                !parse_timestamp(&cache, fields[8], lengths[8], &reserve_time))) {
+            return ENGINE_ERR_INVALID_ARG;
+        }
+        EngineStatus result = add_booking(engine, &floors[floor - 1], row - 1, col - 1, day - 1,
+            start, stop, fields[6][0], status, reserve_time);
+        if (result != ENGINE_OK) {
+            return result;
+        }
+        (*records)++;
+    }
+    return ENGINE_OK;
+}
+
+static EngineStatus import_grid(const SeatEngine* engine, TextReader* reader, EngineFloorSnapshot* floors,
+    long* records, long* error_line) {
+    int open = engine_slot_minute(engine, 0);
+    int close = engine_slot_minute(engine, engine_slot_count(engine));
+    time_t now = time(NULL);
+    char token[TEXT_FIELD_LEN];
+    int length;
+    // 读过的下一个词（用于判断后面是否跟着时间段或 +）
+    int pending = 0;
+
+    for (int floor = 0; floor < ENGINE_FLOORS; floor++) {
+        for (int row = 0; row < ENGINE_ROWS; row++) {
+            for (int col = 0; col < ENGINE_COLS; col++) {
+                for (int day = 0; day < ENGINE_DAYS; day++) {
+                    for (;;) {
+                        if (!pending && !read_token(reader, token, &length)) {
+                            *error_line = reader->line;
+                            return ENGINE_ERR_INVALID_ARG;
+                        }
+                        pending = 0;
+                        *error_line = reader->line;
+                        if (length == 1 && token[0] == '0') {
+                            break;
+                        }
+
+                        int status;
+                        if (!parse_uint(token, length, &status) ||
+                            (status != STATUS_RESERVED && status != STATUS_SELF_RESERVED) ||
+                            !read_token(reader, token, &length) || !valid_user(token, length)) {
+                            return ENGINE_ERR_INVALID_ARG;
+                        }
+                        char user = token[0];
+
+                        int start = open, end = close;
+                        // 超长的词只保存了前 TEXT_FIELD_LEN - 1 个字符，不可能是合法的内容
+                        pending = read_token(reader, token, &length);
+                        if (pending && length >= TEXT_FIELD_LEN) {
+                            return ENGINE_ERR_INVALID_ARG;
+                        }
+                        char* dash = pending ? (char*)memchr(token, '-', length) : NULL;
+                        if (dash != NULL) {
+                            int first = (int)(dash - token);
+                            if (!parse_minute(token, first, &start) ||
+                                !parse_minute(dash + 1, length - first - 1, &end)) {
+                                return ENGINE_ERR_INVALID_ARG;
+                            }
+                            pending = read_token(reader, token, &length);
+                        }
+
+                        EngineStatus result = add_booking(engine, &floors[floor], row, col, day,
+                            start, end, user, status, now);
+                        if (result != ENGINE_OK) {
+                            return result;
+                        }
+                        (*records)++;
+
+                        if (pending && length == 1 && token[0] == '+') {
+                            pending = 0;
+                            continue;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // 所有座位之后不应再有内容
+    if (pending || read_token(reader, token, &length)) {
+        *error_line = reader->line;
+        return ENGINE_ERR_INVALID_ARG;
+    }
+    return ENGINE_OK;
+}
+
+EngineStatus seat_text_import(const SeatEngine* engine, FILE* in, EngineFloorSnapshot* floors,
+    long* records, long* error_line) {
+    *records = 0;
+    *error_line = 0;
+    for (int floor = 0; floor < ENGINE_FLOORS; floor++) {
+        memset(floors[floor].seats, 0, sizeof(floors[floor].seats));
+    }
+
+    TextReader reader = { in, (char*)malloc(TEXT_BUFFER_SIZE), 0, 0, 0, 1 };
+    if (reader.buffer == NULL) {
+        return ENGINE_ERR_NO_MEMORY;
+    }
+
+    // 跳过 UTF-8 BOM；第一行有逗号的是 CSV
+    if (reader_peek(&reader) == 0xEF && reader.length >= 3 && memcmp(reader.buffer, "\xEF\xBB\xBF", 3) == 0) {
+        reader.pos = 3;
+    }
+    const char* first = reader.buffer + reader.pos;
+    size_t available = reader.length - reader.pos;
+    const char* newline = (const char*)memchr(first, '\n', available);
+    int csv = memchr(first, ',', newline != NULL ? (size_t)(newline - first) : available) != NULL;
+
+    EngineStatus status = csv ? import_csv(engine, &reader, floors, records, error_line)
+                              : import_grid(engine, &reader, floors, records, error_line);
+    if (status == ENGINE_OK && reader.failed < 0) {
+        status = ENGINE_ERR_IO;
+    }
+    if (status == ENGINE_OK) {
+        *error_line = 0;
+    }
+    free(reader.buffer);
+    return status;
+}
@@ -0,0 +1,52 @@
+﻿#ifndef SEAT_TEXT_H
+#define SEAT_TEXT_H
+
+// 座位数据的文本导入导出
+//
+// 两种格式：
+//   CSV：第一行是表头，之后每段预约一行
+//       楼层,行,列,天,开始,结束,用户,状态,预约时间
+//       1,3,1,4,09:00,10:00,W,1,2025-09-26 14:03:11
+//     楼层、行、列、天从 1 开始（与界面一致），状态 1 为管理员代约、2 为用户自约，
+//     预约时间可以为空，导入时记为导入的时间。
+//   整表（grid）：与 library_data.txt 相同的空白分隔格式，按 楼层、行、列、天 的顺序
+//     每个座位天一组：0 表示空闲，"状态 用户" 表示覆盖全部开放时间的一段预约。
+//     只占部分时间的预约在后面加时间段，如 "1 A 09:00-12:00"；同一座位天的多段预约用 + 连接，
+//     如 "1 A 09:00-10:00 + 2 B 14:00-16:00"。整表没有预约时间，导入时记为导入的时间。
+//
+// 导出在大块缓冲区里手工格式化，预约时间的日期和小时部分按小时缓存，不逐行调用 ctime()；
+// 导入按大块读入后逐字节切分，只扫描一遍，先在快照里建好整栋楼，全部检查通过后才交给调用者。
+
+#include <stdio.h>
+
+#include "seat_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    SEAT_TEXT_CSV,
+    SEAT_TEXT_GRID
+} SeatTextFormat;
+
+// 把整栋楼的快照 floors[ENGINE_FLOORS] 写入 out，*records 为写出的预约段数。
+// engine 只用于读取时段配置
+EngineStatus seat_text_export(const SeatEngine* engine, const EngineFloorSnapshot* floors,
+    SeatTextFormat format, FILE* out, long* records);
+
+// 从 in 读入整栋楼（按内容自动识别格式）。调用前 floors[i].rows/cols 填好各层当前的行列数，
+// 座位会被清空后重新填写。出错时返回错误码，*error_line 为出错的行号（从 1 开始）：
+//   ENGINE_ERR_INVALID_ARG  格式错误，或楼层、天、时间超出范围
+//   ENGINE_ERR_INVALID_SEAT 行列超出该楼层的行列数
+//   ENGINE_ERR_OCCUPIED     与同一座位同一天的其他预约重叠
+//   ENGINE_ERR_FULL         同一座位同一天的预约超过 ENGINE_MAX_BOOKINGS 段
+//   ENGINE_ERR_NO_MEMORY、ENGINE_ERR_IO
+EngineStatus seat_text_import(const SeatEngine* engine, FILE* in, EngineFloorSnapshot* floors,
+    long* records, long* error_line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
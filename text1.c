@@ -1,22 +1,42 @@
 ﻿#define _CRT_SECURE_NO_WARNINGS
 #include <stdio.h>
-#include <string.h>
+
+#include "command_table.h"
+
+int running = 1;
+
+void print_dian(CommandArgs* args) {
+    (void)args;
+    printf("2002\n");
+}
+
+void quit(CommandArgs* args) {
+    (void)args;
+    running = 0;
+}
+
+const Command commands[] = {
+    { "Dian", NULL, COMMAND_GUEST, "", NULL, print_dian },
+    { "Quit", NULL, COMMAND_GUEST, "", NULL, quit }
+};
 
 int main(void)
 {
-    char A[100];
-    while (1)
+    CommandTable table;
+    CommandReader input;
+    if (!command_table_build(&table, commands, sizeof(commands) / sizeof(commands[0]))) {
+        return 1;
+    }
+    command_reader_init(&input, stdin);
+
+    while (running)
     {
-        scanf("%s", A);
+        CommandStatus status = command_dispatch(&table, &input, COMMAND_GUEST);
 
-        if (strcmp(A, "Dian") == 0) {
-            printf("2002\n");
-        }
-        else if (strcmp(A, "Quit") == 0) {
-            // 可以选择 return 0; 结束程序
+        if (status == COMMAND_EOF) {
             return 0;
         }
-        else {
+        else if (status != COMMAND_OK) {
             printf("Error\n");
         }
     }
@@ -1,184 +1,57 @@
 ﻿#define _CRT_SECURE_NO_WARNINGS
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 
-#define MAX_ENTRIES 100      // 最大键值对数量
-#define MAX_KEY_LEN 11       // 键最大长度（10字符 + 1个结束符）
-#define MAX_VALUE_LEN 100    // 值最大长度
-#define MAX_LINE_LEN 256     // 每行最大长度
+#include "kv_server.h"
 
-// 键值对结构体
-typedef struct {
-    char key[MAX_KEY_LEN];
-    char value[MAX_VALUE_LEN];
-} KeyValuePair;
+#define INPUT_LINE_LIMIT (1024 * 1024) // 交互输入一行的最大长度（与批量模式相同）
 
-KeyValuePair entries[MAX_ENTRIES]; // 存储键值对的数组
-int entry_count = 0;               // 当前存储的键值对数量
-
-// 去除字符串首尾的空白字符
-void trim_whitespace(char* str) {
-    if (str == NULL || *str == '\0') return;
-
-    char* start = str;
-    char* end = str + strlen(str) - 1;
-
-    while (isspace((unsigned char)*start)) start++;
-
-    while (end > start && isspace((unsigned char)*end)) end--;
-
-    if (start != str) {
-        memmove(str, start, end - start + 1);
-    }
-
-    str[end - start + 1] = '\0';
-}
-
-// 检查键是否有效（不超过10字符，不含空格）
-int is_valid_key(const char* key) {
-    if (key == NULL || *key == '\0') {
-        return 0; // 空键无效
-    }
-
-    if (strlen(key) > 10) {
-        return 0; // 超过10字符
-    }
-
-    // 检查是否包含空格
-    for (int i = 0; key[i] != '\0'; i++) {
-        if (isspace((unsigned char)key[i])) {
-            return 0; // 包含空格
-        }
-    }
-
-    return 1; // 键有效
-}
-
-// 检查键是否已存在
-int key_exists(const char* key) {
-    for (int i = 0; i < entry_count; i++) {
-        if (strcmp(entries[i].key, key) == 0) {
-            return 1; // 键已存在
-        }
-    }
-    return 0; // 键不存在
-}
-
-// 解析数据文件
-int parse_data_file(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
-        printf("错误：无法打开文件 '%s'\n", filename);
-        printf("请确保文件与程序在同一目录下\n");
-        return 0;
-    }
-
-    char line[MAX_LINE_LEN];
-    int line_number = 0;
-    int valid_count = 0;
-    int error_count = 0;
-
-    printf("正在解析文件 '%s'...\n", filename);
-
-    while (fgets(line, sizeof(line), file) != NULL) {
-        line_number++;
-
-        // 去除行首尾的空白字符和换行符
-        trim_whitespace(line);
-
-        // 跳过空行
-        if (line[0] == '\0') {
-            continue;
-        }
-
-        // 查找冒号分隔符
-        char* colon = strchr(line, ':');
-        if (colon == NULL) {
-            printf("警告：第 %d 行格式错误（缺少冒号）：%s\n", line_number, line);
-            error_count++;
-            continue;
-        }
-
-        // 通过冒号分割前后部分
-        *colon = '\0'; 
-        char* key = line;
-        char* value = colon + 1;
-
-        trim_whitespace(key);
-        trim_whitespace(value);
-
-        // 检查键的有效性，是否为空，是否重复
-        if (!is_valid_key(key)) {
-            printf("警告：第 %d 行键无效：%s\n", line_number, key);
-            error_count++;
-            continue;
-        }
-
-        if (value[0] == '\0') {
-            printf("警告：第 %d 行值为空\n", line_number);
-            error_count++;
-            continue;
-        }
-
-        if (key_exists(key)) {
-            printf("警告：第 %d 行键重复：%s\n", line_number, key);
-            error_count++;
-            continue;
-        }
-
-        // 存储有效的键值对
-        if (entry_count < MAX_ENTRIES) {
-            strncpy(entries[entry_count].key, key, MAX_KEY_LEN - 1);
-            entries[entry_count].key[MAX_KEY_LEN - 1] = '\0';
-
-            strncpy(entries[entry_count].value, value, MAX_VALUE_LEN - 1);
-            entries[entry_count].value[MAX_VALUE_LEN - 1] = '\0';
-
-            entry_count++;
-            valid_count++;
+// 读入完整的一行（不含换行符），缓冲区按需增长。文件结束返回 -1；
+// 超过 INPUT_LINE_LIMIT 或内存不足时丢弃这一行的其余部分并返回0，不把截断的内容当作命令
+int read_line(char** buffer, size_t* capacity) {
+    size_t len = 0;
+    while (1) {
+        if (!buffer_reserve(buffer, len, capacity, 4096, INPUT_LINE_LIMIT)) {
+            int c;
+            while ((c = getchar()) != EOF && c != '\n') {}
+            return 0;
         }
-        else {
-            printf("警告：已达到最大键值对数量限制(%d)，跳过后续行\n", MAX_ENTRIES);
-            break;
+        if (fgets(*buffer + len, (int)(*capacity - len), stdin) == NULL) {
+            (*buffer)[len] = '\0';
+            return len > 0 ? 1 : -1;
         }
-    }
-
-    fclose(file);
-
-    printf("解析完成！\n");
-    printf("有效键值对：%d，错误行：%d，总行数：%d\n", valid_count, error_count, line_number);
-    printf("成功加载 %d 个键值对\n\n", entry_count);
-
-    return 1;
-}
-
-// 查找键对应的值
-const char* find_value(const char* key) {
-    for (int i = 0; i < entry_count; i++) {
-        if (strcmp(entries[i].key, key) == 0) {
-            return entries[i].value;
+        len += strlen(*buffer + len);
+        if (len > 0 && (*buffer)[len - 1] == '\n') {
+            return 1;
         }
     }
-    return NULL; 
 }
 
 // 交互式查询循环
 void start_query_loop() {
-    char input[MAX_LINE_LEN];
+    char* input = NULL;
+    size_t input_cap = 0;
 
     printf("=== 键值查询系统 ===\n");
     printf("输入键名查询对应的值，输入 'Quit' 退出程序\n");
+    printf("输入 'Prefix 前缀' 或 'Range 起点 终点' 按键名顺序列出键值对\n");
+    printf("输入 'SET 键 值' 或 'DELETE 键' 修改数据（修改积累到一定量后写回数据文件，其他行不变）\n");
     printf("===================================\n");
 
     while (1) {
         printf("> ");
 
-        if (fgets(input, sizeof(input), stdin) == NULL) {
+        int got = read_line(&input, &input_cap);
+        if (got < 0) {
             break; // 处理Ctrl+Z/Ctrl+D
         }
+        if (got == 0) {
+            printf("Error\n");
+            continue;
+        }
 
         trim_whitespace(input);
 
@@ -190,27 +63,139 @@ void start_query_loop() {
         if (input[0] == '\0') {
             continue;
         }
-
-        const char* value = find_value(input);
-        if (value != NULL) {
-            printf("%s\n", value);
+        check_compaction(0);
+
+        // 查询期间持有表的引用，重新加载不会释放正在使用的表
+        KvTable* table = acquire_table(1);
+        size_t value_len;
+        const char* value;
+        const char* result;
+        if (ordered_query(table, input, strlen(input))) {
+            // 前缀或范围查询，结果已输出
+        }
+        else if ((result = write_command(table, input, input + strlen(input))) != NULL) {
+            // 每条修改单独提交，输出 OK 时已经写入磁盘
+            if (!wal_commit()) result = "Error";
+            printf("%s\n", result);
+        }
+        else if ((value = find_value(table, input, &value_len)) != NULL) {
+            fwrite(value, 1, value_len, stdout);
+            printf("\n");
         }
         else {
             printf("Error\n");
         }
+        release_table(table);
     }
+    free(input);
 }
 
-int main() {
+// 用法：text2 [--file 文件名] [--threads N] [--no-cache] [--watch] [--compact-size 字节数]
+//              [--batch | --serve 地址]
+// --file 使用指定的数据文件（默认 data.txt）；
+// N 为 0 时按文件大小和核心数自动选择；--no-cache 不读写索引缓存；
+// --watch 监视数据文件，修改后在后台重新加载，查询不中断；
+// --compact-size 日志达到此大小后在后台压缩（默认 16 MB）：修改写回数据文件：改写或删除对应的行，
+//                新键追加在末尾，注释、无效行等其他行不变；
+// --batch 批量查询，不显示提示符，适合其他程序通过管道输入大量键；
+// --serve 作为服务器回答网络查询，直到进程被结束，地址为 端口、主机:端口 或 unix:路径。
+// 生成测试数据、基准测试和负载生成器在单独的 text2_bench 程序中（kv_bench.c）
+int main(int argc, char* argv[]) {
     const char* filename = "data.txt";
+    int threads = 0;
+    int use_cache = 1;
+    int watch = 0;
+    int batch = 0;
+    const char* serve_address = NULL;
+    long long compact_size = COMPACT_LOG_SIZE;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        }
+        else if (strcmp(argv[i], "--watch") == 0) {
+            watch = 1;
+        }
+        else if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1;
+        }
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_address = argv[++i];
+        }
+        else if (strcmp(argv[i], "--compact-size") == 0 && i + 1 < argc) {
+            compact_size = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            filename = argv[++i];
+        }
+    }
+    if (compact_size < 1) compact_size = 1;
+
+    log_out = batch ? stderr : stdout;
 
-    if (!parse_data_file(filename)) {
-        printf("按回车键退出...");
-        getchar();
+    if (mtx_init(&table_lock, mtx_plain) != thrd_success) {
+        fprintf(log_out, "错误：无法初始化互斥锁\n");
         return 1;
     }
 
-    start_query_loop();
+    // 监视模式下数据文件读入内存，其他程序就地改写文件时不影响正在使用的表；
+    // Windows 下映射中的文件不能被替换，为了压缩时能写回数据文件也读入内存
+    int copy = watch;
+#ifdef _WIN32
+    copy = 1;
+#endif
+    KvTable* table = use_cache ? load_index_cache(filename) : NULL;
+    if (table == NULL) {
+        table = parse_data_file(filename, threads, copy);
+        if (table == NULL) {
+            fprintf(log_out, "按回车键退出...");
+            getchar();
+            return 1;
+        }
+        if (use_cache && !save_index_cache(filename, table)) {
+            fprintf(log_out, "警告：无法写入索引缓存\n");
+        }
+    }
+    swap_table(table);
+    wal_open(filename, threads, copy, use_cache, compact_size);
+
+    Watcher watcher;
+    memset(&watcher, 0, sizeof(watcher));
+    watcher.filename = filename;
+    watcher.threads = threads;
+    watcher.use_cache = use_cache;
+    source_stat(filename, &watcher.size, &watcher.mtime);
+
+    thrd_t watch_handle;
+    int watching = watch && thrd_create(&watch_handle, watch_thread, &watcher) == thrd_success;
+    if (watching) {
+        fprintf(log_out, "监视模式：'%s' 修改后自动重新加载\n", filename);
+    }
+    else if (watch) {
+        fprintf(log_out, "警告：无法启动监视线程\n");
+    }
 
+    if (serve_address != NULL) {
+        start_server(serve_address);
+    }
+    else if (batch) {
+        start_batch_loop();
+    }
+    else {
+        start_query_loop();
+    }
+
+    close_store();
+    if (watching) {
+        mtx_lock(&table_lock);
+        watcher.stop = 1;
+        mtx_unlock(&table_lock);
+        thrd_join(watch_handle, NULL);
+    }
+    swap_table(NULL);
+    mtx_destroy(&table_lock);
     return 0;
 }
\ No newline at end of file
@@ -1,23 +1,31 @@
 ﻿#define _CRT_SECURE_NO_WARNINGS
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
-
-#define FLOORS 5
-#define ROWS 4
-#define COLS 4
-#define DAYS 7
-#define MAX_USERS 27 
+#include <threads.h>
+#include <stdint.h>
+#include <stdarg.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "seat_engine.h"
+#include "seat_jobs.h"
+#include "seat_text.h"
+#include "command_table.h"
+
+#define FLOORS ENGINE_FLOORS
+#define ROWS ENGINE_ROWS
+#define COLS ENGINE_COLS
+#define DAYS ENGINE_DAYS
+#define MAX_USERS 27
 #define FILENAME "library_data.dat"
-
-// 用户类型
-typedef enum {
-    USER_NORMAL,
-    USER_ADMIN
-} UserType;
+#define FLOOR_FILENAME "library_data_f%d.dat" // 分片模式下每层独立的数据文件
+#define BOOKINGS_PER_FLOOR ENGINE_BOOKINGS_PER_FLOOR
 
 // 用户结构
 typedef struct {
@@ -25,80 +33,40 @@ typedef struct {
     UserType type;
 } User;
 
-// 座位状态
-typedef enum {
-    STATUS_EMPTY = 0,
-    STATUS_RESERVED = 1,
-    STATUS_SELF_RESERVED = 2
-} SeatStatus;
-
-// 座位结构
-typedef struct {
-    SeatStatus status;
-    char reserved_by; // 预约的用户字母
-    time_t reserve_time; // 预约时间
-} Seat;
-
-// 图书馆系统
+// 图书馆系统：座位数据由预约引擎保存，这里只有界面的登录状态
 typedef struct {
-    Seat seats[FLOORS][ROWS][COLS][DAYS]; // 5层×4行×4列×7天
     User current_user;
     int is_logged_in;
-    int floor_rows[FLOORS];    // 每层实际行数
-    int floor_cols[FLOORS];    // 每层实际列数
 } LibrarySystem;
 
 // 全局系统实例
 LibrarySystem library;
 
+// 命令表和输入
+CommandTable command_table;
+CommandReader input;
+
 // 保存数据到文件
 void save_data() {
-    FILE* file = fopen(FILENAME, "wb");
-    if (file == NULL) {
+    if (engine_save(engine) != ENGINE_OK) {
         printf("无法保存数据到文件！\n");
         return;
     }
-
-    // 保存座位数据和楼层配置
-    fwrite(library.seats, sizeof(library.seats), 1, file);
-    fwrite(library.floor_rows, sizeof(library.floor_rows), 1, file);
-    fwrite(library.floor_cols, sizeof(library.floor_cols), 1, file);
-
-    fclose(file);
     printf("数据已保存！\n");
 }
 
 // 从文件加载数据
 void load_data() {
-    FILE* file = fopen(FILENAME, "rb");
-    if (file == NULL) {
+    EngineStatus status = engine_load(engine);
+    if (status == ENGINE_NO_DATA) {
         printf("无保存数据，使用默认数据\n");
-        // 初始化所有座位为空
-        memset(library.seats, 0, sizeof(library.seats));
-        // 初始化每层行列数为默认值
-        for (int i = 0; i < FLOORS; i++) {
-            library.floor_rows[i] = ROWS;
-            library.floor_cols[i] = COLS;
-        }
         return;
     }
-
-    fread(library.seats, sizeof(library.seats), 1, file);
-    fread(library.floor_rows, sizeof(library.floor_rows), 1, file);
-    fread(library.floor_cols, sizeof(library.floor_cols), 1, file);
-    fclose(file);
-    printf("数据已加载！\n");
-}
-
-// 清空所有数据
-void clear_data() {
-    memset(library.seats, 0, sizeof(library.seats));
-    for (int i = 0; i < FLOORS; i++) {
-        library.floor_rows[i] = ROWS;
-        library.floor_cols[i] = COLS;
+    if (status != ENGINE_OK) {
+        printf("数据文件已损坏，使用默认数据\n");
+        return;
     }
-    save_data();
-    printf("所有数据已清空！\n");
+    printf("数据已加载！\n");
 }
 
 // 获取星期几的名称
@@ -107,17 +75,103 @@ const char* get_day_name(int day) {
     return days[day];
 }
 
-// 显示座位状态
-void display_seats(int floor, int day) {
+const char* audit_event_name(int event) {
+    switch (event) {
+    case AUDIT_RESERVE: return "预约";
+    case AUDIT_CANCEL: return "取消";
+    case AUDIT_CANCEL_DAY: return "按天清除";
+    case AUDIT_CANCEL_FLOOR: return "按层清除";
+    case AUDIT_ADJUST: return "调整楼层";
+    case AUDIT_CLEAR: return "清空数据";
+    }
+    return "未知";
+}
+
+// 打印一条审计记录
+void print_audit_record(const AuditRecord* record, void* context) {
+    char when[32];
+    time_t event_time = (time_t)record->event_time;
+    (void)context;
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&event_time));
+    printf("%s %s 第%d层 %s (%d,%d)", when, audit_event_name(record->event), record->floor + 1,
+        get_day_name(record->day), record->row + 1, record->col + 1);
+    if (record->end > record->start) {
+        printf(" %02d:%02d-%02d:%02d", record->start / 60, record->start % 60, record->end / 60, record->end % 60);
+    }
+    printf(" - 用户: %c, 操作者: %c\n", record->user ? record->user : '-', record->actor);
+}
+
+// 打印任务的保存结果，与单线程模式下 save_data() 的提示一致
+void report_saved(const Job* job) {
+    if (job->saved == 1) {
+        printf("数据已保存！\n");
+    }
+    else if (job->saved == 0) {
+        printf("无法保存数据到文件！\n");
+    }
+}
+
+// 清空所有数据
+void clear_data(CommandArgs* args) {
+    (void)args;
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_CLEAR;
+    run_job(&job);
+
+    report_saved(&job);
+    printf("所有数据已清空！\n");
+}
+
+// 把输入的起止时间（分钟）换成时段，不在开放时间内或不是时段边界时返回 0
+int to_slots(int start_minute, int end_minute, int* start, int* end) {
+    *start = engine_slot_boundary(engine, start_minute);
+    *end = engine_slot_boundary(engine, end_minute);
+    return *start >= 0 && *end > *start;
+}
+
+void print_slot_error() {
+    int open = engine_slot_minute(engine, 0);
+    int close = engine_slot_minute(engine, engine_slot_count(engine));
+    printf("无效的时间段！开放时间 %02d:%02d-%02d:%02d，每 %d 分钟一个时段\n",
+        open / 60, open % 60, close / 60, close % 60, engine_slot_minute(engine, 1) - open);
+}
+
+// 座位在时段 [start, end) 内的第一段预约，时段位图没有重叠时直接返回 NULL
+const Booking* booking_in_window(const Seat* seat, int start, int end) {
+    if (!(seat->busy & engine_slot_mask(start, end))) {
+        return NULL;
+    }
+    int from = engine_slot_minute(engine, start), to = engine_slot_minute(engine, end);
+    for (int i = 0; i < seat->count; i++) {
+        if (seat->bookings[i].start < to && seat->bookings[i].end > from) {
+            return &seat->bookings[i];
+        }
+    }
+    return NULL;
+}
+
+// 显示座位在时段 [start, end) 内的状态
+void display_seats(int floor, int day, int start, int end) {
     if (floor < 0 || floor >= FLOORS) {
         printf("无效的楼层！\n");
         return;
     }
 
-    int rows = library.floor_rows[floor];
-    int cols = library.floor_cols[floor];
+    EngineFloorSnapshot snapshot;
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_SNAPSHOT;
+    job.floor = floor;
+    job.snapshot = &snapshot;
+    run_job(&job);
 
-    printf("\n=== 第%d层 (%d行×%d列) - %s ===\n", floor + 1, rows, cols, get_day_name(day));
+    int rows = snapshot.rows;
+    int cols = snapshot.cols;
+
+    int from = engine_slot_minute(engine, start), to = engine_slot_minute(engine, end);
+    printf("\n=== 第%d层 (%d行×%d列) - %s %02d:%02d-%02d:%02d ===\n", floor + 1, rows, cols,
+        get_day_name(day), from / 60, from % 60, to / 60, to % 60);
     printf("    ");
     for (int col = 0; col < cols; col++) {
         printf("%d   ", col + 1);
@@ -127,23 +181,23 @@ void display_seats(int floor, int day) {
     for (int row = 0; row < rows; row++) {
         printf("%d | ", row + 1);
         for (int col = 0; col < cols; col++) {
-            Seat seat = library.seats[floor][row][col][day];
+            const Booking* booking = booking_in_window(&snapshot.seats[row][col][day], start, end);
 
             if (library.current_user.type == USER_ADMIN) {
                 // 管理员视图：显示具体用户
-                if (seat.status == STATUS_EMPTY) {
+                if (booking == NULL) {
                     printf("0   ");
                 }
                 else {
-                    printf("%c   ", seat.reserved_by);
+                    printf("%c   ", booking->reserved_by);
                 }
             }
+            else if (booking == NULL) {
+                printf("0   ");
+            }
             else {
                 // 普通用户视图
-                switch (seat.status) {
-                case STATUS_EMPTY:
-                    printf("0   ");
-                    break;
+                switch (booking->status) {
                 case STATUS_RESERVED:
                     printf("1   ");
                     break;
@@ -158,12 +212,8 @@ void display_seats(int floor, int day) {
 }
 
 // 登录功能
-void login() {
-    char username[20];
-    printf("请输入用户名: ");
-    scanf("%s", username);
-
-    while (getchar() != '\n');
+void login(CommandArgs* args) {
+    const char* username = args->text[0];
 
     if (strcmp(username, "Admin") == 0) {
         strcpy(library.current_user.name, "Admin");
@@ -184,7 +234,8 @@ void login() {
 }
 
 // 退出登录
-void logout() {
+void logout(CommandArgs* args) {
+    (void)args;
     if (library.is_logged_in) {
         printf("用户 %s 已退出登录\n", library.current_user.name);
         library.is_logged_in = 0;
@@ -195,20 +246,16 @@ void logout() {
     }
 }
 
-// 预约座位
-void reserve_seat() {
-    if (!library.is_logged_in) {
-        printf("请先登录！\n");
-        return;
-    }
-
-    int floor, row, col, day;
+// 预约座位：管理员先输入预约的用户，参数由这里读取
+void reserve_seat(CommandArgs* args) {
     char user_char = '\0';
 
     if (library.current_user.type == USER_ADMIN) {
-        printf("请输入要预约的用户 (A-Z): ");
-        scanf(" %c", &user_char);
-        user_char = toupper(user_char);
+        if (!command_read_args(args->reader, "c", "请输入要预约的用户 (A-Z): ", args)) {
+            printf("无效的用户！\n");
+            return;
+        }
+        user_char = toupper(args->text[0][0]);
 
         if (user_char < 'A' || user_char > 'Z') {
             printf("无效的用户！\n");
@@ -219,116 +266,134 @@ void reserve_seat() {
         user_char = toupper(library.current_user.name[0]);
     }
 
-    printf("请输入要预约的座位信息（层 行 列 天）: ");
-    scanf("%d %d %d %d", &floor, &row, &col, &day);
+    int seat = args->count;
+    if (!command_read_args(args->reader, "iiiitt", "请输入要预约的座位信息（层 行 列 天 开始时间 结束时间）: ", args)) {
+        printf("无效的输入！\n");
+        return;
+    }
 
     // 转换为0-based索引并验证 
-    floor--; row--; col--; day--;
+    int floor = args->number[seat] - 1, row = args->number[seat + 1] - 1;
+    int col = args->number[seat + 2] - 1, day = args->number[seat + 3] - 1;
+    int start, end;
 
     if (floor < 0 || floor >= FLOORS || day < 0 || day >= DAYS) {
         printf("无效的输入！\n");
         return;
     }
-
-    // 检查行列是否在有效范围内
-    if (row < 0 || row >= library.floor_rows[floor] ||
-        col < 0 || col >= library.floor_cols[floor]) {
-        printf("无效的座位！该楼层只有 %d 行 %d 列\n",
-            library.floor_rows[floor], library.floor_cols[floor]);
+    if (!to_slots(args->number[seat + 4], args->number[seat + 5], &start, &end)) {
+        print_slot_error();
         return;
     }
 
-    Seat* seat = &library.seats[floor][row][col][day];
-
-    if (seat->status != STATUS_EMPTY) {
-        printf("该座位已被预约！\n");
-        return;
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_RESERVE;
+    job.floor = floor;
+    job.row = row;
+    job.col = col;
+    job.day = day;
+    job.start = start;
+    job.end = end;
+    job.user_char = user_char;
+    job.user_type = library.current_user.type;
+    run_job(&job);
+
+    switch (job.result) {
+    case ENGINE_ERR_INVALID_SEAT:
+        // 检查行列是否在有效范围内
+        printf("无效的座位！该楼层只有 %d 行 %d 列\n",
+            floor_rows(floor), floor_cols(floor));
+        break;
+    case ENGINE_ERR_OCCUPIED:
+        printf("该时间段已被预约！\n");
+        break;
+    case ENGINE_ERR_FULL:
+        printf("该座位当天的预约已满！\n");
+        break;
+    case ENGINE_OK:
+        report_saved(&job);
+        printf("预约成功！\n");
+        break;
+    default:
+        printf("预约失败！\n");
+        break;
     }
-
-    // 设置预约信息
-    seat->status = (library.current_user.type == USER_ADMIN) ? STATUS_RESERVED : STATUS_SELF_RESERVED;
-    seat->reserved_by = user_char;
-    seat->reserve_time = time(NULL);
-
-    save_data();
-    printf("预约成功！\n");
 }
 
 // 取消预约
-void cancel_reservation() {
-    if (!library.is_logged_in) {
-        printf("请先登录！\n");
-        return;
-    }
-
-    int floor, row, col, day;
-    printf("请输入要取消预约的座位信息（层 行 列 天）: ");
-    scanf("%d %d %d %d", &floor, &row, &col, &day);
-
-    floor--; row--; col--; day--;
+void cancel_reservation(CommandArgs* args) {
+    int floor = args->number[0] - 1, row = args->number[1] - 1;
+    int col = args->number[2] - 1, day = args->number[3] - 1;
+    int slot = engine_slot_boundary(engine, args->number[4]);
 
     if (floor < 0 || floor >= FLOORS || day < 0 || day >= DAYS) {
         printf("无效的输入！\n");
         return;
     }
-
-    // 检查行列是否在有效范围内
-    if (row < 0 || row >= library.floor_rows[floor] ||
-        col < 0 || col >= library.floor_cols[floor]) {
-        printf("无效的座位！该楼层只有 %d 行 %d 列\n",
-            library.floor_rows[floor], library.floor_cols[floor]);
-        return;
-    }
-
-    Seat* seat = &library.seats[floor][row][col][day];
-
-    if (seat->status == STATUS_EMPTY) {
-        printf("该座位未被预约！\n");
+    if (slot < 0 || slot >= engine_slot_count(engine)) {
+        print_slot_error();
         return;
     }
 
-    // 检查权限：普通用户只能取消自己的预约
-    if (library.current_user.type == USER_NORMAL &&
-        seat->reserved_by != toupper(library.current_user.name[0])) {
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_CANCEL;
+    job.floor = floor;
+    job.row = row;
+    job.col = col;
+    job.day = day;
+    job.start = slot;
+    job.user_type = library.current_user.type;
+    job.user_char = toupper(library.current_user.name[0]);
+    run_job(&job);
+
+    switch (job.result) {
+    case ENGINE_ERR_INVALID_SEAT:
+        printf("无效的座位！该楼层只有 %d 行 %d 列\n",
+            floor_rows(floor), floor_cols(floor));
+        break;
+    case ENGINE_ERR_NOT_RESERVED:
+        printf("该时间段未被预约！\n");
+        break;
+    case ENGINE_ERR_NOT_OWNER:
+        // 检查权限：普通用户只能取消自己的预约
         printf("您只能取消自己的预约！\n");
-        return;
+        break;
+    case ENGINE_OK:
+        report_saved(&job);
+        printf("取消预约成功！\n");
+        break;
+    default:
+        printf("取消预约失败！\n");
+        break;
     }
-
-    // 取消预约
-    seat->status = STATUS_EMPTY;
-    seat->reserved_by = '\0';
-    seat->reserve_time = 0;
-
-    save_data();
-    printf("取消预约成功！\n");
 }
 
-// 查看所有预约
-void view_all_reservations() {
-    if (!library.is_logged_in || library.current_user.type != USER_ADMIN) {
-        printf("需要管理员权限！\n");
-        return;
-    }
+// 查看所有预约：各分片分别收集自己楼层的记录，再按楼层顺序合并输出
+void view_all_reservations(CommandArgs* args) {
+    (void)args;
+    static EngineReservation records[FLOORS][BOOKINGS_PER_FLOOR];
+    int record_counts[FLOORS] = { 0 };
+
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_COLLECT;
+    job.records = records;
+    job.record_counts = record_counts;
+    run_job(&job);
 
     printf("\n=== 所有预约信息 ===\n");
     int count = 0;
 
     for (int floor = 0; floor < FLOORS; floor++) {
-        int rows = library.floor_rows[floor];
-        int cols = library.floor_cols[floor];
-
-        for (int day = 0; day < DAYS; day++) {
-            for (int row = 0; row < rows; row++) {
-                for (int col = 0; col < cols; col++) {
-                    Seat seat = library.seats[floor][row][col][day];
-                    if (seat.status != STATUS_EMPTY) {
-                        count++;
-                        printf("第%d层 %s (%d,%d) - 用户: %c, 时间: %s",
-                            floor + 1, get_day_name(day), row + 1, col + 1,
-                            seat.reserved_by, ctime(&seat.reserve_time));
-                    }
-                }
-            }
+        for (int i = 0; i < record_counts[floor]; i++) {
+            EngineReservation* record = &records[floor][i];
+            count++;
+            printf("第%d层 %s (%d,%d) %02d:%02d-%02d:%02d - 用户: %c, 时间: %s",
+                floor + 1, get_day_name(record->day), record->row + 1, record->col + 1,
+                record->start / 60, record->start % 60, record->end / 60, record->end % 60,
+                record->reserved_by, ctime(&record->reserve_time));
         }
     }
 
@@ -338,148 +403,279 @@ void view_all_reservations() {
 }
 
 // 管理员功能：取消某天所有预约
-void cancel_all_day_reservations() {
-    if (!library.is_logged_in || library.current_user.type != USER_ADMIN) {
-        printf("需要管理员权限！\n");
-        return;
-    }
-
-    int day;
-    printf("请输入要取消预约的日期 (1-7): ");
-    scanf("%d", &day);
-    day--;
+void cancel_all_day_reservations(CommandArgs* args) {
+    int day = args->number[0] - 1;
 
     if (day < 0 || day >= DAYS) {
         printf("无效的日期！\n");
         return;
     }
 
-    int count = 0;
-    for (int floor = 0; floor < FLOORS; floor++) {
-        int rows = library.floor_rows[floor];
-        int cols = library.floor_cols[floor];
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_CANCEL_DAY;
+    job.day = day;
+    run_job(&job);
 
-        for (int row = 0; row < rows; row++) {
-            for (int col = 0; col < cols; col++) {
-                Seat* seat = &library.seats[floor][row][col][day];
-                if (seat->status != STATUS_EMPTY) {
-                    seat->status = STATUS_EMPTY;
-                    seat->reserved_by = '\0';
-                    seat->reserve_time = 0;
-                    count++;
-                }
-            }
-        }
-    }
-
-    save_data();
-    printf("已取消%d个预约！\n", count);
+    report_saved(&job);
+    printf("已取消%d个预约！\n", job.count);
 }
 
 // 管理员功能：取消某层所有预约
-void cancel_all_floor_reservations() {
-    if (!library.is_logged_in || library.current_user.type != USER_ADMIN) {
-        printf("需要管理员权限！\n");
-        return;
-    }
-
-    int floor;
-    printf("请输入要取消预约的楼层 (1-5): ");
-    scanf("%d", &floor);
-    floor--;
+void cancel_all_floor_reservations(CommandArgs* args) {
+    int floor = args->number[0] - 1;
 
     if (floor < 0 || floor >= FLOORS) {
         printf("无效的楼层！\n");
         return;
     }
 
-    int count = 0;
-    int rows = library.floor_rows[floor];
-    int cols = library.floor_cols[floor];
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_CANCEL_FLOOR;
+    job.floor = floor;
+    run_job(&job);
 
-    for (int day = 0; day < DAYS; day++) {
-        for (int row = 0; row < rows; row++) {
-            for (int col = 0; col < cols; col++) {
-                Seat* seat = &library.seats[floor][row][col][day];
-                if (seat->status != STATUS_EMPTY) {
-                    seat->status = STATUS_EMPTY;
-                    seat->reserved_by = '\0';
-                    seat->reserve_time = 0;
-                    count++;
-                }
-            }
-        }
-    }
-
-    save_data();
-    printf("已取消%d个预约！\n", count);
+    report_saved(&job);
+    printf("已取消%d个预约！\n", job.count);
 }
 
 // 管理员功能：调整楼层座位配置
-void adjust_floor_seats() {
-    if (!library.is_logged_in || library.current_user.type != USER_ADMIN) {
-        printf("需要管理员权限！\n");
-        return;
-    }
-
-    int floor, new_rows, new_cols;
-    printf("请输入要调整的楼层 (1-5): ");
-    scanf("%d", &floor);
-    floor--;
+void adjust_floor_seats(CommandArgs* args) {
+    int floor = args->number[0] - 1;
 
     if (floor < 0 || floor >= FLOORS) {
         printf("无效的楼层！\n");
         return;
     }
 
-    printf("当前楼层有 %d 行 %d 列\n", library.floor_rows[floor], library.floor_cols[floor]);
+    printf("当前楼层有 %d 行 %d 列\n", floor_rows(floor), floor_cols(floor));
     printf("请输入新的行数和列数 (最大 %d 行 %d 列): ", ROWS, COLS);
-    scanf("%d %d", &new_rows, &new_cols);
+    if (!command_read_args(args->reader, "ii", NULL, args)) {
+        printf("无效的行列数！\n");
+        return;
+    }
 
+    int new_rows = args->number[1], new_cols = args->number[2];
     if (new_rows <= 0 || new_rows > ROWS || new_cols <= 0 || new_cols > COLS) {
         printf("无效的行列数！\n");
         return;
     }
 
-    // 如果减少行列数，需要取消超出范围的座位的预约
-    int canceled = 0;
-    if (new_rows < library.floor_rows[floor] || new_cols < library.floor_cols[floor]) {
-        for (int day = 0; day < DAYS; day++) {
-            for (int row = new_rows; row < library.floor_rows[floor]; row++) {
-                for (int col = 0; col < library.floor_cols[floor]; col++) {
-                    Seat* seat = &library.seats[floor][row][col][day];
-                    if (seat->status != STATUS_EMPTY) {
-                        seat->status = STATUS_EMPTY;
-                        seat->reserved_by = '\0';
-                        seat->reserve_time = 0;
-                        canceled++;
-                    }
-                }
-            }
-            for (int col = new_cols; col < library.floor_cols[floor]; col++) {
-                for (int row = 0; row < new_rows; row++) {
-                    Seat* seat = &library.seats[floor][row][col][day];
-                    if (seat->status != STATUS_EMPTY) {
-                        seat->status = STATUS_EMPTY;
-                        seat->reserved_by = '\0';
-                        seat->reserve_time = 0;
-                        canceled++;
-                    }
-                }
-            }
-        }
+    // 减少行列数时会取消超出范围的座位的预约
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_ADJUST_FLOOR;
+    job.floor = floor;
+    job.new_rows = new_rows;
+    job.new_cols = new_cols;
+    run_job(&job);
+
+    report_saved(&job);
+    printf("楼层座位配置已更新！");
+    if (job.count > 0) {
+        printf("取消了%d个超出范围的预约。", job.count);
     }
+    printf("\n");
+}
 
-    // 更新楼层配置
-    library.floor_rows[floor] = new_rows;
-    library.floor_cols[floor] = new_cols;
+// 管理员功能：查询预约历史
+void query_audit_history(CommandArgs* args) {
+    if (!command_read_args(args->reader, "dd", "请输入起止日期 (YYYY-MM-DD YYYY-MM-DD): ", args)) {
+        printf("无效的日期！\n");
+        return;
+    }
 
+    char user = toupper(args->text[0][0]);
+    int from = args->number[1], to = args->number[2];
+    if (user != '*' && (user < 'A' || user > 'Z')) {
+        printf("无效的用户！\n");
+        return;
+    }
+
+    struct tm from_tm = { 0 }, to_tm = { 0 };
+    from_tm.tm_year = from / 10000 - 1900;
+    from_tm.tm_mon = from / 100 % 100 - 1;
+    from_tm.tm_mday = from % 100;
+    from_tm.tm_isdst = -1;
+    to_tm.tm_year = to / 10000 - 1900;
+    to_tm.tm_mon = to / 100 % 100 - 1;
+    to_tm.tm_mday = to % 100 + 1; // 包含结束日当天
+    to_tm.tm_isdst = -1;
+
+    int scanned, total;
+    printf("\n=== 预约历史 ===\n");
+    int matched = engine_audit_query(engine, user == '*' ? '\0' : user, mktime(&from_tm), mktime(&to_tm) - 1,
+        print_audit_record, NULL, &scanned, &total);
+    printf("共 %d 条记录（读取 %d/%d 个日志段）\n", matched, scanned, total);
+}
+
+// 显示某层某天某个时间段的座位状态
+void view_seats(CommandArgs* args) {
+    int floor = args->number[0], day = args->number[1];
+    int start, end;
+    if (floor < 1 || floor > FLOORS || day < 1 || day > DAYS) {
+        printf("无效的输入！\n");
+    }
+    else if (!to_slots(args->number[2], args->number[3], &start, &end)) {
+        print_slot_error();
+    }
+    else {
+        display_seats(floor - 1, day - 1, start, end);
+    }
+}
+
+// ===== 导入导出 =====
+// 导出：各层取快照后写成 CSV 或整表（格式见 seat_text.h）。
+// 导入：在快照里建好整栋楼并检查完所有记录后，作为一个分发类任务替换各层，
+// 任何一行有错都不修改数据；导入不记审计日志
+
+// 导出到文件，成功返回 1
+int export_file(const char* filename, SeatTextFormat format) {
+    static EngineFloorSnapshot floors[FLOORS];
+    for (int floor = 0; floor < FLOORS; floor++) {
+        Job job;
+        memset(&job, 0, sizeof(job));
+        job.type = JOB_SNAPSHOT;
+        job.floor = floor;
+        job.snapshot = &floors[floor];
+        run_job(&job);
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        printf("无法创建文件 %s！\n", filename);
+        return 0;
+    }
+    double begin = now_us();
+    long records = 0;
+    EngineStatus status = seat_text_export(engine, floors, format, file, &records);
+    if (fclose(file) != 0 && status == ENGINE_OK) {
+        status = ENGINE_ERR_IO;
+    }
+    if (status != ENGINE_OK) {
+        printf("无法写入文件 %s！\n", filename);
+        return 0;
+    }
+    printf("已导出 %ld 段预约到 %s（%s，%.3f 秒）\n", records, filename,
+        format == SEAT_TEXT_CSV ? "CSV" : "整表", (now_us() - begin) / 1e6);
+    return 1;
+}
+
+const char* import_error_message(EngineStatus status) {
+    switch (status) {
+    case ENGINE_ERR_INVALID_SEAT: return "座位超出该楼层的行列数";
+    case ENGINE_ERR_OCCUPIED: return "与同一座位的其他预约重叠";
+    case ENGINE_ERR_FULL: return "该座位当天的预约段数已达上限";
+    case ENGINE_ERR_IO: return "读取失败";
+    case ENGINE_ERR_NO_MEMORY: return "内存不足";
+    case ENGINE_ERR_CHANGED: return "导入期间有楼层的行列数被修改";
+    default: return "格式错误或超出范围";
+    }
+}
+
+// 从文件导入，替换所有楼层的预约（行列数不变），成功返回 1
+int import_file(const char* filename) {
+    static EngineFloorSnapshot floors[FLOORS];
+    for (int floor = 0; floor < FLOORS; floor++) {
+        floors[floor].rows = floor_rows(floor);
+        floors[floor].cols = floor_cols(floor);
+    }
+
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        printf("无法打开文件 %s！\n", filename);
+        return 0;
+    }
+    double begin = now_us();
+    long records, line;
+    EngineStatus status = seat_text_import(engine, file, floors, &records, &line);
+    fclose(file);
+    if (status != ENGINE_OK) {
+        printf("导入失败：%s 第 %ld 行%s，数据未修改！\n", filename, line, import_error_message(status));
+        return 0;
+    }
+
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.type = JOB_RESTORE;
+    job.snapshot = floors;
+    run_job(&job);
+    if (job.result != ENGINE_OK) {
+        // 导入是整栋楼一起进行的，失败时所有楼层都没有修改
+        printf("导入失败：%s，数据未修改！\n", import_error_message(job.result));
+        return 0;
+    }
+    report_saved(&job);
+    printf("已导入 %ld 段预约（%.3f 秒）\n", records, (now_us() - begin) / 1e6);
+    return 1;
+}
+
+// 格式名 csv 或 grid
+int parse_text_format(const char* name, SeatTextFormat* format) {
+    if (strcmp(name, "csv") == 0) {
+        *format = SEAT_TEXT_CSV;
+    }
+    else if (strcmp(name, "grid") == 0) {
+        *format = SEAT_TEXT_GRID;
+    }
+    else {
+        return 0;
+    }
+    return 1;
+}
+
+// 管理员功能：导出数据
+void export_data(CommandArgs* args) {
+    SeatTextFormat format;
+    if (!parse_text_format(args->text[0], &format)) {
+        printf("无效的格式！\n");
+        return;
+    }
+    export_file(args->text[1], format);
+}
+
+// 管理员功能：导入数据
+void import_data(CommandArgs* args) {
+    import_file(args->text[0]);
+}
+
+// 退出程序
+void quit_program(CommandArgs* args) {
+    (void)args;
+    stop_shards();
     save_data();
-    printf("楼层座位配置已更新！");
-    if (canceled > 0) {
-        printf("取消了%d个超出范围的预约。", canceled);
+    trace_finish();
+    engine_destroy(engine);
+    printf("再见！\n");
+    exit(0);
+}
+
+// 命令表：命令词、菜单说明、权限、参数格式、提示和处理函数，菜单按此顺序显示。
+// 预约、调整楼层和查询历史的后续参数依赖前面的输入，由处理函数继续读取
+const Command commands[] = {
+    { "1", "显示座位状态", COMMAND_GUEST, "iitt", "请输入要查看的层数、天数和时间段（如 1 1 9:00 12:00）: ", view_seats },
+    { "2", "预约座位", COMMAND_USER, "", NULL, reserve_seat },
+    { "3", "取消预约", COMMAND_USER, "iiiit", "请输入要取消预约的座位信息（层 行 列 天 预约内的时间）: ", cancel_reservation },
+    { "4", "查看所有预约", COMMAND_ADMIN, "", NULL, view_all_reservations },
+    { "5", "清空所有数据", COMMAND_ADMIN, "", NULL, clear_data },
+    { "6", "取消某天所有预约", COMMAND_ADMIN, "i", "请输入要取消预约的日期 (1-7): ", cancel_all_day_reservations },
+    { "7", "取消某层所有预约", COMMAND_ADMIN, "i", "请输入要取消预约的楼层 (1-5): ", cancel_all_floor_reservations },
+    { "8", "调整楼层座位配置", COMMAND_ADMIN, "i", "请输入要调整的楼层 (1-5): ", adjust_floor_seats },
+    { "9", "查询预约历史", COMMAND_ADMIN, "c", "请输入用户 (A-Z，* 表示全部): ", query_audit_history },
+    { "10", "导出数据", COMMAND_ADMIN, "ww", "请输入格式 (csv/grid) 和文件名: ", export_data },
+    { "11", "导入数据", COMMAND_ADMIN, "w", "请输入文件名 (CSV 或整表): ", import_data },
+    { "Login", "登录", COMMAND_GUEST, "w", "请输入用户名: ", login },
+    { "Exit", "退出登录", COMMAND_GUEST, "", NULL, logout },
+    { "Quit", "退出程序", COMMAND_GUEST, "", NULL, quit_program }
+};
+
+// 当前用户的权限
+CommandLevel current_level() {
+    if (!library.is_logged_in) {
+        return COMMAND_GUEST;
     }
-    printf("\n");
+    return library.current_user.type == USER_ADMIN ? COMMAND_ADMIN : COMMAND_USER;
 }
 
 // 显示主菜单
@@ -490,102 +686,326 @@ void show_menu() {
             library.current_user.name,
             library.current_user.type == USER_ADMIN ? "管理员" : "普通用户");
     }
-    printf("1. 显示座位状态\n");
-    printf("2. 预约座位\n");
-    printf("3. 取消预约\n");
-    if (library.is_logged_in && library.current_user.type == USER_ADMIN) {
-        printf("4. 查看所有预约\n");
-        printf("5. 清空所有数据\n");
-        printf("6. 取消某天所有预约\n");
-        printf("7. 取消某层所有预约\n");
-        printf("8. 调整楼层座位配置\n");
-    }
-    printf("Login - 登录\n");
-    printf("Exit - 退出登录\n");
-    printf("Quit - 退出程序\n");
+    command_print_menu(&command_table, current_level());
     printf("请选择操作: ");
 }
 
 // 处理用户输入
 void process_command() {
-    char command[20];
-    scanf("%s", command);
+    switch (command_dispatch(&command_table, &input, current_level())) {
+    case COMMAND_EOF:
+        // 输入结束（如脚本执行完）时按 Quit 处理
+        quit_program(NULL);
+        break;
+    case COMMAND_NOT_LOGGED_IN:
+        printf("请先登录！\n");
+        break;
+    case COMMAND_DENIED:
+        printf("无效的选择或权限不足！\n");
+        break;
+    case COMMAND_UNKNOWN:
+        if (isdigit((unsigned char)input.word[0])) {
+            printf("无效的选择或权限不足！\n");
+        }
+        else {
+            printf("无效的命令！\n");
+        }
+        break;
+    case COMMAND_BAD_ARGS:
+        printf("无效的输入！\n");
+        break;
+    default:
+        break;
+    }
+
+    // 清空输入缓冲区
+    command_skip_line(&input);
+}
 
-    if (strcmp(command, "Login") == 0) {
-        login();
+// 初始化系统
+void init_system() {
+    memset(&library, 0, sizeof(library));
+    library.is_logged_in = 0;
+    if (!command_table_build(&command_table, commands, sizeof(commands) / sizeof(commands[0]))) {
+        printf("命令表无效！\n");
+        exit(1);
     }
-    else if (strcmp(command, "Exit") == 0) {
-        logout();
+    command_reader_init(&input, stdin);
+
+    engine = engine_create(&engine_config);
+    if (engine == NULL) {
+        printf("无法初始化预约系统！\n");
+        exit(1);
     }
-    else if (strcmp(command, "Quit") == 0) {
-        save_data();
-        printf("再见！\n");
-        exit(0);
+    if (engine_config.shared_name != NULL) {
+        printf("共享模式：座位表位于共享内存段 %s\n", engine_config.shared_name);
     }
-    else if (isdigit(command[0])) {
-        int choice = atoi(command);
 
-        if (choice == 1) {
-            int floor, day;
-            printf("请输入要查看的层数和天数（1-5 1-7）: ");
-            scanf("%d %d", &floor, &day);
-            if (floor >= 1 && floor <= 5 && day >= 1 && day <= 7) {
-                display_seats(floor - 1, day - 1);
+    load_data();
+}
+
+// ===== 实时占用看板 =====
+// 所有楼层某一天的座位占用情况，持续刷新。第一帧完整绘制，之后只根据脏位
+// 用光标定位转义序列重写发生变化的格子；每帧先拼进一个缓冲区再一次写出。
+// 看板进程只读数据，每帧由 engine_reload() 取得其他进程的修改：共享模式下不读文件，
+// 其他进程预约/取消时在共享内存段中增加该格的修改计数，计数变化的格子标记为脏；
+// 私有模式下修改只能通过数据文件传递，只有保存序号变化的楼层才重新读取，
+// 与内存不同的座位标记为脏。
+
+#define DASHBOARD_TOP 3                 // 第一层标题所在的屏幕行
+#define DASHBOARD_FLOOR_HEIGHT (ROWS + 3)
+#define DASHBOARD_STATUS_LINE (DASHBOARD_TOP + FLOORS * DASHBOARD_FLOOR_HEIGHT)
+
+char dashboard_frame[16384];
+int dashboard_length;
+char dashboard_shown[FLOORS][ROWS][COLS]; // 屏幕上当前显示的字符
+int dashboard_occupied;
+
+void frame_append(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int space = (int)sizeof(dashboard_frame) - dashboard_length;
+    int written = vsnprintf(dashboard_frame + dashboard_length, space, format, args);
+    va_end(args);
+    if (written > 0) {
+        dashboard_length += written < space ? written : space - 1;
+    }
+}
+
+char dashboard_cell(int floor, int row, int col, int day) {
+    Seat seat;
+    engine_get_seat(engine, floor, row, col, day, &seat);
+    return seat.count == 0 ? '0' : '1';
+}
+
+// 座位在屏幕上的位置（行、列从 1 开始），与 display_seats() 的排版一致
+void frame_goto_cell(int floor, int row, int col) {
+    frame_append("\x1b[%d;%dH", DASHBOARD_TOP + floor * DASHBOARD_FLOOR_HEIGHT + 2 + row, 5 + col * 4);
+}
+
+void frame_status() {
+    char now[16];
+    time_t t = time(NULL);
+    strftime(now, sizeof(now), "%H:%M:%S", localtime(&t));
+    frame_append("\x1b[%d;1H\x1b[K已占用 %d 个座位  更新于 %s", DASHBOARD_STATUS_LINE, dashboard_occupied, now);
+}
+
+// 完整绘制一帧
+void dashboard_full_frame(int day) {
+    dashboard_length = 0;
+    dashboard_occupied = 0;
+    frame_append("\x1b[2J\x1b[H=== 实时座位看板 - %s ===", get_day_name(day));
+
+    for (int floor = 0; floor < FLOORS; floor++) {
+        int rows, cols;
+        engine_floor_size(engine, floor, &rows, &cols);
+        int top = DASHBOARD_TOP + floor * DASHBOARD_FLOOR_HEIGHT;
+
+        frame_append("\x1b[%d;1H第%d层 (%d行×%d列)", top, floor + 1, rows, cols);
+        frame_append("\x1b[%d;1H    ", top + 1);
+        for (int col = 0; col < cols; col++) {
+            frame_append("%d   ", col + 1);
+        }
+        for (int row = 0; row < rows; row++) {
+            frame_append("\x1b[%d;1H%d | ", top + 2 + row, row + 1);
+            for (int col = 0; col < cols; col++) {
+                char cell = dashboard_cell(floor, row, col, day);
+                dashboard_shown[floor][row][col] = cell;
+                dashboard_occupied += cell == '1';
+                frame_append("%c   ", cell);
             }
-            else {
-                printf("无效的输入！\n");
+        }
+
+        engine_take_layout_dirty(engine, floor);
+        engine_take_dirty(engine, floor, day);
+    }
+    frame_status();
+}
+
+// 只绘制脏位对应且显示字符确实变化的格子，返回是否需要整帧重画
+int dashboard_diff_frame(int day) {
+    dashboard_length = 0;
+
+    for (int floor = 0; floor < FLOORS; floor++) {
+        if (engine_take_layout_dirty(engine, floor)) {
+            return 1;
+        }
+
+        int rows, cols;
+        engine_floor_size(engine, floor, &rows, &cols);
+        uint32_t bits = engine_take_dirty(engine, floor, day);
+
+        while (bits) {
+            int bit = 0;
+            while (!(bits & (1u << bit))) bit++;
+            bits &= bits - 1;
+
+            int row = bit / COLS;
+            int col = bit % COLS;
+            if (row >= rows || col >= cols) continue;
+
+            char cell = dashboard_cell(floor, row, col, day);
+            if (cell != dashboard_shown[floor][row][col]) {
+                dashboard_occupied += (cell == '1') - (dashboard_shown[floor][row][col] == '1');
+                dashboard_shown[floor][row][col] = cell;
+                frame_goto_cell(floor, row, col);
+                frame_append("%c", cell);
+            }
+        }
+    }
+    frame_status();
+    return 0;
+}
+
+// 看板模式：显示第 day 天所有楼层，每 interval_ms 毫秒刷新，frames 为 0 时一直运行
+void run_dashboard(int day, int frames, int interval_ms) {
+#ifdef _WIN32
+    // Windows 10 控制台需要开启虚拟终端序列
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD console_mode = 0;
+    if (GetConsoleMode(console, &console_mode)) {
+        SetConsoleMode(console, console_mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+    struct timespec interval;
+    interval.tv_sec = interval_ms / 1000;
+    interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+
+    engine_reload(engine);
+    dashboard_full_frame(day);
+    fwrite(dashboard_frame, 1, dashboard_length, stdout);
+    fflush(stdout);
+
+    for (int frame = 1; frames == 0 || frame < frames; frame++) {
+        thrd_sleep(&interval, NULL);
+        engine_reload(engine);
+        if (dashboard_diff_frame(day)) {
+            dashboard_full_frame(day);
+        }
+        fwrite(dashboard_frame, 1, dashboard_length, stdout);
+        fflush(stdout);
+    }
+    printf("\x1b[%d;1H\n", DASHBOARD_STATUS_LINE + 1);
+}
+
+// 主函数
+// 用法：图书馆预约系统 2.0 [--shards N]
+//       [--audit-retention 天数] [--audit-segment 每段记录数]
+//       [--persist sync|durable|optimistic] [--no-uring]
+//       [--hours 开馆-闭馆] [--slot-minutes 时段分钟数]
+//       [--shared 共享内存段名称] [--record 轨迹文件]
+//       [--import 文件] [--export 文件 [--format csv|grid]]
+//       [--dashboard 天 [--frames 帧数] [--interval 毫秒]]
+// 吞吐量测试、多进程压力测试和轨迹回放在单独的 seat_bench 程序中
+int main(int argc, char* argv[]) {
+    int shard_arg = 0;
+    const char* record_path = NULL;
+    const char* import_path = NULL;
+    const char* export_path = NULL;
+    SeatTextFormat export_format = SEAT_TEXT_CSV;
+    int dashboard_day = 0;
+    int dashboard_frames = 0;
+    int dashboard_interval = 500;
+
+    engine_config_default(&engine_config);
+    engine_config.data_file = FILENAME;
+    engine_config.floor_file_format = FLOOR_FILENAME;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shard_arg = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--persist") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "durable") == 0) engine_config.persist_mode = PERSIST_DURABLE;
+            else if (strcmp(argv[i], "optimistic") == 0) engine_config.persist_mode = PERSIST_OPTIMISTIC;
+            else engine_config.persist_mode = PERSIST_SYNC;
+        }
+        else if (strcmp(argv[i], "--dashboard") == 0 && i + 1 < argc) {
+            dashboard_day = atoi(argv[++i]);
+            if (dashboard_day < 1 || dashboard_day > DAYS) {
+                printf("无效的看板日期 %s！请输入 1-%d\n", argv[i], DAYS);
+                return 1;
             }
         }
-        else if (choice == 2) {
-            reserve_seat();
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            dashboard_frames = atoi(argv[++i]);
         }
-        else if (choice == 3) {
-            cancel_reservation();
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            dashboard_interval = atoi(argv[++i]);
         }
-        else if (choice == 4 && library.is_logged_in && library.current_user.type == USER_ADMIN) {
-            view_all_reservations();
+        else if (strcmp(argv[i], "--no-uring") == 0) {
+            engine_config.use_uring = 0;
         }
-        else if (choice == 5 && library.is_logged_in && library.current_user.type == USER_ADMIN) {
-            clear_data();
+        else if (strcmp(argv[i], "--audit-retention") == 0 && i + 1 < argc) {
+            engine_config.audit_retention_days = atoi(argv[++i]);
         }
-        else if (choice == 6 && library.is_logged_in && library.current_user.type == USER_ADMIN) {
-            cancel_all_day_reservations();
+        else if (strcmp(argv[i], "--audit-segment") == 0 && i + 1 < argc) {
+            engine_config.audit_segment_records = atoi(argv[++i]);
         }
-        else if (choice == 7 && library.is_logged_in && library.current_user.type == USER_ADMIN) {
-            cancel_all_floor_reservations();
+        else if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+            sscanf(argv[++i], "%d-%d", &engine_config.open_hour, &engine_config.close_hour);
         }
-        else if (choice == 8 && library.is_logged_in && library.current_user.type == USER_ADMIN) {
-            adjust_floor_seats();
+        else if (strcmp(argv[i], "--slot-minutes") == 0 && i + 1 < argc) {
+            engine_config.slot_minutes = atoi(argv[++i]);
         }
-        else {
-            printf("无效的选择或权限不足！\n");
+        else if (strcmp(argv[i], "--shared") == 0 && i + 1 < argc) {
+            engine_config.shared_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--import") == 0 && i + 1 < argc) {
+            import_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            export_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!parse_text_format(argv[++i], &export_format)) {
+                printf("无效的格式 %s！\n", argv[i]);
+                return 1;
+            }
         }
-    }
-    else {
-        printf("无效的命令！\n");
     }
 
-    // 清空输入缓冲区
-    while (getchar() != '\n');
-}
+    int dashboard = dashboard_day != 0;
+    if (dashboard) {
+        engine_config.audit_prefix = NULL; // 看板只读数据，不写入审计日志
+        engine_config.persist_mode = PERSIST_SYNC;
+    }
 
-// 初始化系统
-void init_system() {
-    memset(&library, 0, sizeof(library));
-    library.is_logged_in = 0;
+    init_system();
+    if (dashboard) {
+        run_dashboard(dashboard_day - 1, dashboard_frames, dashboard_interval);
+        engine_destroy(engine);
+        return 0;
+    }
+    if (shard_arg > 0) {
+        start_shards(shard_arg);
+    }
 
-    // 初始化每层行列数为默认值
-    for (int i = 0; i < FLOORS; i++) {
-        library.floor_rows[i] = ROWS;
-        library.floor_cols[i] = COLS;
+    // 先导入再导出，完成后退出
+    if (import_path != NULL || export_path != NULL) {
+        int ok = import_path == NULL || import_file(import_path);
+        if (ok && export_path != NULL) {
+            ok = export_file(export_path, export_format);
+        }
+        stop_shards();
+        engine_save(engine);
+        engine_destroy(engine);
+        return ok ? 0 : 1;
     }
 
-    load_data();
-}
+    if (record_path != NULL) {
+        if (trace_start(record_path)) {
+            printf("正在录制命令轨迹到 %s\n", record_path);
+        }
+        else {
+            printf("无法创建轨迹文件 %s！\n", record_path);
+        }
+    }
 
-// 主函数
-int main() {
-    init_system();
     printf("图书馆座位预约系统启动成功！\n");
 
     while (1) {
@@ -594,4 +1014,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
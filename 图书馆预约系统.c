@@ -6,80 +6,62 @@
 #include <ctype.h>
 #include <time.h>
 
-#define FLOORS 5
-#define ROWS 4
-#define COLS 4
-#define DAYS 7
+#include "seat_engine.h"
+#include "command_table.h"
+
+#define FLOORS ENGINE_FLOORS
+#define ROWS ENGINE_ROWS
+#define COLS ENGINE_COLS
+#define DAYS ENGINE_DAYS
 #define MAX_USERS 27 // A-Z + Admin
 #define FILENAME "library_data.dat"
+#define BOOKINGS_PER_FLOOR ENGINE_BOOKINGS_PER_FLOOR
 
 
-// 用户类型
-typedef enum {
-    USER_NORMAL,
-    USER_ADMIN
-} UserType;
-
 // 用户结构
 typedef struct {
     char name[20];
     UserType type;
 } User;
 
-// 座位状态
-typedef enum {
-    STATUS_EMPTY = 0,
-    STATUS_RESERVED = 1,
-    STATUS_SELF_RESERVED = 2
-} SeatStatus;
-
-// 座位结构
+// 图书馆系统：座位数据由预约引擎保存
 typedef struct {
-    SeatStatus status;
-    char reserved_by; // 预约的用户字母
-    time_t reserve_time; // 预约时间
-} Seat;
-
-// 图书馆系统
-typedef struct {
-    Seat seats[FLOORS][ROWS][COLS][DAYS]; // 5层×4行×4列×7天
     User current_user;
     int is_logged_in;
 } LibrarySystem;
 
 // 全局系统实例
 LibrarySystem library;
+SeatEngine* engine;
+
+// 命令表和输入
+CommandTable command_table;
+CommandReader input;
+
 // 保存数据到文件
 void save_data() {
-    FILE* file = fopen(FILENAME, "wb");
-    if (file == NULL) {
+    if (engine_save(engine) != ENGINE_OK) {
         printf("无法保存数据到文件！\n");
         return;
     }
-
-    fwrite(library.seats, sizeof(library.seats), 1, file);
-    fclose(file);
     printf("数据已保存！\n");
 }
 
 // 从文件加载数据
 void load_data() {
-    FILE* file = fopen(FILENAME, "rb");
-    if (file == NULL) {
+    if (engine_load(engine) != ENGINE_OK) {
         printf("无保存数据，使用默认数据\n");
-        // 初始化所有座位为空
-        memset(library.seats, 0, sizeof(library.seats));
         return;
     }
-
-    fread(library.seats, sizeof(library.seats), 1, file);
-    fclose(file);
     printf("数据已加载！\n");
 }
 
 // 清空所有数据
-void clear_data() {
-    memset(library.seats, 0, sizeof(library.seats));
+void clear_data(CommandArgs* args) {
+    (void)args;
+    for (int floor = 0; floor < FLOORS; floor++) {
+        engine_clear_floor(engine, floor);
+    }
     save_data();
     printf("所有数据已清空！\n");
 }
@@ -89,35 +71,76 @@ const char* get_day_name(int day) {
     return days[day];
 }
 
-// 显示座位状态
-void display_seats(int floor, int day) {
-    printf("\n=== 第%d层 - %s ===\n", floor + 1, get_day_name(day));
+// 把输入的起止时间（分钟）换成时段，不在开放时间内或不是时段边界时返回 0
+int to_slots(int start_minute, int end_minute, int* start, int* end) {
+    *start = engine_slot_boundary(engine, start_minute);
+    *end = engine_slot_boundary(engine, end_minute);
+    return *start >= 0 && *end > *start;
+}
+
+void print_slot_error() {
+    int open = engine_slot_minute(engine, 0);
+    int close = engine_slot_minute(engine, engine_slot_count(engine));
+    printf("无效的时间段！开放时间 %02d:%02d-%02d:%02d，每 %d 分钟一个时段\n",
+        open / 60, open % 60, close / 60, close % 60, engine_slot_minute(engine, 1) - open);
+}
+
+// 座位在时段 [start, end) 内的第一段预约，时段位图没有重叠时直接返回 NULL
+const Booking* booking_in_window(const Seat* seat, int start, int end) {
+    if (!(seat->busy & engine_slot_mask(start, end))) {
+        return NULL;
+    }
+    int from = engine_slot_minute(engine, start), to = engine_slot_minute(engine, end);
+    for (int i = 0; i < seat->count; i++) {
+        if (seat->bookings[i].start < to && seat->bookings[i].end > from) {
+            return &seat->bookings[i];
+        }
+    }
+    return NULL;
+}
+
+// 显示座位在时段 [start, end) 内的状态，只显示该层实际的行列（数据文件可能调整过楼层大小）
+void display_seats(int floor, int day, int start, int end) {
+    int rows, cols;
+    if (engine_floor_size(engine, floor, &rows, &cols) != ENGINE_OK) {
+        printf("无效的输入！\n");
+        return;
+    }
+
+    int from = engine_slot_minute(engine, start), to = engine_slot_minute(engine, end);
+    printf("\n=== 第%d层 - %s %02d:%02d-%02d:%02d ===\n", floor + 1, get_day_name(day),
+        from / 60, from % 60, to / 60, to % 60);
     printf("    ");
-    for (int col = 0; col < COLS; col++) {
+    for (int col = 0; col < cols; col++) {
         printf("%d   ", col + 1);
     }
     printf("\n");
 
-    for (int row = 0; row < ROWS; row++) {
+    for (int row = 0; row < rows; row++) {
         printf("%d | ", row + 1);
-        for (int col = 0; col < COLS; col++) {
-            Seat seat = library.seats[floor][row][col][day];
+        for (int col = 0; col < cols; col++) {
+            Seat seat;
+            if (engine_get_seat(engine, floor, row, col, day, &seat) != ENGINE_OK) {
+                printf("-   ");
+                continue;
+            }
+            const Booking* booking = booking_in_window(&seat, start, end);
 
             if (library.current_user.type == USER_ADMIN) {
                 // 管理员视图：显示具体用户
-                if (seat.status == STATUS_EMPTY) {
+                if (booking == NULL) {
                     printf("0   ");
                 }
                 else {
-                    printf("%c   ", seat.reserved_by);
+                    printf("%c   ", booking->reserved_by);
                 }
             }
+            else if (booking == NULL) {
+                printf("0   ");
+            }
             else {
                 // 普通用户视图
-                switch (seat.status) {
-                case STATUS_EMPTY:
-                    printf("0   ");
-                    break;
+                switch (booking->status) {
                 case STATUS_RESERVED:
                     printf("1   ");
                     break;
@@ -132,13 +155,8 @@ void display_seats(int floor, int day) {
 }
 
 // 登录功能
-void login() {
-    char username[20];
-    printf("请输入用户名: ");
-    scanf("%s", username);
-
-    // 清空输入缓冲区
-    while (getchar() != '\n');
+void login(CommandArgs* args) {
+    const char* username = args->text[0];
 
     if (strcmp(username, "Admin") == 0) {
         strcpy(library.current_user.name, "Admin");
@@ -159,7 +177,8 @@ void login() {
 }
 
 // 退出登录
-void logout() {
+void logout(CommandArgs* args) {
+    (void)args;
     if (library.is_logged_in) {
         printf("用户 %s 已退出登录\n", library.current_user.name);
         library.is_logged_in = 0;
@@ -170,105 +189,106 @@ void logout() {
     }
 }
 
-// 预约座位
-void reserve_seat() {
-    if (!library.is_logged_in) {
-        printf("请先登录！\n");
-        return;
-    }
-
-    int floor, row, col, day;
-    printf("请输入要预约的座位信息（层 行 列 天）: ");
-    scanf("%d %d %d %d", &floor, &row, &col, &day);
+// 座位超出该层实际的行列数
+void print_seat_error(int floor) {
+    int rows, cols;
+    engine_floor_size(engine, floor, &rows, &cols);
+    printf("无效的座位！该楼层只有 %d 行 %d 列\n", rows, cols);
+}
 
+// 预约座位
+void reserve_seat(CommandArgs* args) {
     // 转换为0-based索引并验证
-    floor--; row--; col--; day--;
+    int floor = args->number[0] - 1, row = args->number[1] - 1;
+    int col = args->number[2] - 1, day = args->number[3] - 1;
+    int start, end;
 
     if (floor < 0 || floor >= FLOORS || row < 0 || row >= ROWS ||
         col < 0 || col >= COLS || day < 0 || day >= DAYS) {
         printf("无效的输入！\n");
         return;
     }
-
-    Seat* seat = &library.seats[floor][row][col][day];
-
-    if (seat->status != STATUS_EMPTY) {
-        printf("该座位已被预约！\n");
+    if (!to_slots(args->number[4], args->number[5], &start, &end)) {
+        print_slot_error();
         return;
     }
 
-    // 设置预约信息
-    seat->status = (library.current_user.type == USER_ADMIN) ? STATUS_RESERVED : STATUS_SELF_RESERVED;
-    seat->reserved_by = (library.current_user.type == USER_ADMIN) ? 'A' : toupper(library.current_user.name[0]);
-    seat->reserve_time = time(NULL);
+    // 管理员预约记在用户 A 名下
+    char user_char = (library.current_user.type == USER_ADMIN) ? 'A' : toupper(library.current_user.name[0]);
+    switch (engine_reserve(engine, floor, row, col, day, start, end, user_char, library.current_user.type)) {
+    case ENGINE_OK:
+        break;
+    case ENGINE_ERR_INVALID_SEAT:
+        print_seat_error(floor);
+        return;
+    case ENGINE_ERR_OCCUPIED:
+        printf("该时间段已被预约！\n");
+        return;
+    case ENGINE_ERR_FULL:
+        printf("该座位当天的预约已满！\n");
+        return;
+    default:
+        printf("预约失败！\n");
+        return;
+    }
 
     save_data();
     printf("预约成功！\n");
 }
 
 // 取消预约
-void cancel_reservation() {
-    if (!library.is_logged_in) {
-        printf("请先登录！\n");
-        return;
-    }
-
-    int floor, row, col, day;
-    printf("请输入要取消预约的座位信息（层 行 列 天）: ");
-    scanf("%d %d %d %d", &floor, &row, &col, &day);
-
-    floor--; row--; col--; day--;
+void cancel_reservation(CommandArgs* args) {
+    int floor = args->number[0] - 1, row = args->number[1] - 1;
+    int col = args->number[2] - 1, day = args->number[3] - 1;
+    int slot = engine_slot_boundary(engine, args->number[4]);
 
     if (floor < 0 || floor >= FLOORS || row < 0 || row >= ROWS ||
         col < 0 || col >= COLS || day < 0 || day >= DAYS) {
         printf("无效的输入！\n");
         return;
     }
-
-    Seat* seat = &library.seats[floor][row][col][day];
-
-    if (seat->status == STATUS_EMPTY) {
-        printf("该座位未被预约！\n");
+    if (slot < 0 || slot >= engine_slot_count(engine)) {
+        print_slot_error();
         return;
     }
 
-    if (library.current_user.type == USER_NORMAL &&
-        seat->reserved_by != toupper(library.current_user.name[0])) {
+    switch (engine_cancel(engine, floor, row, col, day, slot,
+        toupper(library.current_user.name[0]), library.current_user.type)) {
+    case ENGINE_OK:
+        break;
+    case ENGINE_ERR_INVALID_SEAT:
+        print_seat_error(floor);
+        return;
+    case ENGINE_ERR_NOT_RESERVED:
+        printf("该时间段未被预约！\n");
+        return;
+    case ENGINE_ERR_NOT_OWNER:
         printf("您只能取消自己的预约！\n");
         return;
+    default:
+        printf("取消预约失败！\n");
+        return;
     }
 
-    seat->status = STATUS_EMPTY;
-    seat->reserved_by = '\0';
-    seat->reserve_time = 0;
-
     save_data();
     printf("取消预约成功！\n");
 }
 
 // 查看所有预约
-void view_all_reservations() {
-    if (!library.is_logged_in || library.current_user.type != USER_ADMIN) {
-        printf("需要管理员权限！\n");
-        return;
-    }
-
+void view_all_reservations(CommandArgs* args) {
+    (void)args;
     printf("\n=== 所有预约信息 ===\n");
     int count = 0;
 
+    static EngineReservation records[BOOKINGS_PER_FLOOR];
     for (int floor = 0; floor < FLOORS; floor++) {
-        for (int day = 0; day < DAYS; day++) {
-            for (int row = 0; row < ROWS; row++) {
-                for (int col = 0; col < COLS; col++) {
-                    Seat seat = library.seats[floor][row][col][day];
-                    if (seat.status != STATUS_EMPTY) {
-                        count++;
-                        printf("第%d层 %s (%d,%d) - 用户: %c, 时间: %s",
-                            floor + 1, get_day_name(day), row + 1, col + 1,
-                            seat.reserved_by, ctime(&seat.reserve_time));
-                    }
-                }
-            }
+        int floor_count = engine_collect_floor(engine, floor, records);
+        for (int i = 0; i < floor_count; i++) {
+            count++;
+            printf("第%d层 %s (%d,%d) %02d:%02d-%02d:%02d - 用户: %c, 时间: %s",
+                floor + 1, get_day_name(records[i].day), records[i].row + 1, records[i].col + 1,
+                records[i].start / 60, records[i].start % 60, records[i].end / 60, records[i].end % 60,
+                records[i].reserved_by, ctime(&records[i].reserve_time));
         }
     }
 
@@ -276,6 +296,50 @@ void view_all_reservations() {
         printf("暂无预约记录\n");
     }
 }
+// 显示某层某天某个时间段的座位状态
+void view_seats(CommandArgs* args) {
+    int floor = args->number[0], day = args->number[1];
+    int start, end;
+    if (floor < 1 || floor > FLOORS || day < 1 || day > DAYS) {
+        printf("无效的输入！\n");
+    }
+    else if (!to_slots(args->number[2], args->number[3], &start, &end)) {
+        print_slot_error();
+    }
+    else {
+        display_seats(floor - 1, day - 1, start, end);
+    }
+}
+
+// 退出程序
+void quit_program(CommandArgs* args) {
+    (void)args;
+    save_data();
+    engine_destroy(engine);
+    printf("再见！\n");
+    exit(0);
+}
+
+// 命令表：命令词、菜单说明、权限、参数格式、提示和处理函数，菜单按此顺序显示
+const Command commands[] = {
+    { "1", "显示座位状态", COMMAND_GUEST, "iitt", "请输入要查看的层数、天数和时间段（如 1 1 9:00 12:00）: ", view_seats },
+    { "2", "预约座位", COMMAND_USER, "iiiitt", "请输入要预约的座位信息（层 行 列 天 开始时间 结束时间）: ", reserve_seat },
+    { "3", "取消预约", COMMAND_USER, "iiiit", "请输入要取消预约的座位信息（层 行 列 天 预约内的时间）: ", cancel_reservation },
+    { "4", "查看所有预约", COMMAND_ADMIN, "", NULL, view_all_reservations },
+    { "5", "清空所有数据", COMMAND_ADMIN, "", NULL, clear_data },
+    { "Login", "登录", COMMAND_GUEST, "w", "请输入用户名: ", login },
+    { "Exit", "退出登录", COMMAND_GUEST, "", NULL, logout },
+    { "Quit", "退出程序", COMMAND_GUEST, "", NULL, quit_program }
+};
+
+// 当前用户的权限
+CommandLevel current_level() {
+    if (!library.is_logged_in) {
+        return COMMAND_GUEST;
+    }
+    return library.current_user.type == USER_ADMIN ? COMMAND_ADMIN : COMMAND_USER;
+}
+
 // 显示主菜单
 void show_menu() {
     printf("\n=== 图书馆座位预约系统 ===\n");
@@ -284,76 +348,62 @@ void show_menu() {
             library.current_user.name,
             library.current_user.type == USER_ADMIN ? "管理员" : "普通用户");
     }
-    printf("1. 显示座位状态\n");
-    printf("2. 预约座位\n");
-    printf("3. 取消预约\n");
-    if (library.is_logged_in && library.current_user.type == USER_ADMIN) {
-        printf("4. 查看所有预约\n");
-        printf("5. 清空所有数据\n");
-    }
-    printf("Login - 登录\n");
-    printf("Exit - 退出登录\n");
-    printf("Quit - 退出程序\n");
+    command_print_menu(&command_table, current_level());
     printf("请选择操作: ");
 }
 
 // 处理用户输入
 void process_command() {
-    char command[20];
-    scanf("%s", command);
-
-    if (strcmp(command, "Login") == 0) {
-        login();
-    }
-    else if (strcmp(command, "Exit") == 0) {
-        logout();
-    }
-    else if (strcmp(command, "Quit") == 0) {
-        save_data();
-        printf("再见！\n");
-        exit(0);
-    }
-    else if (isdigit(command[0])) {
-        int choice = atoi(command);
-
-        if (choice == 1) {
-            int floor, day;
-            printf("请输入要查看的层数和天数（1-5 1-7）: ");
-            scanf("%d %d", &floor, &day);
-            if (floor >= 1 && floor <= 5 && day >= 1 && day <= 7) {
-                display_seats(floor - 1, day - 1);
-            }
-            else {
-                printf("无效的输入！\n");
-            }
-        }
-        else if (choice == 2) {
-            reserve_seat();
-        }
-        else if (choice == 3) {
-            cancel_reservation();
-        }
-        else if (choice == 4 && library.is_logged_in && library.current_user.type == USER_ADMIN) {
-            view_all_reservations();
-        }
-        else if (choice == 5 && library.is_logged_in && library.current_user.type == USER_ADMIN) {
-            clear_data();
+    switch (command_dispatch(&command_table, &input, current_level())) {
+    case COMMAND_EOF:
+        // 输入结束（如脚本执行完）时按 Quit 处理
+        quit_program(NULL);
+        break;
+    case COMMAND_NOT_LOGGED_IN:
+        printf("请先登录！\n");
+        break;
+    case COMMAND_DENIED:
+        printf("无效的选择或权限不足！\n");
+        break;
+    case COMMAND_UNKNOWN:
+        if (isdigit((unsigned char)input.word[0])) {
+            printf("无效的选择或权限不足！\n");
         }
         else {
-            printf("无效的选择或权限不足！\n");
+            printf("无效的命令！\n");
         }
-    }
-    else {
-        printf("无效的命令！\n");
+        break;
+    case COMMAND_BAD_ARGS:
+        printf("无效的输入！\n");
+        break;
+    default:
+        break;
     }
 
     // 清空输入缓冲区
-    while (getchar() != '\n');
+    command_skip_line(&input);
 }
 
 void init_system() {
     memset(&library, 0, sizeof(library));
     library.is_logged_in = 0;
+    if (!command_table_build(&command_table, commands, sizeof(commands) / sizeof(commands[0]))) {
+        printf("命令表无效！\n");
+        exit(1);
+    }
+    command_reader_init(&input, stdin);
+
+    // 旧版程序不记录审计日志
+    EngineConfig config;
+    engine_config_default(&config);
+    config.data_file = FILENAME;
+    config.audit_prefix = NULL;
+    engine = engine_create(&config);
+    if (engine == NULL) {
+        printf("无法初始化预约系统！\n");
+        exit(1);
+    }
+
     load_data();
 }
 